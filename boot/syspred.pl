@@ -948,6 +948,8 @@ table_flag(answer_abstract(N), Pred) :-
     '$get_predicate_attribute'(Pred, subgoal_abstract, N).
 table_flag(subgoal_abstract(N), Pred) :-
     '$get_predicate_attribute'(Pred, max_answers, N).
+table_flag(eviction(Policy), Pred) :-
+    '$get_predicate_attribute'(Pred, eviction, Policy).
 
 
 %!  visible_predicate(:Head) is nondet.
@@ -1148,6 +1150,9 @@ module_property(exports(_)).
 module_property(exported_operators(_)).
 module_property(size(_)).
 module_property(program_size(_)).
+module_property(clause_size(_)).
+module_property(index_size(_)).
+module_property(table_size(_)).
 module_property(program_space(_)).
 module_property(last_modified_generation(_)).
 
@@ -1216,6 +1221,17 @@ current_trie(Trie) :-
 %     - reevaluated(Count)
 %       Number of times the trie was re-evaluated
 %
+%   Tabling statistics:
+%
+%     - call_count(Count)
+%       Number of tabled calls that used this table
+%     - reuse_count(Count)
+%       Number of tabled calls that found this table complete
+%     - completion_time(Seconds)
+%       Wall time needed to complete the table
+%     - scc_size(Count)
+%       Number of tables completed together with this table
+%
 %   Shared tabling statistics:
 %
 %     - deadlock(Count)
@@ -1243,6 +1259,10 @@ trie_property(wait(_)).
 trie_property(idg_affected_count(_)).
 trie_property(idg_dependent_count(_)).
 trie_property(idg_size(_)).
+trie_property(completion_time(_)).              % Tabling stats
+trie_property(scc_size(_)).
+trie_property(call_count(_)).
+trie_property(reuse_count(_)).
 
 
                 /********************************
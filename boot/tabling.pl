@@ -337,6 +337,7 @@ tabled_attribute(answer_abstract).
 tabled_attribute(monotonic).
 tabled_attribute(opaque).
 tabled_attribute(lazy).
+tabled_attribute(eviction).
 
 %!  start_tabling(:Closure, :Wrapper, :Implementation)
 %
@@ -373,6 +374,8 @@ start_tabling_2(Closure, Wrapper, Worker, Trie, Status, Skeleton) :-
               restart_tabling(Closure, Wrapper, Worker))
     ;   Status == invalid
     ->  reeval(Trie, Wrapper, Skeleton)
+    ;   Status == help
+    ->  shift('$tbl_help_call'(Wrapper))
     ;   % = run_follower, but never fresh and Status is a worklist
         shift(call_info(Skeleton, Status))
     ).
@@ -426,6 +429,8 @@ start_subsumptive_tabling(Closure, Wrapper, Worker) :-
         ;   Status == invalid
         ->  reeval(Trie, Wrapper, Skeleton),
             trie_gen_compiled(Trie, Skeleton)
+        ;   Status == help
+        ->  shift('$tbl_help_call'(Wrapper))
         ;   shift(call_info(Skeleton, Status))
         )
     ;   more_general_table(Wrapper, ATrie),
@@ -433,7 +438,9 @@ start_subsumptive_tabling(Closure, Wrapper, Worker) :-
     ->  '$tbl_answer_update_dl'(ATrie, Skeleton) % see (*)
     ;   more_general_table(Wrapper, ATrie),
         '$tbl_table_status'(ATrie, Status, GenWrapper, GenSkeleton)
-    ->  (   Status == invalid
+    ->  (   '$tbl_helping'                      % not complete, see above
+        ->  shift('$tbl_help_call'(Wrapper))
+        ;   Status == invalid
         ->  reeval(ATrie, GenWrapper, GenSkeleton),
             Wrapper = GenWrapper,
             '$tbl_answer_update_dl'(ATrie, GenSkeleton)
@@ -487,6 +494,8 @@ start_abstract_tabling(Closure, Wrapper, Worker) :-
         reeval(ATrie, GenWrapper, GenSkeleton),
         Wrapper = GenWrapper,
         '$tbl_answer_update_dl'(ATrie, Skeleton)
+    ;   Status == help
+    ->  shift('$tbl_help_call'(Wrapper))
     ;   shift(call_info(GenSkeleton, Skeleton, Status)),
         unify_subsumptive(Skeleton, GenSkeleton)
     ).
@@ -677,6 +686,8 @@ start_moded_tabling_2(_Closure, Wrapper, Worker, ModeArgs,
     ;   Status == invalid
     ->  reeval(Trie, Wrapper, Skeleton),
         moded_gen_answer(Trie, Skeleton, ModeArgs)
+    ;   Status == help
+    ->  shift('$tbl_help_call'(Wrapper))
     ;   % = run_follower, but never fresh and Status is a worklist
         shift(call_info(Skeleton/ModeArgs, Status))
     ).
@@ -782,10 +793,14 @@ completion(SCC, Status, Clause) :-
 
 completion_(SCC) :-
     repeat,
-    (   '$tbl_pop_worklist'(SCC, WorkList)
+    (   '$tbl_help_done'(SCC, false, TargetWL, Result)
+    ->  help_result(Result, TargetWL)
+    ;   '$tbl_pop_worklist'(SCC, WorkList)
     ->  tdebug(wl_goal(WorkList, Goal, _)),
         tdebug(schedule, 'Complete ~p in ~p', [Goal, scc(SCC)]),
         completion_step(WorkList)
+    ;   '$tbl_help_done'(SCC, true, TargetWL, Result)
+    ->  help_result(Result, TargetWL)
     ;   !
     ).
 
@@ -830,6 +845,70 @@ completion_step(SourceWL) :-
     delim(TargetSkeleton, Continuation, TargetWL, Delays),
     fail.
 
+%!  help_result(+Result, +TargetWL) is failure.
+%
+%   Process the result of a  job  that   '$tbl_wkl_work'/6  handed  to a
+%   thread that waits for one of our shared tables. Result is one of
+%
+%     - Continuation-Skeleton
+%       No helper took the job, so we run it ourselves.
+%     - exception(Error)
+%       Running the job raised Error.
+%     - A list of answer(Skeleton, Delays) and resume(Goal, Cont,
+%       Skeleton) terms, where the latter asks us to call Goal and
+%       continue with the part Cont of the continuation the helper
+%       could not execute.  See '$tbl_help_run'/3.
+
+help_result(Continuation-Skeleton, TargetWL) :-
+    !,
+    delim(Skeleton, Continuation, TargetWL, []),
+    fail.
+help_result(exception(Error), _) :-
+    !,
+    throw(Error).
+help_result(Results, TargetWL) :-
+    '$member'(Result, Results),
+    help_result_(Result, TargetWL),
+    fail.
+
+help_result_(answer(Skeleton, Delays), TargetWL) :-
+    '$tbl_wkl_add_answer'(TargetWL, Skeleton, Delays, _Complete).
+help_result_(resume(Goal, Cont, Skeleton), TargetWL) :-
+    delim(Skeleton, help_resume(Goal, Cont), TargetWL, []).
+
+help_resume(Goal, Cont) :-
+    call(Goal),
+    call(Cont).
+
+%!  '$tbl_help_run'(+Job, +Continuation-Skeleton, -Results) is semidet.
+%
+%   Run a continuation on behalf of  a   thread  that  is completing a
+%   shared table. This is executed in a  private engine of a thread that
+%   waits for the table. Results is a list holding answer(Skeleton,
+%   Delays) for each answer and resume(Goal, Cont, Skeleton) if a branch
+%   needs a table that is not complete or suspends.  In the latter case
+%   the owner continues the branch (see help_result/2).  Fails if the
+%   owner abandoned Job.  Other exceptions are passed to the owner.
+
+'$tbl_help_run'(Job, Continuation-Skeleton, Results) :-
+    catch(findall(Result,
+                  help_solution(Job, Continuation, Skeleton, Result),
+                  Results),
+          '$tbl_help_bail', fail).
+
+help_solution(Job, Continuation, Skeleton, Result) :-
+    reset_delays,
+    reset(Continuation, Ball, Cont),
+    (   '$tbl_help_abandoned'(Job)
+    ->  throw('$tbl_help_bail')
+    ;   Cont == 0
+    ->  '$tbl_delay_list'(Delays),
+        Result = answer(Skeleton, Delays)
+    ;   Ball = '$tbl_help_call'(Goal)
+    ->  Result = resume(Goal, Cont, Skeleton)
+    ;   Result = resume(shift(Ball), Cont, Skeleton)
+    ).
+
 
 		 /*******************************
 		 *     STRATIFIED NEGATION	*
@@ -844,7 +923,9 @@ completion_step(SourceWL) :-
 tnot(Goal0) :-
     '$tnot_implementation'(Goal0, Goal),        % verifies Goal is tabled
     (   '$tbl_existing_variant_table'(_, Goal, Trie, Status, Skeleton)
-    ->  (   '$tbl_answer_dl'(Trie, _, true)
+    ->  (   Status == help
+        ->  shift('$tbl_help_call'(tnot(Goal0)))
+        ;   '$tbl_answer_dl'(Trie, _, true)
         ->  fail
         ;   '$tbl_answer_dl'(Trie, _, _)
         ->  tdebug(tnot, 'tnot: adding ~p to delay list', [Goal]),
@@ -853,6 +934,8 @@ tnot(Goal0) :-
         ->  true
         ;   negation_suspend(Goal, Skeleton, Status)
         )
+    ;   '$tbl_helping'
+    ->  shift('$tbl_help_call'(tnot(Goal0)))
     ;   tdebug(tnot, 'tnot: ~p: fresh', [Goal]),
         (   '$wrapped_implementation'(Goal, table, Implementation), % see (*)
             functor(Implementation, Closure, _),
@@ -1132,6 +1215,7 @@ current_table(Variant, Trie) :-
 current_table_gen(M:Variant, Trie) :-
     '$tbl_local_variant_table'(VariantTrie),
     trie_gen(VariantTrie, M:NonModed, Trie),
+    \+ '$tbl_table_status'(Trie, fresh), % evicted tables are not destroyed
     M:'$table_mode'(Variant, NonModed, _Moded).
 current_table_gen(M:Variant, Trie) :-
     '$tbl_global_variant_table'(VariantTrie),
@@ -1142,7 +1226,8 @@ current_table_gen(M:Variant, Trie) :-
 current_table_lookup(M:Variant, Trie) :-
     M:'$table_mode'(Variant, NonModed, _Moded),
     '$tbl_local_variant_table'(VariantTrie),
-    trie_lookup(VariantTrie, M:NonModed, Trie).
+    trie_lookup(VariantTrie, M:NonModed, Trie),
+    \+ '$tbl_table_status'(Trie, fresh).
 current_table_lookup(M:Variant, Trie) :-
     M:'$table_mode'(Variant, NonModed, _Moded),
     '$tbl_global_variant_table'(VariantTrie),
@@ -1321,6 +1406,10 @@ table_options(subgoal_abstract(Size), Opts0, Opts1) :-
 table_options(answer_abstract(Size), Opts0, Opts1) :-
     !,
     restraint(answer_abstract, Size, Opts0, Opts1).
+table_options(eviction(Policy), Opts0, Opts1) :-
+    !,
+    '$must_be'(oneof(atom, eviction, [lru,cost,none]), Policy),
+    put_dict(eviction, Opts0, Policy, Opts1).
 table_options(Opt, _, _) :-
     '$domain_error'(table_option, Opt).
 
@@ -2139,11 +2228,16 @@ eval_dl_in_residual(G) :-
     '$tbl_table_status'(SGF, _Status, _Wrapper, Return),
     eval_subgoal_in_residual(SGF, Return).
 
+%!  more_general_table(+Goal, -Trie) is nondet.
+%
+%   True when Trie is the answer table  for   a  call that subsumes Goal.
+%   Tables for more specific calls are enumerated first. The lookup only
+%   follows trie paths that can subsume Goal.
+
 more_general_table(G, Trie) :-
-    term_variables(G, Vars),
     '$tbl_variant_table'(VariantTrie),
-    trie_gen(VariantTrie, G, Trie),
-    is_most_general_term(Vars).
+    '$trie_generalizations'(VariantTrie, G, Tries),
+    '$member'(Trie, Tries).
 
 :- table eval_subgoal_in_residual/2.
 
@@ -29,6 +29,7 @@ check_include_file(shlobj.h HAVE_SHLOBJ_H)
 check_include_file(signal.h HAVE_SIGNAL_H)
 check_include_file(string.h HAVE_STRING_H)
 check_include_file(sys/dir.h HAVE_SYS_DIR_H)
+check_include_file(sys/eventfd.h HAVE_SYS_EVENTFD_H)
 check_include_file(sys/file.h HAVE_SYS_FILE_H)
 check_include_file(sys/mman.h HAVE_SYS_MMAN_H)
 check_include_file(sys/ndir.h HAVE_SYS_NDIR_H)
@@ -126,6 +127,7 @@ alignof(ALIGNOF_INT64_T ALIGNOF_VOIDP ALIGNOF_DOUBLE)
 # Misc
 if(NOT EMSCRIPTEN)
   check_function_exists(mmap HAVE_MMAP)
+  check_function_exists(madvise HAVE_MADVISE)
 endif()
 check_function_exists(strerror HAVE_STRERROR)
 check_function_exists(poll HAVE_POLL)
@@ -175,7 +175,9 @@
 		       detached(boolean),
                        stack_limit(nonneg),
 		       c_stack(nonneg),
-                       queue_max_size(nonneg)
+                       queue_max_size(nonneg),
+		       numa_node(nonneg),
+		       stack_hugepages(oneof([false,true,transparent,explicit]))
 		     ]).
 :- predicate_options(system:message_queue_create/2, 2,
 		     [ alias(atom),
@@ -192,6 +194,11 @@
 		     [ timeout(number),
 		       deadline(number)
 		     ]).
+:- predicate_options(system:thread_get_messages/3, 3,
+		     [ timeout(number),
+		       deadline(number),
+		       max(nonneg)
+		     ]).
 :- predicate_options(system:locale_create/3, 3,
 		     [ alias(atom),
 		       decimal_point(atom),
@@ -39,6 +39,7 @@
           [ statistics/0,
             statistics/1,               % -Stats
             thread_statistics/2,        % ?Thread, -Stats
+            memory_report/1,            % -Report
             time/1,                     % :Goal
             call_time/2,                % :Goal, -Time
             call_time/3,                % :Goal, -Time, -Result
@@ -49,7 +50,7 @@
             profile_procedure_data/2    % :PI, -Data
           ]).
 :- autoload(library(error),[must_be/2]).
-:- autoload(library(lists),[append/3,member/2]).
+:- autoload(library(lists),[append/3,member/2,reverse/2]).
 :- autoload(library(option),[option/3]).
 :- autoload(library(pairs),[map_list_to_pairs/3,pairs_values/2]).
 :- autoload(library(prolog_code),
@@ -280,6 +281,43 @@ thread_stats(Thread, Stacks,
     thread_stack_statistics(Thread, Stacks).
 
 
+%!  memory_report(-Report:list(dict)) is det.
+%
+%   Report the memory used by the clauses, clause indexes and answer
+%   tables of each module.  Report is a list  of dicts, ordered by
+%   decreasing total usage.  Modules that use no such memory are
+%   omitted.  Each dict has the following keys, holding sizes in bytes:
+%
+%     - module
+%       Name of the module.
+%     - clauses
+%       Memory used by the clauses (see module_property/2, clause_size)
+%     - indexes
+%       Memory used by clause indexes (index_size)
+%     - tables
+%       Memory used by answer tables (table_size)
+%     - total
+%       Sum of the above.
+%
+%   The figures are maintained incrementally by the system and thus
+%   obtaining the report does not require walking all predicates.
+
+memory_report(Report) :-
+    findall(Total-memory{module:M, clauses:C, indexes:I,
+                         tables:T, total:Total},
+            ( current_module(M),
+              module_property(M, clause_size(C)),
+              module_property(M, index_size(I)),
+              module_property(M, table_size(T)),
+              Total is C+I+T,
+              Total > 0
+            ),
+            Pairs),
+    keysort(Pairs, Sorted),
+    pairs_values(Sorted, Ascending),
+    reverse(Ascending, Report).
+
+
 %!  time(:Goal) is nondet.
 %
 %   Execute Goal, reporting statistics to the user. If Goal succeeds
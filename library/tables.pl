@@ -56,10 +56,15 @@
             set_pil_on/0,
             set_pil_off/0,
 
+            table_statistics/2,                 % :Variant, -Stats
+            save_tables/2,                      % +File, :Preds
+            load_tables/1,                      % +File
+
             op(900, fy, tnot)
           ]).
 :- autoload(library(apply), [maplist/3]).
-:- autoload(library(error), [type_error/2, must_be/2, domain_error/2]).
+:- autoload(library(error),
+            [ type_error/2, must_be/2, domain_error/2, permission_error/3 ]).
 :- autoload(library(lists), [append/3]).
 
 /** <module> XSB interface to tables
@@ -81,7 +86,9 @@ XSB predicates that are marked deprecated.
     get_calls(:, -, -),
     get_returns_for_call(:, :),
     get_returns_and_dls(+, -, :),
-    get_residual(:, -).
+    get_residual(:, -),
+    table_statistics(:, -),
+    save_tables(+, :).
 
 %!  't not'(:Goal)
 %
@@ -375,4 +382,229 @@ abolish_table_subgoals(Head, Options) :-
     ;   memberchk(abolish_tables_singly, Options)
     ->  abolish_table_subgoals(Head)
     ;   domain_error([abolish_tables_transitively,abolish_tables_singly], Options)
+    ).
+
+
+		 /*******************************
+		 *          STATISTICS		*
+		 *******************************/
+
+%!  table_statistics(:Variant, -Stats) is nondet.
+%
+%   True when Stats is a list of statistics   for the table of Variant.
+%   If Variant is unbound, enumerate all tables.  Stats contains the
+%   terms below, where some may be missing if the information is not
+%   available:
+%
+%     - calls(Count)
+%       Number of tabled calls that used this table.
+%     - reused(Count)
+%       Number of tabled calls that found the table complete.
+%     - answers(Count)
+%       Number of answers in the table.
+%     - completion_time(Seconds)
+%       Wall time needed to complete the table.
+%     - scc_size(Count)
+%       Number of tables completed together with this table.
+%     - size(Bytes)
+%       Memory used by the answer trie.
+%
+%   The calls and reused counts are only maintained if the system is
+%   compiled with `O_TRIE_STATS`, which is the default.  The statistics
+%   of a table loaded using load_tables/1 start at zero and  such a table
+%   has no completion_time or scc_size.  Neither is reported for a table
+%   that is not complete.
+
+table_statistics(Variant, Stats) :-
+    current_table(Variant, Trie),
+    findall(Stat, table_statistic(Trie, Stat), Stats).
+
+table_statistic(Trie, Stat) :-
+    table_statistic_property(Stat, Property),
+    '$trie_property'(Trie, Property).
+
+table_statistic_property(calls(N),           call_count(N)).
+table_statistic_property(reused(N),          reuse_count(N)).
+table_statistic_property(answers(N),         value_count(N)).
+table_statistic_property(completion_time(T), completion_time(T)).
+table_statistic_property(scc_size(N),        scc_size(N)).
+table_statistic_property(size(B),            size(B)).
+
+
+		 /*******************************
+		 *         PERSISTENCY		*
+		 *******************************/
+
+%!  save_tables(+File, :Preds) is det.
+%
+%   Save the _complete_ tables  for  the   tabled  predicates  Preds to
+%   File. Preds is a predicate indicator, a  callable term or a list of
+%   these. The file is a sequence of fast_write/2 terms.  Each table is
+%   written as a term table(Module:Variant), followed by terms
+%   answers(List) holding at most 1,000 answers and the term
+%   `end_of_table`, such that neither saving nor loading needs memory
+%   proportional to the size of the table.  For answer subsumption
+%   (moded) tables the answers hold the aggregated moded arguments.
+%
+%   Tables that are not complete (incomplete, invalid or evicted) are
+%   not saved.  See load_tables/1 to restore the tables.
+%
+%   @error permission_error(save, incremental_table, PI) if Preds
+%   contains an incremental or monotonic predicate.  A loaded table has
+%   no dependencies and would not be invalidated by later updates.
+%   @error permission_error(save, conditional_table, Variant) if a
+%   table has conditional answers.  Their delay lists refer to other
+%   tables that need not exist when the table is loaded.  Both errors
+%   are raised before File is created.
+
+save_tables(File, M:Preds) :-
+    must_be(nonvar, Preds),
+    (   is_list(Preds)
+    ->  PredList = Preds
+    ;   PredList = [Preds]
+    ),
+    forall(( '$member'(Pred, PredList),
+             pred_table(M:Pred, Table)
+           ),
+           check_saveable(Table)),
+    setup_call_cleanup(
+        open(File, write, Out, [type(binary)]),
+        ( fast_write(Out, swipl_tables(2)),
+          forall(( '$member'(Pred, PredList),
+                   pred_table(M:Pred, Table)
+                 ),
+                 save_table(Out, Table))
+        ),
+        close(Out)).
+
+%!  pred_table(:Pred, -Table) is nondet.
+%
+%   Enumerate the complete tables of Pred as terms
+%   table(Module:Variant, Answer, Generator), where calling Generator
+%   enumerates the answers as instances of Answer and binds its last
+%   argument to the answer's condition.
+
+pred_table(M0:Pred, table(M:Variant, Head, Generator)) :-
+    tabled_head(Pred, Generic0),
+    (   ( predicate_property(M0:Generic0, tabled(incremental))
+        ; predicate_property(M0:Generic0, tabled(monotonic))
+        )
+    ->  functor(Generic0, Name, Arity),
+        permission_error(save, incremental_table, M0:Name/Arity)
+    ;   true
+    ),
+    '$tbl_implementation'(M0:Generic0, M:Generic),
+    current_table(M:Head, Trie),
+    subsumes_term(Generic, Head),
+    '$tbl_table_status'(Trie, complete, M:NonModed, Skeleton),
+    M:'$table_mode'(Head, NonModed, Moded),
+    copy_term(Head, Variant),
+    '$tbl_trienode'(Reserved),
+    (   Moded == Reserved
+    ->  Generator = '$tbl_answer'(Trie, Skeleton)
+    ;   Generator = '$tbl_answer'(Trie, Skeleton, Moded)
+    ).
+
+tabled_head(Name/Arity, Head) :-
+    !,
+    functor(Head, Name, Arity).
+tabled_head(Name//DCGArity, Head) :-
+    !,
+    Arity is DCGArity+2,
+    functor(Head, Name, Arity).
+tabled_head(Head0, Head) :-
+    callable(Head0),
+    !,
+    functor(Head0, Name, Arity),
+    functor(Head, Name, Arity).
+tabled_head(Pred, _) :-
+    type_error(callable_or_predicate_indicator, Pred).
+
+check_saveable(table(Variant, _Head, Generator)) :-
+    (   call(Generator, Condition),
+        Condition \== true
+    ->  permission_error(save, conditional_table, Variant)
+    ;   true
+    ).
+
+save_table(Out, table(Variant, Head, Generator)) :-
+    fast_write(Out, table(Variant)),
+    forall(findnsols(1000, Head, call(Generator, _), Answers),
+           (   Answers == []
+           ->  true
+           ;   fast_write(Out, answers(Answers))
+           )),
+    fast_write(Out, end_of_table).
+
+%!  load_tables(+File) is det.
+%
+%   Restore tables saved  using  save_tables/2.   The  tabled predicates
+%   must be loaded. Each  saved  table  is   re-created  as  a  complete
+%   table by running the normal tabling machinery on the stored answers
+%   rather than the predicate's clauses,   i.e.,  the cost of loading is
+%   proportional to the number of answers. The answers are read in the
+%   batches in which they were saved.  Tables that already exist are
+%   left untouched.
+
+load_tables(File) :-
+    setup_call_cleanup(
+        open(File, read, In, [type(binary)]),
+        ( fast_read(In, Header),
+          (   Header == swipl_tables(2)
+          ->  true
+          ;   domain_error(table_file, File)
+          ),
+          fast_read(In, Table0),
+          load_tables(Table0, In)
+        ),
+        close(In)).
+
+load_tables(end_of_file, _) :-
+    !.
+load_tables(table(M:Variant), In) :-
+    !,
+    load_table(M:Variant, In),
+    fast_read(In, Table),
+    load_tables(Table, In).
+load_tables(Term, _) :-
+    type_error(table, Term).
+
+load_table(M:Head, In) :-
+    current_table(M:Head, _),
+    !,
+    forall(read_answer(In, _), true).
+load_table(M:Head, In) :-
+    '$tbl_trienode'(Reserved),
+    M:'$table_mode'(Head, Variant, Moded),
+    (   Moded == Reserved
+    ->  forall('$tabling':start_tabling(_, M:Head,
+                                        tables:read_answer(In, Head)),
+               true)
+    ;   forall('$tabling':start_moded_tabling(_, M:Head,
+                                              tables:read_answer(In, Head),
+                                              M:Variant, Moded),
+               true)
+    ),
+    (   current_table(M:Head, Trie)     % loading is not a call
+    ->  '$tbl_reset_statistics'(Trie)
+    ;   true
+    ).
+
+:- public
+    read_answer/2.
+
+%!  read_answer(+In, -Answer) is nondet.
+%
+%   Enumerate the answers of the table at  the current position of In,
+%   reading the next batch only after the current one is exhausted.
+
+read_answer(In, Answer) :-
+    fast_read(In, Term),
+    (   Term = answers(Answers)
+    ->  (   '$member'(Answer, Answers)
+        ;   read_answer(In, Answer)
+        )
+    ;   Term == end_of_table
+    ->  fail
+    ;   type_error(table_answers, Term)
     ).
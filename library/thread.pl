@@ -45,11 +45,22 @@
             concurrent_and/3,           % :Generator,:Test,+Options
             first_solution/3,           % -Var, :Goals, +Options
 
-            call_in_thread/2            % +Thread, :Goal
+            call_in_thread/2,           % +Thread, :Goal
+
+            spawn/2,                    % :Goal, -Id
+            spawn/3,                    % :Goal, -Id, +Options
+            green_self/1,               % -Id
+            green_yield/0,
+            green_send/2,               % +Id, +Message
+            green_get_message/1,        % ?Message
+            green_sleep/1,              % +Seconds
+            green_wait_for_input/3,     % +Streams, -Ready, +Timeout
+            green_join/2                % +Id, -Status
           ]).
-:- autoload(library(apply),[maplist/2,maplist/3,maplist/4,maplist/5]).
-:- autoload(library(error),[must_be/2]).
-:- autoload(library(lists),[subtract/3,same_length/2]).
+:- autoload(library(apply),
+            [maplist/2,maplist/3,maplist/4,maplist/5,foldl/4,include/3]).
+:- autoload(library(error),[must_be/2,existence_error/2]).
+:- autoload(library(lists),[subtract/3,same_length/2,append/3]).
 :- autoload(library(option),[option/2, option/3]).
 :- autoload(library(ordsets), [ord_intersection/3]).
 :- autoload(library(debug), [debug/3, assertion/1]).
@@ -66,7 +77,9 @@
     concurrent_and(0, 0),
     concurrent_and(0, 0, +),
     first_solution(-, :, +),
-    call_in_thread(+, 0).
+    call_in_thread(+, 0),
+    spawn(0, -),
+    spawn(0, -, +).
 
 
 :- predicate_options(concurrent/3, 3,
@@ -78,6 +91,10 @@
 :- predicate_options(concurrent_and/3, 3,
                      [ threads(nonneg)
                      ]).
+:- predicate_options(spawn/3, 3,
+                     [ detached(boolean),
+                       pass_to(system:engine_create/4, 4)
+                     ]).
 :- predicate_options(first_solution/3, 3,
                      [ on_fail(oneof([stop,continue])),
                        on_error(oneof([stop,continue])),
@@ -305,23 +322,16 @@ join_all([Id|T]) :-
 %!  concurrent_forall(:Generate, :Action, +Options) is semidet.
 %
 %   True when Action is true for all solutions of Generate. This has the
-%   same semantics as forall/2, but  the   Action  goals are executed in
-%   multiple threads. Notable a failing Action   or a Action throwing an
-%   exception signals the calling  thread  which   in  turn  aborts  all
-%   workers and fails or re-throws the generated error. Options:
+%   same semantics as forall/2, but  the   Action  goals are executed
+%   concurrently by the _work pool_ (see concurrent_maplist/2).  If an
+%   Action fails or raises an exception,  the remaining queued Actions
+%   are discarded and concurrent_forall/3  fails   or  re-throws  the
+%   error.  Actions that are already running are completed. Options:
 %
 %     - threads(+Count)
-%       Number of threads to use.  The default is determined by the
-%       Prolog flag `cpu_count`.
-%
-%   @tbd Ideally we would grow the   set of workers dynamically, similar
-%   to dynamic scheduling of  HTTP  worker   threads.  This  would avoid
-%   creating threads that are never used if Generate is too slow or does
-%   not provide enough answers and  would   further  raise the number of
-%   threads if Action is I/O bound rather than CPU bound.
-
-:- dynamic
-    fa_aborted/1.
+%       Maximum number of Actions in progress at the same time.  The
+%       default is determined by the Prolog flag `cpu_count`.  If
+%       Count is 1, this predicate simply calls forall/2.
 
 concurrent_forall(Generate, Test) :-
     concurrent_forall(Generate, Test, []).
@@ -330,75 +340,52 @@ concurrent_forall(Generate, Test, Options) :-
     jobs(Jobs, Options),
     Jobs > 1,
     !,
-    term_variables(Generate, GVars),
-    term_variables(Test, TVars),
-    sort(GVars, GVarsS),
-    sort(TVars, TVarsS),
-    ord_intersection(GVarsS, TVarsS, Shared),
-    Templ =.. [v|Shared],
-    MaxSize is Jobs*4,
-    message_queue_create(Q, [max_size(MaxSize)]),
-    length(Workers, Jobs),
-    thread_self(Me),
-    maplist(thread_create(fa_worker(Q, Me, Templ, Test)), Workers),
-    catch(( forall(Generate,
-                   thread_send_message(Q, job(Templ))),
-            forall(between(1, Jobs, _),
-                   thread_send_message(Q, done)),
-            maplist(thread_join, Workers),
-            message_queue_destroy(Q)
-          ),
-          Error,
-          fa_cleanup(Error, Workers, Q)).
+    ensure_work_pool,
+    '$wpool_batch'(Batch),
+    message_queue_create(Reply),
+    State = pending(0),
+    call_cleanup(catch(fa_run(Generate, Test, Jobs, Batch, Reply, State),
+                       fa_stop(Result), true),
+                 pool_cleanup(Batch, Reply)),
+    (   var(Result)
+    ->  true
+    ;   Result = error(_, E)
+    ->  throw(E)
+    ;   debug(concurrent(fail), 'Test ~p failed', [Test]),
+        fail
+    ).
 concurrent_forall(Generate, Test, _) :-
     forall(Generate, Test).
 
-fa_cleanup(Error, Workers, Q) :-
-    maplist(safe_abort, Workers),
-    debug(concurrent(fail), 'Joining workers', []),
-    maplist(safe_join, Workers),
-    debug(concurrent(fail), 'Destroying queue', []),
-    retractall(fa_aborted(Q)),
-    message_queue_destroy(Q),
-    (   Error = fa_worker_failed(Test, Why)
-    ->  debug(concurrent(fail), 'Test ~p failed: ~p', [Test, Why]),
-        (   Why == false
-        ->  fail
-        ;   Why = error(E)
-        ->  throw(E)
-        ;   assertion(fail)
-        )
-    ;   throw(Error)
-    ).
-
-fa_worker(Queue, Main, Templ, Test) :-
-    repeat,
-    thread_get_message(Queue, Msg),
-    (   Msg == done
-    ->  !
-    ;   Msg = job(Templ),
-        debug(concurrent, 'Running test ~p', [Test]),
-        (   catch_with_backtrace(Test, E, true)
-        ->  (   var(E)
-            ->  fail
-            ;   fa_stop(Queue, Main, fa_worker_failed(Test, error(E)))
-            )
-        ;   !,
-            fa_stop(Queue, Main, fa_worker_failed(Test, false))
-        )
-    ).
-
-fa_stop(Queue, Main, Why) :-
-    with_mutex('$concurrent_forall',
-               fa_stop_sync(Queue, Main, Why)).
+fa_run(Generate, Test, Jobs, Batch, Reply, State) :-
+    forall(Generate,
+           fa_submit(Test, Jobs, Batch, Reply, State)),
+    arg(1, State, Pending),
+    fa_collect(Pending, Batch, Reply).
+
+%   Submit Test and, if there are more than Jobs tasks in progress, wait
+%   for one of them to complete.
+
+fa_submit(Test, Jobs, Batch, Reply, State) :-
+    '$wpool_submit'(Batch, [task(0, Test, [], Reply)]),
+    arg(1, State, Pending0),
+    Pending1 is Pending0+1,
+    (   Pending1 > Jobs
+    ->  fa_collect(1, Batch, Reply),
+        Pending = Pending0
+    ;   Pending = Pending1
+    ),
+    nb_setarg(1, State, Pending).
 
-fa_stop_sync(Queue, _Main, _Why) :-
-    fa_aborted(Queue),
+fa_collect(0, _, _) :-
     !.
-fa_stop_sync(Queue, Main, Why) :-
-    asserta(fa_aborted(Queue)),
-    debug(concurrent(fail), 'Stop due to ~p. Signalling ~q', [Why, Main]),
-    thread_signal(Main, throw(Why)).
+fa_collect(N, Batch, Reply) :-
+    pool_reply(Batch, Reply, Msg),
+    (   Msg = done(_, _)
+    ->  N1 is N - 1,
+        fa_collect(N1, Batch, Reply)
+    ;   throw(fa_stop(Msg))
+    ).
 
 jobs(Jobs, Options) :-
     (   option(threads(Jobs), Options)
@@ -547,24 +534,33 @@ ca_cleanup(GenThread, Workers, JobQueue, AnswerQueue) :-
 %!  concurrent_maplist(:Goal, +List1, +List2) is semidet.
 %!  concurrent_maplist(:Goal, +List1, +List2, +List3) is semidet.
 %
-%   Concurrent version of maplist/2. This   predicate uses concurrent/3,
-%   using multiple _worker_ threads.  The  number   of  threads  is  the
-%   minimum of the list length and the   number  of cores available. The
-%   number of cores is determined using  the prolog flag =cpu_count=. If
-%   this flag is absent or 1 or List   has  less than two elements, this
-%   predicate calls the corresponding maplist/N  version using a wrapper
-%   based on once/1. Note that all goals   are executed as if wrapped in
-%   once/1 and therefore these predicates are _semidet_.
+%   Concurrent version of maplist/2. The  calls   are  executed by the
+%   _work pool_: a set of  persistent   worker  threads that is created
+%   on first use.  The  number  of   workers  is  the  number  of  cores
+%   available, as determined by the Prolog  flag =cpu_count= at that
+%   moment.  If this flag is absent or 1  or List has less than two
+%   elements, this predicate calls the corresponding maplist/N version
+%   using a wrapper based on once/1. Note  that all goals are executed as
+%   if wrapped in once/1 and therefore these predicates are _semidet_.
 %
-%   Note that the the overhead  of   this  predicate is considerable and
-%   therefore Goal must  be  fairly  expensive   before  one  reaches  a
-%   speedup.
+%   Each worker has a deque of tasks.  Idle workers steal tasks from the
+%   deques of other workers, which balances  the  load if the cost of the
+%   calls varies.  If Goal itself calls  concurrent_maplist/2..4  or
+%   concurrent_forall/2,3, the nested tasks are added to the deque of the
+%   worker running Goal.  This worker runs  these  tasks itself while
+%   waiting for them, so nested calls do not block the pool.
+%
+%   If a call fails or raises an exception, the tasks that are not yet
+%   started are discarded and the predicate  fails or re-throws the
+%   exception.  Calls that are running at that moment are completed.
+%   As the workers are persistent,  thread-local   data  and  global
+%   variables created by Goal are not reclaimed when the call completes.
 
 concurrent_maplist(Goal, List) :-
-    workers(List, WorkerCount),
+    workers(List, _WorkerCount),
     !,
     maplist(ml_goal(Goal), List, Goals),
-    concurrent(WorkerCount, Goals, []).
+    pool_run(Goals).
 concurrent_maplist(M:Goal, List) :-
     maplist(once_in_module(M, Goal), List).
 
@@ -575,10 +571,10 @@ ml_goal(Goal, Elem, call(Goal, Elem)).
 
 concurrent_maplist(Goal, List1, List2) :-
     same_length(List1, List2),
-    workers(List1, WorkerCount),
+    workers(List1, _WorkerCount),
     !,
     maplist(ml_goal(Goal), List1, List2, Goals),
-    concurrent(WorkerCount, Goals, []).
+    pool_run(Goals).
 concurrent_maplist(M:Goal, List1, List2) :-
     maplist(once_in_module(M, Goal), List1, List2).
 
@@ -589,10 +585,10 @@ ml_goal(Goal, Elem1, Elem2, call(Goal, Elem1, Elem2)).
 
 concurrent_maplist(Goal, List1, List2, List3) :-
     same_length(List1, List2, List3),
-    workers(List1, WorkerCount),
+    workers(List1, _WorkerCount),
     !,
     maplist(ml_goal(Goal), List1, List2, List3, Goals),
-    concurrent(WorkerCount, Goals, []).
+    pool_run(Goals).
 concurrent_maplist(M:Goal, List1, List2, List3) :-
     maplist(once_in_module(M, Goal), List1, List2, List3).
 
@@ -614,6 +610,518 @@ same_length([_|T1], [_|T2], [_|T3]) :-
     same_length(T1, T2, T3).
 
 
+                 /*******************************
+                 *           WORK POOL          *
+                 *******************************/
+
+%   The work pool is a set of persistent worker threads that runs tasks
+%   for concurrent_maplist/2..4, concurrent_forall/2,3 and spawn/2.  The
+%   tasks are administered in C, providing a deque per worker and work
+%   stealing.
+%   A task is a term task(Id, Goal, Vars, Reply).  A worker runs Goal as
+%   once/1 and sends done(Id, Vars), failed(Id) or error(Id, Error) to
+%   the message queue Reply.  The tasks submitted by a single call form
+%   a _batch_ that is discarded if one of them fails.
+
+:- dynamic
+    work_pool_created/0.
+
+ensure_work_pool :-
+    work_pool_created,
+    !.
+ensure_work_pool :-
+    with_mutex('$work_pool', create_work_pool).
+
+create_work_pool :-
+    work_pool_created,
+    !.
+create_work_pool :-
+    current_prolog_flag(cpu_count, Count),
+    forall(between(1, Count, _),
+           thread_create(pool_worker, _, [detached(true)])),
+    assertz(work_pool_created).
+
+%   Errors raised outside the tasks are  printed and the worker continues.
+%   If the worker is aborted, the  task  it   was  running  fails, tasks
+%   left in its deque are handed to  the   other  workers and the worker
+%   is replaced by a new one.
+
+pool_worker :-
+    '$wpool_worker'(Index),
+    call_cleanup(pool_work(Index), pool_retire(Index)).
+
+pool_work(Index) :-
+    repeat,
+    catch(( '$wpool_next'(Index, Task),
+            run_task(Task)
+          ), E, pool_error(E)),
+    fail.
+
+pool_error('$aborted') :-
+    !,
+    throw('$aborted').
+pool_error(E) :-
+    print_message(error, unhandled_exception(E)).
+
+pool_retire(Index) :-
+    '$wpool_retire'(Index),
+    catch(thread_create(pool_worker, _, [detached(true)]),
+          error(permission_error(create, thread, _), _),
+          true).                        % halting
+
+run_task(green(Engine, Resume)) :-
+    !,
+    green_step(Engine, Resume).
+run_task(task(Id, Goal, Vars, Reply)) :-
+    setup_call_cleanup(
+        true,
+        ( task_message(Goal, Id, Vars, Msg),
+          task_reply(Reply, Msg),
+          Sent = true
+        ),
+        (   Sent == true
+        ->  true
+        ;   task_reply(Reply, failed(Id))
+        )).
+
+task_message(Goal, Id, Vars, Msg) :-
+    (   catch(Goal, E, true)
+    ->  (   var(E)
+        ->  Msg = done(Id, Vars)
+        ;   Msg = error(Id, E)
+        )
+    ;   Msg = failed(Id)
+    ).
+
+task_reply(Reply, Msg) :-
+    catch(thread_send_message(Reply, Msg),
+          error(existence_error(message_queue, _), _),
+          true).                        % batch was abandoned
+
+%!  pool_run(+Goals) is semidet.
+%
+%   Run Goals on the work pool and wait for all of them to complete.
+
+pool_run(Goals) :-
+    ensure_work_pool,
+    '$wpool_batch'(Batch),
+    message_queue_create(Reply),
+    pool_tasks(Goals, 1, Reply, Tasks, VarList),
+    VT =.. [vars|VarList],
+    length(Tasks, Count),
+    call_cleanup(( '$wpool_submit'(Batch, Tasks),
+                   pool_wait(Count, Batch, Reply, VT, Result)
+                 ),
+                 pool_cleanup(Batch, Reply)),
+    (   Result == true
+    ->  true
+    ;   Result = error(_, Error)
+    ->  throw(Error)
+    ;   fail
+    ).
+
+pool_tasks([], _, _, [], []).
+pool_tasks([Goal|Goals], I, Reply, [task(I, Goal, Vars, Reply)|Tasks],
+           [Vars|VarList]) :-
+    term_variables(Goal, Vars),
+    I2 is I + 1,
+    pool_tasks(Goals, I2, Reply, Tasks, VarList).
+
+pool_wait(0, _, _, _, true) :-
+    !.
+pool_wait(N, Batch, Reply, VT, Result) :-
+    pool_reply(Batch, Reply, Msg),
+    (   Msg = done(Id, Vars)
+    ->  arg(Id, VT, Vars),
+        N2 is N - 1,
+        pool_wait(N2, Batch, Reply, VT, Result)
+    ;   Result = Msg
+    ).
+
+%!  pool_reply(+Batch, +Reply, -Msg) is det.
+%
+%   Wait for the next reply for Batch. If  we are a worker, run the tasks
+%   of Batch that are still in our own deque while waiting.
+
+pool_reply(Batch, Reply, Msg) :-
+    (   thread_get_message(Reply, Msg0, [timeout(0)])
+    ->  Msg = Msg0
+    ;   '$wpool_pop'(Batch, Task)
+    ->  run_task(Task),
+        pool_reply(Batch, Reply, Msg)
+    ;   thread_get_message(Reply, Msg)
+    ).
+
+pool_cleanup(Batch, Reply) :-
+    '$wpool_cancel'(Batch),
+    message_queue_destroy(Reply).
+
+
+                 /*******************************
+                 *         GREEN THREADS        *
+                 *******************************/
+
+%   A green thread is an engine that is  run   by  the work pool.  The
+%   engine runs until it completes or yields one of the terms below, after
+%   which the worker picks up the next task:
+%
+%     - '$green_yield'
+%       Reschedule immediately.
+%     - '$green_receive'(Queue, Pattern)
+%       Suspend until a message is sent to the mailbox Queue.
+%     - '$green_wait'(Streams, Deadline)
+%       Suspend until one of Streams has input or Deadline has passed.
+%       These tasks are handed to the poller thread.
+%
+%   A suspended green thread is resumed by  injecting green(Engine, Resume)
+%   into the work pool.  If Resume is not `none`, it is posted to the
+%   engine.  Green threads are scheduled in FIFO order using batch 0.
+
+:- dynamic
+    green_task/4,                       % Engine, Mailbox, Detached, Goal
+    green_waiting/1,                    % Engine
+    green_exited/2,                     % Engine, Status
+    green_joiner/2,                     % Engine, Joiner
+    green_poller/1.                     % Thread
+
+%!  spawn(:Goal, -Id) is det.
+%!  spawn(:Goal, -Id, +Options) is det.
+%
+%   Run Goal as a _green thread_.  Green threads are engines that are
+%   multiplexed over the threads of the work  pool that is also used by
+%   concurrent_maplist/2.  They are cheap to create and  suspend, which
+%   makes it feasible to run many thousands of them.  Scheduling is
+%   cooperative:  a  green  thread  only  gives  up  its  worker  if it
+%   completes or calls one of green_yield/0, green_get_message/1,
+%   green_sleep/1, green_wait_for_input/3 or green_join/2.  Blocking
+%   calls such as read/1 or thread_get_message/1 block the worker.  Goal
+%   may not yield while inside a callback from C, e.g., with_mutex/2.
+%   Options:
+%
+%     - detached(+Bool)
+%       If `false`, the completion status is kept for green_join/2.
+%       Default is `true`, which prints a warning if Goal fails or
+%       raises an exception.
+%     - alias(+Alias)
+%     - stack_limit(+Bytes)
+%       Passed to engine_create/4.
+
+spawn(Goal, Id) :-
+    spawn(Goal, Id, []).
+
+spawn(Goal, Id, Options) :-
+    option(detached(Detached), Options, true),
+    must_be(boolean, Detached),
+    ensure_work_pool,
+    message_queue_create(Queue),
+    engine_create(Status, green_run(Goal, Status), Id, Options),
+    assertz(green_task(Id, Queue, Detached, Goal)),
+    green_schedule(Id, none).
+
+green_run(Goal, Status) :-
+    (   catch(Goal, E, true)
+    ->  (   var(E)
+        ->  Status = true
+        ;   Status = exception(E)
+        )
+    ;   Status = false
+    ).
+
+green_schedule(Engine, Resume) :-
+    '$wpool_inject'(0, [green(Engine, Resume)]).
+
+%!  green_step(+Engine, +Resume)
+%
+%   Run Engine on the calling worker until it completes or yields.
+
+green_step(Engine, Resume) :-
+    (   Resume == none
+    ->  true
+    ;   engine_post(Engine, Resume)
+    ),
+    (   catch(engine_next(Engine, Event), E, true)
+    ->  (   var(E)
+        ->  true
+        ;   Event = exception(E)
+        )
+    ;   Event = false
+    ),
+    green_event(Event, Engine).
+
+green_event('$green_yield', Engine) :-
+    !,
+    green_schedule(Engine, none).
+green_event('$green_receive'(Queue, Pattern), Engine) :-
+    !,
+    with_mutex('$green',
+               (   thread_peek_message(Queue, Pattern)
+               ->  Ready = true
+               ;   assertz(green_waiting(Engine))
+               )),
+    (   Ready == true
+    ->  green_schedule(Engine, none)
+    ;   true
+    ).
+green_event('$green_wait'(Streams, Deadline), Engine) :-
+    !,
+    ensure_green_poller(Poller),
+    thread_send_message(Poller, wait(Engine, Streams, Deadline)),
+    '$green_wakeup'.
+green_event(Status, Engine) :-
+    green_exit(Engine, Status).
+
+green_exit(Engine, Status) :-
+    with_mutex('$green',
+               (   retract(green_task(Engine, Queue, Detached, Goal)),
+                   (   Detached == true
+                   ->  true
+                   ;   retract(green_joiner(Engine, Joiner))
+                   ->  true
+                   ;   assertz(green_exited(Engine, Status))
+                   )
+               )),
+    message_queue_destroy(Queue),
+    engine_destroy(Engine),
+    (   nonvar(Joiner)
+    ->  green_send(Joiner, '$green_exit'(Engine, Status))
+    ;   Detached == true
+    ->  green_report(Status, Goal)
+    ;   true
+    ).
+
+green_report(true, _) :-
+    !.
+green_report(false, Goal) :-
+    !,
+    print_message(warning, abnormal_thread_completion(Goal, fail)).
+green_report(Status, Goal) :-
+    print_message(warning, abnormal_thread_completion(Goal, Status)).
+
+%!  green_self(-Id) is det.
+%
+%   Id is the green thread we are running  in.  If the caller is not a
+%   green thread, Id is the id of the calling thread.
+
+green_self(Id) :-
+    green_current(Engine, _),
+    !,
+    Id = Engine.
+green_self(Id) :-
+    thread_self(Id).
+
+green_current(Engine, Queue) :-
+    engine_self(Engine),
+    green_task(Engine, Queue, _, _).
+
+%!  green_yield is det.
+%
+%   Allow other green threads to run. Succeeds immediately if the caller
+%   is not a green thread.
+
+green_yield :-
+    green_current(_, _),
+    !,
+    engine_yield('$green_yield').
+green_yield.
+
+%!  green_send(+Id, +Message) is det.
+%
+%   Send Message to the mailbox of the green  thread Id.  If Id is not a
+%   green thread, this is the same as thread_send_message/2.
+
+green_send(Id, Message) :-
+    green_task(Id, Queue, _, _),
+    !,
+    thread_send_message(Queue, Message),
+    (   with_mutex('$green', retract(green_waiting(Id)))
+    ->  green_schedule(Id, none)
+    ;   true
+    ).
+green_send(Id, Message) :-
+    thread_send_message(Id, Message).
+
+%!  green_get_message(?Message) is det.
+%
+%   Get a message that unifies  with  Message   from  the  mailbox of the
+%   calling green thread, suspending the  green   thread  while  no such
+%   message is available.  Outside a green   thread this is the same as
+%   thread_get_message/1.
+
+green_get_message(Message) :-
+    green_current(_, Queue),
+    !,
+    green_receive(Queue, Message).
+green_get_message(Message) :-
+    thread_get_message(Message).
+
+green_receive(Queue, Message) :-
+    (   thread_get_message(Queue, Message, [timeout(0)])
+    ->  true
+    ;   engine_yield('$green_receive'(Queue, Message)),
+        green_receive(Queue, Message)
+    ).
+
+%!  green_sleep(+Seconds) is det.
+%
+%   Suspend the calling green  thread  for   Seconds.  Outside  a green
+%   thread this is the same as sleep/1.
+
+green_sleep(Seconds) :-
+    green_current(_, _),
+    !,
+    green_wait_for_input([], _, Seconds).
+green_sleep(Seconds) :-
+    sleep(Seconds).
+
+%!  green_wait_for_input(+Streams, -Ready, +Timeout) is det.
+%
+%   As wait_for_input/3, but only suspends the  calling green thread.
+%   The streams are watched by a  single   poller  thread. Outside a
+%   green thread this is the same as wait_for_input/3.
+
+green_wait_for_input(Streams, Ready, Timeout) :-
+    green_current(_, _),
+    !,
+    (   Timeout == infinite
+    ->  Deadline = infinite
+    ;   get_time(Now),
+        Deadline is Now + Timeout
+    ),
+    engine_yield('$green_wait'(Streams, Deadline)),
+    engine_fetch(Result),
+    (   Result = ready(Ready0)
+    ->  Ready = Ready0
+    ;   Result = error(E),
+        throw(E)
+    ).
+green_wait_for_input(Streams, Ready, Timeout) :-
+    wait_for_input(Streams, Ready, Timeout).
+
+%!  green_join(+Id, -Status) is det.
+%
+%   Wait for the green thread Id that was created with detached(false)
+%   to complete.  Status is one of `true`, `false` or exception(Term).
+%   If the caller is a green thread, only this green thread is
+%   suspended.
+
+green_join(Id, Status) :-
+    green_self(Me),
+    with_mutex('$green',
+               (   retract(green_exited(Id, Status0))
+               ->  Done = true
+               ;   green_task(Id, _, false, _)
+               ->  assertz(green_joiner(Id, Me))
+               ;   Done = error
+               )),
+    (   Done == true
+    ->  Status = Status0
+    ;   Done == error
+    ->  existence_error(green_thread, Id)
+    ;   green_get_message('$green_exit'(Id, Status))
+    ).
+
+%   The poller thread waits  for  input   on  the  streams of suspended
+%   green threads and for their timeouts.  It is woken through a pipe if
+%   a new request arrives.  If no pipe is available we poll.
+
+ensure_green_poller(Poller) :-
+    green_poller(Poller),
+    !.
+ensure_green_poller(Poller) :-
+    with_mutex('$green', create_green_poller(Poller)).
+
+create_green_poller(Poller) :-
+    green_poller(Poller),
+    !.
+create_green_poller(Poller) :-
+    thread_create(green_poller, Poller, [detached(true)]),
+    assertz(green_poller(Poller)).
+
+green_poller :-
+    (   '$green_wakeup_fd'(FD)
+    ->  Wakeup = [FD]
+    ;   Wakeup = []
+    ),
+    green_poll(Wakeup, []).
+
+green_poll(Wakeup, Waiters0) :-
+    green_requests(Waiters0, Waiters1),
+    green_poll_timeout(Waiters1, Wakeup, Timeout),
+    foldl(green_streams, Waiters1, Wakeup, Streams),
+    catch(wait_for_input(Streams, Ready, Timeout), Error, Ready = []),
+    (   Wakeup = [FD],
+        memberchk(FD, Ready)
+    ->  '$green_drain'
+    ;   true
+    ),
+    get_time(Now),
+    green_resume(Waiters1, Ready, Now, Error, Waiters),
+    green_poll(Wakeup, Waiters).
+
+green_requests(Waiters0, Waiters) :-
+    thread_self(Me),
+    (   thread_get_message(Me, wait(Engine, Streams, Deadline), [timeout(0)])
+    ->  green_requests([w(Engine, Streams, Deadline)|Waiters0], Waiters)
+    ;   Waiters = Waiters0
+    ).
+
+green_streams(w(_, Streams, _), Streams0, All) :-
+    append(Streams, Streams0, All).
+
+green_poll_timeout(Waiters, Wakeup, Timeout) :-
+    foldl(green_deadline, Waiters, infinite, Deadline),
+    (   Deadline == infinite
+    ->  Timeout0 = infinite
+    ;   get_time(Now),
+        Timeout0 is max(0, Deadline-Now)
+    ),
+    (   Wakeup == []
+    ->  (   Timeout0 == infinite
+        ->  Timeout = 0.01
+        ;   Timeout is min(Timeout0, 0.01)
+        )
+    ;   Timeout = Timeout0
+    ).
+
+green_deadline(w(_, _, Deadline), D0, D) :-
+    (   Deadline == infinite
+    ->  D = D0
+    ;   D0 == infinite
+    ->  D = Deadline
+    ;   D is min(D0, Deadline)
+    ).
+
+green_resume([], _, _, _, []).
+green_resume([W|T0], Ready, Now, Error, Waiters) :-
+    W = w(Engine, Streams, Deadline),
+    (   var(Error)
+    ->  include(green_ready(Ready), Streams, Mine),
+        (   Mine \== []
+        ->  Resume = ready(Mine)
+        ;   Deadline \== infinite,
+            Now >= Deadline
+        ->  Resume = ready([])
+        ;   true
+        )
+    ;   catch(wait_for_input(Streams, Mine, 0), E, true)
+    ->  (   nonvar(E)
+        ->  Resume = error(E)
+        ;   Mine \== []
+        ->  Resume = ready(Mine)
+        ;   true
+        )
+    ),
+    (   nonvar(Resume)
+    ->  green_schedule(Engine, Resume),
+        Waiters = Waiters1
+    ;   Waiters = [W|Waiters1]
+    ),
+    green_resume(T0, Ready, Now, Error, Waiters1).
+
+green_ready(Ready, Stream) :-
+    memberchk(Stream, Ready).
+
+
                  /*******************************
                  *             FIRST            *
                  *******************************/
@@ -69,6 +69,14 @@ term(compound, f(1, f(2))).
 term(cyclic, X) :- X = f(X).
 term(list, L) :-
 	numlist(-1000, 1000, L).
+term(large, L) :-			% written/read in chunks
+	numlist(1, 20000, L0),
+	maplist(large_element, L0, L).
+
+large_element(I, f(I, A, S, F, _)) :-
+	atom_concat(a, I, A),
+	number_string(I, S),
+	F is I/3.
 
 :- begin_tests(fastrw, [sto(rational_trees)]).
 
@@ -93,6 +101,23 @@ read_and_check(In, T) :-
 	fast_read(In, T2),
 	assertion(T =@= T2).
 
+test(truncated, error(syntax_error(fastrw_term), _)) :-
+	term(large, T),
+	fast_term_serialized(T, S),
+	string_length(S, Len),
+	Keep is Len - 100,
+	sub_string(S, 0, Keep, _, Truncated),
+	setup_call_cleanup(
+	    tmp_file_stream(binary, File, Out),
+	    write(Out, Truncated),
+	    close(Out)),
+	setup_call_cleanup(
+	    open(File, read, In, [type(binary)]),
+	    fast_read(In, _),
+	    ( close(In),
+	      delete_file(File)
+	    )).
+
 test(error, error(permission_error(fast_serialize, blob, S))) :-
 	setup_call_cleanup(
 	    ( open_null_stream(S),
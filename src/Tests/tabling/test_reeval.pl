@@ -44,7 +44,8 @@
 
 test_reeval :-
     run_tests([ tabling_reeval,
-                tabling_reeval_merged
+                tabling_reeval_merged,
+                tabling_reeval_lazy
               ]).
 
 :- begin_tests(tabling_reeval, [ sto(rational_trees),
@@ -140,3 +141,56 @@ eval(G) :-
     forall(G, true).
 
 :- end_tests(tabling_reeval_merged).
+
+:- begin_tests(tabling_reeval_lazy,
+               [ setup(set_prolog_flag(table_invalidation, lazy)),
+                 cleanup((set_prolog_flag(table_invalidation, eager),
+                          abolish_all_tables))
+               ]).
+
+:- dynamic d/1 as incremental.
+:- table (p/1, q/1) as incremental.
+
+p(X) :- q(X).
+q(X) :- d(X).
+
+:- dynamic md/1 as monotonic.
+:- table mp/1 as monotonic.
+
+mp(X) :- md(X).
+
+% With lazy invalidation assert/1 only marks the dynamic predicate.  The
+% dependent tables are invalidated when they are accessed.
+
+test(deferred, Xs == [1,2,3,4,5]) :-
+    forall(between(1, 2, X), assert(d(X))),
+    answers(X, p(X), [1,2]),
+    forall(between(3, 5, X), assert(d(X))),
+    setof(X, p(X), Xs).
+test(retract, Xs == [2,3]) :-
+    retractall(d(_)),
+    forall(between(1, 3, X), assert(d(X))),
+    answers(X, p(X), [1,2,3]),
+    retract(d(1)),
+    setof(X, p(X), Xs).
+test(status, FalseCount == 1) :-
+    retractall(d(_)),
+    assert(d(1)),
+    answers(X, p(X), [1]),
+    assert(d(2)),
+    current_table(p(_), Trie),
+    '$idg_falsecount'(Trie, FalseCount).
+
+% Retracting from a monotonic predicate is never deferred.  The dependent
+% monotonic tables must be marked before the next assert propagates.
+
+test(monotonic_retract, Xs == [2,3,4]) :-
+    forall(between(1, 3, X), assert(md(X))),
+    answers(X, mp(X), [1,2,3]),
+    current_table(mp(_), Trie),
+    retract(md(1)),
+    '$idg_forced'(Trie),
+    assert(md(4)),
+    setof(X, mp(X), Xs).
+
+:- end_tests(tabling_reeval_lazy).
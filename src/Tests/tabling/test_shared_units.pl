@@ -40,7 +40,8 @@
 :- use_module(library(plunit)).
 
 test_shared_units :-
-    run_tests([ shared_reeval
+    run_tests([ shared_reeval,
+                shared_parallel
               ]).
 
 :- begin_tests(shared_reeval, [sto(rational_trees)]).
@@ -66,3 +67,51 @@ test(propagate_falsecount) :-
     thread_join(Id).
 
 :- end_tests(shared_reeval).
+
+:- begin_tests(shared_parallel,
+               [ setup(set_prolog_flag(table_parallel_completion, true)),
+                 cleanup(set_prolog_flag(table_parallel_completion, false))
+               ]).
+
+:- table (path/2, rpath/2, cpath/2) as shared.
+
+path(X, Y) :- edge(X, Y).
+path(X, Y) :- path(X, Z), edge(Z, Y).
+
+rpath(X, Y) :- edge(X, Y).
+rpath(X, Y) :- rpath(X, Z), rpath(Z, Y).
+
+cpath(X, Y) :- edge(X, Y).
+cpath(X, Y) :- cpath(X, Z), flag(cpath_steps, N, N+1), cpath(Z, Y).
+
+edge(X, Y) :- between(1, 100, X), Y is X+1.
+edge(100, 1).
+
+concurrent_count(Goal, N, Counts) :-
+    abolish_all_tables,
+    length(Ids, N),
+    maplist(count_thread(Goal), Ids),
+    maplist(join_count, Ids, Counts).
+
+count_thread(Goal, Id) :-
+    thread_create(( aggregate_all(count, Goal, Count),
+                    thread_exit(Count)
+                  ), Id).
+
+join_count(Id, Count) :-
+    thread_join(Id, exited(Count)).
+
+test(left_recursion, Counts == [101,101,101,101]) :-
+    concurrent_count(path(1,_), 4, Counts).
+test(bail_out, Counts == [101,101,101,101]) :-
+    concurrent_count(rpath(1,_), 4, Counts).
+test(bail_out_once, Steps == Steps1) :-
+    abolish_all_tables,
+    flag(cpath_steps, _, 0),
+    aggregate_all(count, cpath(1,_), _),
+    flag(cpath_steps, Steps1, 0),
+    concurrent_count(cpath(1,_), 4, Counts),
+    assertion(Counts == [101,101,101,101]),
+    flag(cpath_steps, Steps, 0).
+
+:- end_tests(shared_parallel).
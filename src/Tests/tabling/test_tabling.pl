@@ -37,6 +37,8 @@
 :- use_module(tabling_testlib).
 :- use_module(library(plunit)).
 :- use_module(library(debug)).
+:- use_module(library(aggregate)).
+:- use_module(library(tables)).
 
 test_tabling :-
     run_tests([ tabling_ex1,
@@ -77,7 +79,11 @@ test_tabling :-
                 pathss,
 
                 bas,
-                push_ret
+                push_ret,
+                eviction,
+                persistent,
+                subsumptive,
+                table_statistics
 	      ]).
 
 		 /*******************************
@@ -1351,6 +1357,191 @@ test(push_ret, MaxSteps1 == MaxSteps2) :-
 
 :- end_tests(push_ret).
 
+:- begin_tests(eviction, [cleanup(abolish_all_tables)]).
+
+:- table evict_lru/2 as eviction(lru).
+:- table evict_cost/2 as eviction(cost).
+:- table evict_slow/2 as eviction(cost).
+
+evict_lru(N, X) :- between(1, 1 000, I), X is N*10 000+I.
+evict_cost(N, X) :- between(1, 1 000, I), X is N*10 000+I.
+evict_slow(N, X) :-                     % even tables are expensive
+    (   even(N)
+    ->  sleep(0.02)
+    ;   true
+    ),
+    between(1, 1 000, I), X is N*10 000+I.
+
+with_table_space(Space, Goal) :-
+    current_prolog_flag(table_space, Old),
+    setup_call_cleanup(
+        set_prolog_flag(table_space, Space),
+        Goal,
+        ( abolish_all_tables,
+          set_prolog_flag(table_space, Old) )).
+
+all_counts(P, Counts) :-
+    findall(C, ( between(1, 200, N),
+                 aggregate_all(count, call(P, N, _), C)
+               ), Counts0),
+    sort(Counts0, Counts).
+
+%   Create tables P(1,_), P(2,_), ... until this causes eviction,
+%   calling Touch after each table.  Evicted is the list of evicted
+%   tables.
+
+fill_until_evicted(P, Touch, Evicted) :-
+    between(1, 1 000, N),
+    aggregate_all(count, call(P, N, _), _),
+    call(Touch),
+    evicted_tables(P, N, Evicted),
+    Evicted \== [],
+    !.
+
+evicted_tables(P, Max, Evicted) :-
+    findall(N, ( between(1, Max, N),
+                 Goal =.. [P,N,_],
+                 \+ current_table(Goal, _)
+               ), Evicted).
+
+test(property, Policy == lru) :-
+    predicate_property(evict_lru(_,_), tabled(eviction(Policy))).
+test(lru, Counts == [1 000]) :-
+    with_table_space(2 000 000, all_counts(evict_lru, Counts)).
+test(cost, Counts == [1 000]) :-
+    with_table_space(2 000 000, all_counts(evict_cost, Counts)).
+test(lru_order, Evicted == Oldest) :-
+    with_table_space(2 000 000,
+                     fill_until_evicted(evict_lru,
+                                        aggregate_all(count, evict_lru(1,_), _),
+                                        Evicted)),
+    last(Evicted, Last),
+    numlist(2, Last, Oldest).
+test(cost_order, Expensive == []) :-
+    with_table_space(2 000 000,
+                     fill_until_evicted(evict_slow, true, Evicted)),
+    include(even, Evicted, Expensive).
+
+even(N) :- N mod 2 =:= 0.
+
+:- end_tests(eviction).
+
+:- begin_tests(persistent, [cleanup(abolish_all_tables)]).
+
+:- table pst_path/2, pst_min(_,_,min), pst_num/1, pst_undefined/1.
+:- table pst_incr/1 as incremental.
+:- dynamic pst_calls/1.
+:- dynamic([pst_fact/1], [incremental(true)]).
+
+pst_edge(1,2). pst_edge(2,3). pst_edge(3,1).
+
+pst_path(X,Y) :- assertz(pst_calls(X)), pst_edge(X,Y).
+pst_path(X,Y) :- pst_path(X,Z), pst_edge(Z,Y).
+
+pst_min(X,Y,1) :- pst_edge(X,Y).
+pst_min(X,Y,D) :- pst_min(X,Z,D0), pst_edge(Z,Y), D is D0+1.
+
+pst_num(X) :- between(1, 2500, X).
+
+pst_undefined(X) :- member(X, [1,2]), tnot(pst_undefined(X)).
+
+pst_incr(X) :- pst_fact(X).
+pst_fact(1).
+
+save_load(Preds, Goal, Answers0, Answers, Calls) :-
+    tmp_file_stream(binary, File, Out), close(Out),
+    findall(Goal, Goal, Answers0),
+    call_cleanup(
+        ( save_tables(File, Preds),
+          abolish_all_tables,
+          retractall(pst_calls(_)),
+          load_tables(File),
+          findall(Goal, Goal, Answers),
+          aggregate_all(count, pst_calls(_), Calls)
+        ),
+        delete_file(File)).
+
+test(variant, [A==A0, Calls==0]) :-
+    save_load([pst_path/2], pst_path(1,_), A00, A1, Calls),
+    msort(A00, A0), msort(A1, A).
+test(moded, [A==A0, A==[pst_min(1,1,3),pst_min(1,2,1),pst_min(1,3,2)]]) :-
+    save_load([pst_min/3], pst_min(1,_,_), A00, A1, _),
+    msort(A00, A0), msort(A1, A).
+test(batches, [A==A0, Count==2500]) :-
+    save_load([pst_num/1], pst_num(_), A00, A1, _),
+    msort(A00, A0), msort(A1, A),
+    length(A, Count).
+test(statistics, [Calls-Reused-Time == 1-1-none]) :-
+    save_load([pst_path/2], pst_path(1,_), _, _, _),
+    table_statistics(pst_path(1,_), Stats),
+    memberchk(calls(Calls), Stats),
+    memberchk(reused(Reused), Stats),
+    (   memberchk(completion_time(Time), Stats)
+    ->  true
+    ;   Time = none
+    ).
+test(conditional, error(permission_error(save, conditional_table, _))) :-
+    forall(pst_undefined(_), true),
+    tmp_file_stream(binary, File, Out), close(Out),
+    call_cleanup(save_tables(File, [pst_undefined/1]),
+                 delete_file(File)).
+test(incremental, error(permission_error(save, incremental_table, _))) :-
+    forall(pst_incr(_), true),
+    tmp_file_stream(binary, File, Out), close(Out),
+    call_cleanup(save_tables(File, [pst_incr/1]),
+                 delete_file(File)).
+
+:- end_tests(persistent).
+
+:- begin_tests(subsumptive, [cleanup(abolish_all_tables)]).
+
+:- table sub_p/2 as subsumptive.
+
+sub_p(X, Y) :- member(X-Y, [a-1, a-2, b-3, c-c]).
+
+sub_tables(Count) :-
+    aggregate_all(count, current_table(_:sub_p(_,_), _), Count).
+
+test(general, [A-Count == [1,2]-1]) :-
+    abolish_all_tables,
+    forall(sub_p(_,_), true),
+    findall(Y, sub_p(a,Y), A),
+    sub_tables(Count).
+test(specific, [A-Count == [a]-2]) :-
+    abolish_all_tables,
+    forall(sub_p(a,_), true),
+    findall(X, sub_p(X,1), A),
+    sub_tables(Count).
+test(shared_var, [A-Count == [c]-2]) :-
+    abolish_all_tables,
+    findall(X, sub_p(X,X), A),
+    aggregate_all(count, sub_p(_,_), 4),
+    sub_tables(Count).
+
+:- end_tests(subsumptive).
+
+:- begin_tests(table_statistics, [cleanup(abolish_all_tables)]).
+
+:- table tstat_path/2.
+
+tstat_edge(1,2). tstat_edge(2,3). tstat_edge(3,1).
+
+tstat_path(X,Y) :- tstat_edge(X,Y).
+tstat_path(X,Y) :- tstat_path(X,Z), tstat_edge(Z,Y).
+
+test(stats, [Answers-SCC-Reused == 3-1-1]) :-
+    abolish_all_tables,
+    forall(tstat_path(1,_), true),
+    forall(tstat_path(1,_), true),
+    table_statistics(tstat_path(1,_), Stats),
+    memberchk(answers(Answers), Stats),
+    memberchk(scc_size(SCC), Stats),
+    memberchk(reused(Reused), Stats),
+    memberchk(completion_time(Time), Stats),
+    assertion(Time >= 0.0).
+
+:- end_tests(table_statistics).
+
 
 		 /*******************************
 		 *	      COMMON		*
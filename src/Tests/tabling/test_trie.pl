@@ -40,6 +40,7 @@
 :- use_module(library(plunit)).
 :- use_module(library(apply)).
 :- use_module(library(lists)).
+:- use_module(library(aggregate)).
 :- use_module(library(debug)).
 
 test_trie :-
@@ -126,10 +127,45 @@ test(delete, Keys == [aap,mies]) :-
 	assertion(N==n),
 	findall(K, trie_gen(T, K, _), Keys0),
 	sort(Keys0, Keys).
+test(fanout, Counts == [2-1,4-2,5-3,16-8,17-9,40-20]) :-
+	findall(N-Left,
+		( member(N, [2,4,5,16,17,40]),
+		  trie_new(T),
+		  forall(between(1, N, I), trie_insert(T, f(I), I)),
+		  forall(( between(1, N, I), I mod 2 =:= 0 ),
+			 trie_delete(T, f(I), I)),
+		  assertion(\+ trie_gen(T, f(2), _)),
+		  assertion(trie_gen(T, f(1), 1)),
+		  aggregate_all(count, trie_gen(T, _), Left)
+		),
+		Counts).
+test(replaced_children, S1 == S2) :-
+	trie_new(T1),
+	forall(member(K, [x,y]), trie_insert(T1, K, K)),
+	fill_trie(T1, a, 5),
+	trie_property(T1, size(S0)),
+	trie_new(T2),
+	forall(member(K, [x,y]), trie_insert(T2, K, K)),
+	once(( trie_gen(T2, _, _),		% trie is in use
+	       fill_trie(T2, a, 5)
+	     )),
+	assertion((trie_property(T2, size(S)), S > S0)),
+	fill_trie(T1, b, 5),
+	fill_trie(T2, b, 5),
+	trie_property(T1, size(S1)),
+	trie_property(T2, size(S2)).
 test(gen_indirect, true) :-
 	trie_new(T),
 	trie_insert(T, 0.25, true),
 	trie_gen(T, 0.25).
+test(concurrent_insert, [condition(current_prolog_flag(threads, true)),
+			  Added-Keys == 4000-4000]) :-
+	trie_new(T),
+	length(Ids, 4),
+	maplist(insert_thread(T), Ids),
+	maplist(join_added, Ids, AddedList),
+	sum_list(AddedList, Added),
+	aggregate_all(count, trie_gen(T, _), Keys).
 test(var1, set(Y == [1,2,3])) :-
         test_var(_, Y).
 test(var2, set(Y == [1,2])) :-
@@ -142,6 +178,17 @@ shared_list(N, t(List,N)) :-
 	reverse(List, R),
 	R = List.
 
+insert_thread(T, Id) :-
+	thread_create(( aggregate_all(count,
+				      ( between(1, 4000, I),
+					trie_insert(T, k(I))
+				      ), Added),
+			thread_exit(Added)
+		      ), Id).
+
+join_added(Id, Added) :-
+	thread_join(Id, exited(Added)).
+
 test_var(X, Y) :-
 	trie_new(T),
 	trie_insert(T, f(_, 1)),
@@ -150,3 +197,9 @@ test_var(X, Y) :-
 	trie_gen(T, f(X, Y)).
 
 :- end_tests(trie).
+
+fill_trie(T, F, N) :-
+	forall(between(1, N, I),
+	       ( Key =.. [F,I],
+		 trie_insert(T, Key, I)
+	       )).
@@ -0,0 +1,88 @@
+/*  Part of SWI-Prolog
+
+    Author:        agent
+    E-mail:        agent@local
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, agent
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+:- module(test_local_slots,
+	  [ test_local_slots/0
+	  ]).
+:- use_module(library(modules)).
+
+/** <module> Test reuse of thread-local predicate slots
+
+Thread-local predicates that are destroyed  together with a temporary
+module must release their slot, and  a   thread  that  cached the old
+predicate in its slot array must not see it through the new predicate
+that reuses the slot.
+*/
+
+test_local_slots :-
+	thread_create(helper, Helper, []),
+	call_cleanup(test_local_slots(Helper, 100),
+		     ( thread_send_message(Helper, done),
+		       thread_join(Helper, _))).
+
+test_local_slots(Helper, N) :-
+	'$thread_local_slots'(C0),
+	forall(between(1, N, I),
+	       in_temporary_module(M,
+				   thread_local(M:p/1),
+				   use_slot(M, I, Helper))),
+	'$thread_local_slots'(C1),
+	(   C1 =< C0+1
+	->  true
+	;   format(user_error, 'Slots: ~D --> ~D~n', [C0, C1]),
+	    fail
+	).
+
+use_slot(M, I, Helper) :-
+	assertz(M:p(I)),
+	findall(X, M:p(X), [I]),
+	thread_self(Me),
+	thread_send_message(Helper, run(M, I, Me)),
+	thread_get_message(Reply),
+	Reply == true.
+
+helper :-
+	thread_get_message(Msg),
+	(   Msg = run(M, I, Client)
+	->  (   \+ M:p(_),
+		assertz(M:p(I)),
+		findall(X, M:p(X), [I])
+	    ->  Reply = true
+	    ;   Reply = false
+	    ),
+	    thread_send_message(Client, Reply),
+	    helper
+	;   true
+	).
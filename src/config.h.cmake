@@ -96,6 +96,7 @@
 #cmakedefine HAVE_LOCALTIME_S @HAVE_LOCALTIME_S@
 #cmakedefine HAVE_MACH_O_RLD_H @HAVE_MACH_O_RLD_H@
 #cmakedefine HAVE_MACH_THREAD_ACT_H @HAVE_MACH_THREAD_ACT_H@
+#cmakedefine HAVE_MADVISE @HAVE_MADVISE@
 #cmakedefine HAVE_MALLOC_H @HAVE_MALLOC_H@
 #cmakedefine HAVE_MBSCASECOLL @HAVE_MBSCASECOLL@
 #cmakedefine HAVE_MBSCOLL @HAVE_MBSCOLL@
@@ -180,6 +181,7 @@
 #cmakedefine HAVE_SYSCONF @HAVE_SYSCONF@
 #cmakedefine HAVE_SYSCTLBYNAME @HAVE_SYSCTLBYNAME@
 #cmakedefine HAVE_SYS_DIR_H @HAVE_SYS_DIR_H@
+#cmakedefine HAVE_SYS_EVENTFD_H @HAVE_SYS_EVENTFD_H@
 #cmakedefine HAVE_SYS_FILE_H @HAVE_SYS_FILE_H@
 #cmakedefine HAVE_SYS_MMAN_H @HAVE_SYS_MMAN_H@
 #cmakedefine HAVE_SYS_NDIR_H @HAVE_SYS_NDIR_H@
@@ -2344,7 +2344,7 @@ poll(struct pollfd *pfd, int nfds, int timeout)
 
 typedef struct fdentry
 { SOCKET fd;
-  term_t stream;
+  term_t stream;			/* 0: wakeup of watched queues */
 } fdentry;
 
 #define FASTMAP_SIZE 32
@@ -2385,6 +2385,12 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
   size_t count;
   int i, nfds;
   int rc = FALSE;
+#ifdef O_QUEUE_WAKEUP
+  queue_watch watch_buf[FASTMAP_SIZE];
+  queue_watch *watches = watch_buf;
+  term_t qterms = 0;
+  int nwatches = 0;
+#endif
 
   term_t timeout = A3;
 
@@ -2397,18 +2403,18 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
       return PL_type_error("list", A1);
   }
 
-  if ( count <= FASTMAP_SIZE )
+  if ( count < FASTMAP_SIZE )		/* reserve one for the wakeup */
     map = map_buf;
-  else if ( !(map = malloc(count*sizeof(*map))) )
+  else if ( !(map = malloc((count+1)*sizeof(*map))) )
     return PL_no_memory();
-  memset(map, 0, count*sizeof(*map));
+  memset(map, 0, (count+1)*sizeof(*map));
 
 #ifdef HAVE_POLL
-  if ( count <= FASTMAP_SIZE )
+  if ( count < FASTMAP_SIZE )
     poll_map = poll_buf;
-  else if ( !(poll_map = malloc(count*sizeof(*poll_map))) )
+  else if ( !(poll_map = malloc((count+1)*sizeof(*poll_map))) )
     return PL_no_memory();
-  memset(poll_map, 0, count*sizeof(*poll_map));
+  memset(poll_map, 0, (count+1)*sizeof(*poll_map));
 #else
 #ifdef __WINDOWS__
   if ( count > FD_SETSIZE )
@@ -2427,6 +2433,24 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
 
     if ( PL_get_integer(head, &ifd) )
     { fd = ifd;
+#ifdef O_QUEUE_WAKEUP
+    } else if ( PL_is_functor(head, FUNCTOR_message_queue1) )
+    { if ( !qterms )
+      { if ( count > FASTMAP_SIZE &&
+	     !(watches = malloc(count*sizeof(*watches))) )
+	{ PL_no_memory();
+	  goto out;
+	}
+	if ( !(qterms = PL_new_term_refs((int)count)) )
+	  goto out;
+      }
+      _PL_get_arg(1, head, ahead);
+      if ( !watch_message_queue(ahead, &watches[nwatches] PASS_LD) )
+	goto out;
+      PL_put_term(qterms+nwatches, head);
+      nwatches++;
+      continue;
+#endif
     } else
     { if ( !PL_get_stream(head, &s, SIO_INPUT) )
 	goto out;
@@ -2461,6 +2485,24 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
 #endif
   }
 
+#ifdef O_QUEUE_WAKEUP
+  if ( nwatches > 0 )
+  { drain_thread_wakeup(PASS_LD1);
+    for(i=0; i<nwatches; i++)
+    { if ( message_queue_has_input(&watches[i]) )
+      { if ( !PL_unify_list(available, ahead, available) ||
+	     !PL_unify(ahead, qterms+i) )
+	  goto out;
+	from_buffer++;
+      }
+    }
+    map[nfds].fd = thread_wakeup_fd(PASS_LD1);
+    map[nfds].stream = 0;
+    ADD_FD(nfds);
+    nfds++;
+  }
+#endif
+
   if ( from_buffer > 0 )
   { rc = PL_unify_nil(available);
     goto out;
@@ -2566,7 +2608,21 @@ PRED_IMPL("wait_for_input", 3, wait_for_input, 0)
     default: /* Something happend -> check fds */
     { for(i=0; i<nfds; i++)
       { if ( IS_SETFD(i) )
-	{ if ( !PL_unify_list(available, ahead, available) ||
+	{
+#ifdef O_QUEUE_WAKEUP
+	  if ( !map[i].stream )
+	  { int j;
+
+	    for(j=0; j<nwatches; j++)
+	    { if ( message_queue_has_input(&watches[j]) &&
+		   ( !PL_unify_list(available, ahead, available) ||
+		     !PL_unify(ahead, qterms+j) ) )
+		goto out;
+	    }
+	    continue;
+	  }
+#endif
+	  if ( !PL_unify_list(available, ahead, available) ||
 	       !PL_unify(ahead, map[i].stream) )
 	    goto out;
 	}
@@ -2584,6 +2640,12 @@ out:
   if ( poll_map != poll_buf )
     free(poll_map);
 #endif
+#ifdef O_QUEUE_WAKEUP
+  while( nwatches > 0 )
+    unwatch_message_queue(&watches[--nwatches]);
+  if ( watches != watch_buf )
+    free(watches);
+#endif
 
   return rc;
 }
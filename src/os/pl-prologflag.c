@@ -882,6 +882,10 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
       { rval = setAutoload(a);
       } else if ( k == ATOM_table_monotonic )
       { rval = setMonotonicMode(a);
+      } else if ( k == ATOM_table_invalidation )
+      { rval = setInvalidationMode(a);
+      } else if ( k == ATOM_stack_hugepages )
+      { rval = set_stack_hugepages(value);
 #if O_XOS
       } else if ( k == ATOM_win_file_access_check )
       { rval = set_win_file_access_check(value);
@@ -902,6 +906,10 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 
       if ( !PL_get_int64_ex(value, &i) )
 	return FALSE;
+#ifdef O_PLMT
+      if ( k == ATOM_engine_pool_size && (i < 0 || i > INT_MAX) )
+	return PL_domain_error("engine_pool_size", value);
+#endif
       f->value.i = i;
 
 #ifdef O_ATOMGC
@@ -916,6 +924,9 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 	  LD->tabling.node_pool->limit = (size_t)i;
       }
 #ifdef O_PLMT
+      else if ( k == ATOM_engine_pool_size )
+      { GD->thread.engine_pool.size = (int)i;
+      }
       else if ( k == ATOM_shared_table_space )
       { if ( !GD->tabling.node_pool )
 	{ alloc_pool *pool = new_alloc_pool("shared_table_space", i);
@@ -938,6 +949,13 @@ set_prolog_flag_unlocked(Module m, atom_t k, term_t value, int flags ARG_LD)
 
       if ( !PL_get_float_ex(value, &d) )
 	return FALSE;
+#ifdef O_CONTENTION_STATISTICS
+      if ( k == ATOM_mutex_wait_threshold )
+      { if ( d < 0.0 )
+	  return PL_domain_error("not_less_than_zero", value);
+	GD->thread.mutex_samples.threshold = (uint64_t)(d*1e9);
+      }
+#endif
       f->value.f = d;
       break;
     }
@@ -1181,6 +1199,8 @@ unify_prolog_flag_value(Module m, atom_t key, prolog_flag *f, term_t val)
   { return PL_unify_atom(val, accessLevel());
   } else if ( key == ATOM_stack_limit )
   { return PL_unify_int64(val, LD->stacks.limit);
+  } else if ( key == ATOM_stack_hugepages )
+  { return PL_unify_atom(val, stack_hugepages_atom(LD->stacks.hugepages));
   } else if ( tbl_is_restraint_flag(key) )
   { return tbl_get_restraint_flag(val, key PASS_LD) == TRUE;
   } else if ( is_arith_flag(key) )
@@ -1472,8 +1492,13 @@ initPrologFlags(void)
   setPrologFlag("table_space", FT_INTEGER, GD->options.tableSpace);
 #ifdef O_PLMT
   setPrologFlag("shared_table_space", FT_INTEGER, GD->options.sharedTableSpace);
+  setPrologFlag("engine_pool_size", FT_INTEGER, GD->thread.engine_pool.size);
+#endif
+#ifdef O_CONTENTION_STATISTICS
+  setPrologFlag("mutex_wait_threshold", FT_FLOAT, 0.0);
 #endif
   setPrologFlag("stack_limit", FT_INTEGER, LD->stacks.limit);
+  setPrologFlag("stack_hugepages", FT_ATOM, "false");
 #if defined(HAVE_DLOPEN) || defined(HAVE_SHL_LOAD) || defined(EMULATE_DLOPEN)
   setPrologFlag("open_shared_object",	  FT_BOOL|FF_READONLY, TRUE, 0);
   setPrologFlag("shared_object_extension",	  FT_ATOM|FF_READONLY, SO_EXT);
@@ -1624,6 +1649,10 @@ initPrologFlags(void)
   setPrologFlag("table_incremental", FT_BOOL, FALSE, PLFLAG_TABLE_INCREMENTAL);
   setPrologFlag("table_subsumptive", FT_BOOL, FALSE, 0);
   setPrologFlag("table_shared",      FT_BOOL, FALSE, PLFLAG_TABLE_SHARED);
+#ifdef O_PLMT
+  setPrologFlag("table_parallel_completion", FT_BOOL, FALSE,
+		PLFLAG_TABLE_PARALLEL);
+#endif
 
   setTmpDirPrologFlag();
   setTZPrologFlag();
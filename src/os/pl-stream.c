@@ -135,7 +135,17 @@ static IOSTREAM *	Sopen_buffer(IOSTREAM *s, char *buf, size_t size);
 static void		Sclose_buffer(IOSTREAM *s);
 
 #ifdef O_PLMT
+#ifdef simpleMutexTryLock		/* see O_CONTENTION_STATISTICS */
+extern void Slock_wait(recursiveMutex *m);
+#define SLOCK(s)    if ( s->mutex ) Slock_mutex(s->mutex)
+static inline void
+Slock_mutex(recursiveMutex *m)
+{ if ( recursiveMutexTryLock(m) == EBUSY )
+    Slock_wait(m);
+}
+#else
 #define SLOCK(s)    if ( s->mutex ) recursiveMutexLock(s->mutex)
+#endif
 #define SUNLOCK(s)  if ( s->mutex ) recursiveMutexUnlock(s->mutex)
 static inline int
 STRYLOCK(IOSTREAM *s)
@@ -60,7 +60,6 @@
 #define ALLOC_NEW_MAGIC  0xF9
 #endif
 
-
 		 /*******************************
 		 *	    USE BOEHM GC	*
 		 *******************************/
@@ -1364,6 +1363,8 @@ initAlloc(void)
   GC_set_warn_proc(heap_gc_warn_proc);
 #endif
 
+  initSlabs();
+
 #if defined(HAVE_MTRACE) && defined(O_MAINTENANCE)
   if ( getenv("MALLOC_TRACE") )		/* glibc malloc tracer */
     mtrace();
@@ -1391,9 +1392,14 @@ properly on Linux. Don't bother with it.
 #ifdef  MMAP_STACK
 #define MMAP_THRESHOLD 32768
 
+#define MAP_REGION_MALLOC  0		/* Allocated using malloc() */
+#define MAP_REGION_MMAP	   1		/* Allocated using mmap() */
+#define MAP_REGION_HUGETLB 2		/* Allocated using mmap(MAP_HUGETLB) */
+
 typedef struct
 { size_t size;				/* Size (including header) */
-  int	 mmapped;			/* Is mmapped? */
+  int	 mmapped;			/* MAP_REGION_* */
+  int	 hugepages;			/* Requested STACK_HP_* */
   double data[1];			/* ensure alignment */
 } map_region;
 
@@ -1409,6 +1415,42 @@ pgsize(void)
   return sz;
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+hpgsize() returns the size of a huge page.   Regions that are allocated
+using MAP_HUGETLB must be a multiple of this   size  and can only be
+truncated at this granularity.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+hpgsize(void)
+{ static size_t sz = 0;
+
+  if ( !sz )
+  { size_t hsz = 2*1024*1024;		/* x86_64 and aarch64 default */
+#ifdef __linux__
+    FILE *fd;
+
+    if ( (fd=fopen("/proc/meminfo", "r")) )
+    { char buf[256];
+      unsigned long kb;
+
+      while( fgets(buf, sizeof(buf), fd) )
+      { if ( sscanf(buf, "Hugepagesize: %lu kB", &kb) == 1 )
+	{ hsz = (size_t)kb*1024;
+	  break;
+	}
+      }
+      fclose(fd);
+    }
+#endif
+    if ( hsz < pgsize() )
+      hsz = pgsize();
+    sz = hsz;
+  }
+
+  return sz;
+}
+
 static inline size_t
 roundpgsize(size_t sz)
 { size_t r = pgsize();
@@ -1416,63 +1458,121 @@ roundpgsize(size_t sz)
   return ((sz+r-1)/r)*r;
 }
 
-size_t
-tmp_nalloc(size_t req)
-{ if ( req < MMAP_THRESHOLD-SA_OFFSET )
-    return req;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+map_size() computes the size of  a   new  mmapped region that holds req
+bytes (including the header). Explicit huge   pages  are only used for
+regions of at least one huge page.
+
+region_size() computes the  new  size  if   `reg`  is  reallocated. If the
+request fits the current region it is truncated  in place, which is at
+the granularity at which the region was mapped.  Otherwise it is moved
+to a new region that is created according to `hp`.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+map_size(size_t req, int hp)
+{ if ( hp == STACK_HP_EXPLICIT && req >= hpgsize() )
+  { size_t r = hpgsize();
+
+    return ((req+r-1)/r)*r;
+  }
 
-  return roundpgsize(req+SA_OFFSET)-SA_OFFSET;
+  return roundpgsize(req);
 }
 
-size_t
-tmp_nrealloc(void *mem, size_t req)
-{ if ( mem )
-  { map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
+static size_t
+region_size(map_region *reg, size_t req, int hp)
+{ size_t sz;
 
-    if ( !reg->mmapped && req < MMAP_THRESHOLD-SA_OFFSET )
-      return req;
+  if ( reg->mmapped == MAP_REGION_HUGETLB )
+  { size_t r = hpgsize();
 
-    return roundpgsize(req+SA_OFFSET)-SA_OFFSET;
+    sz = ((req+r-1)/r)*r;
+  } else
+  { sz = roundpgsize(req);
   }
 
-  return tmp_nalloc(req);
+  if ( sz <= reg->size )
+    return sz;
+
+  return map_size(req, hp);
 }
 
+static void
+advise_hugepages(void *mem, size_t size, int hp)
+{
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+  if ( hp != STACK_HP_NONE )
+    madvise(mem, size, MADV_HUGEPAGE);
+#else
+  (void)mem;
+  (void)size;
+  (void)hp;
+#endif
+}
 
-size_t
-tmp_malloc_size(void *mem)
+static size_t
+map_nalloc(size_t req, int hp)
+{ if ( req < MMAP_THRESHOLD-SA_OFFSET )
+    return req;
+
+  return map_size(req+SA_OFFSET, hp)-SA_OFFSET;
+}
+
+static size_t
+map_nrealloc(void *mem, size_t req, int hp)
 { if ( mem )
   { map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
-    return reg->size-SA_OFFSET;
+
+    if ( !reg->mmapped )
+      return map_nalloc(req, hp);
+
+    return region_size(reg, req+SA_OFFSET, hp)-SA_OFFSET;
   }
 
-  return 0;
+  return map_nalloc(req, hp);
 }
 
-void *
-tmp_malloc(size_t req)
+static void *
+map_malloc(size_t req, int hp)
 { map_region *reg;
   int mmapped;
 
   req += SA_OFFSET;
   if ( req < MMAP_THRESHOLD )
   { reg = malloc(req);
-    mmapped = FALSE;
+    mmapped = MAP_REGION_MALLOC;
   } else
-  { req = roundpgsize(req);
-
-    reg = mmap(NULL, req,
-	       (PROT_READ|PROT_WRITE),
-	       (MAP_PRIVATE|MAP_ANONYMOUS),
-	       -1, 0);
+  { req = map_size(req, hp);
+    reg = MAP_FAILED;
+    mmapped = MAP_REGION_MMAP;
+
+#ifdef MAP_HUGETLB
+    if ( hp == STACK_HP_EXPLICIT && req%hpgsize() == 0 )
+    { reg = mmap(NULL, req,
+		 (PROT_READ|PROT_WRITE),
+		 (MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB),
+		 -1, 0);
+      if ( reg != MAP_FAILED )
+	mmapped = MAP_REGION_HUGETLB;
+    }
+#endif
+    if ( reg == MAP_FAILED )		/* no (more) reserved huge pages */
+    { reg = mmap(NULL, req,
+		 (PROT_READ|PROT_WRITE),
+		 (MAP_PRIVATE|MAP_ANONYMOUS),
+		 -1, 0);
+      if ( reg != MAP_FAILED )
+	advise_hugepages(reg, req, hp);
+    }
     if ( reg == MAP_FAILED )
       reg = NULL;
-    mmapped = TRUE;
   }
 
   if ( reg )
-  { reg->size    = req;
-    reg->mmapped = mmapped;
+  { reg->size      = req;
+    reg->mmapped   = mmapped;
+    reg->hugepages = hp;
 #ifdef O_DEBUG
     memset(reg->data, 0xFB, req-SA_OFFSET);
 #endif
@@ -1484,8 +1584,8 @@ tmp_malloc(size_t req)
 }
 
 
-void *
-tmp_realloc(void *mem, size_t req)
+static void *
+map_realloc(void *mem, size_t req, int hp)
 { if ( mem )
   { map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
 
@@ -1499,7 +1599,7 @@ tmp_realloc(void *mem, size_t req)
 	}
 	return NULL;
       } else				/* malloc --> mmap */
-      { void *nw = tmp_malloc(req-SA_OFFSET);
+      { void *nw = map_malloc(req-SA_OFFSET, hp);
 	if ( nw )
 	{ size_t copy = reg->size;
 
@@ -1512,7 +1612,7 @@ tmp_realloc(void *mem, size_t req)
 	return nw;
       }
     } else
-    { req = roundpgsize(req);
+    { req = region_size(reg, req, hp);
 
       if ( reg->size != req )
       { if ( reg->size > req )
@@ -1523,7 +1623,7 @@ tmp_realloc(void *mem, size_t req)
 
 	  return reg->data;
 	} else
-	{ void *ra = tmp_malloc(req);
+	{ void *ra = map_malloc(req-SA_OFFSET, hp);
 
 	  if ( ra )
 	  { memcpy(ra, mem, reg->size-SA_OFFSET);
@@ -1541,11 +1641,63 @@ tmp_realloc(void *mem, size_t req)
       }
     }
   } else
-  { return tmp_malloc(req);
+  { return map_malloc(req, hp);
   }
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+map_hugepages() changes the huge page  policy   of  an existing region.
+This is immediate for transparent huge  pages.   A  region that is not
+mapped using MAP_HUGETLB is only moved to   explicit huge pages if it is
+reallocated (stack shift).
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+map_hugepages(void *mem, int hp)
+{ if ( mem )
+  { map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
+
+    if ( reg->mmapped == MAP_REGION_MMAP )
+    { if ( reg->hugepages == STACK_HP_NONE )
+	advise_hugepages(reg, reg->size, hp);
+      reg->hugepages = hp;
+    }
+  }
+}
+
+
+size_t
+tmp_nalloc(size_t req)
+{ return map_nalloc(req, STACK_HP_NONE);
+}
+
+size_t
+tmp_nrealloc(void *mem, size_t req)
+{ return map_nrealloc(mem, req, STACK_HP_NONE);
+}
+
+
+size_t
+tmp_malloc_size(void *mem)
+{ if ( mem )
+  { map_region *reg = (map_region *)((char*)mem-SA_OFFSET);
+    return reg->size-SA_OFFSET;
+  }
+
+  return 0;
+}
+
+void *
+tmp_malloc(size_t req)
+{ return map_malloc(req, STACK_HP_NONE);
+}
+
+void *
+tmp_realloc(void *mem, size_t req)
+{ return map_realloc(mem, req, STACK_HP_NONE);
+}
+
 void
 tmp_free(void *mem)
 { if ( mem )
@@ -1636,11 +1788,24 @@ tmp_free(void *mem)
   free(sp);
 }
 
+#define map_nalloc(req, hp)	   tmp_nalloc(req)
+#define map_nrealloc(mem, req, hp) tmp_nrealloc(mem, req)
+#define map_malloc(req, hp)	   tmp_malloc(req)
+#define map_realloc(mem, req, hp)  tmp_realloc(mem, req)
+#define map_hugepages(mem, hp)	   (void)0
+
 #endif /*MMAP_STACK*/
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The stack_*() functions allocate the  Prolog   stacks  for  the calling
+thread. LD->stacks.hugepages decides whether these are backed by huge
+pages.  See the Prolog flag `stack_hugepages`.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 void *
 stack_malloc(size_t size)
-{ void *ptr = tmp_malloc(size);
+{ GET_LD
+  void *ptr = map_malloc(size, LD->stacks.hugepages);
 
   if ( ptr )
     ATOMIC_ADD(&GD->statistics.stack_space, tmp_malloc_size(ptr));
@@ -1650,8 +1815,9 @@ stack_malloc(size_t size)
 
 void *
 stack_realloc(void *mem, size_t size)
-{ size_t osize = tmp_malloc_size(mem);
-  void *ptr = tmp_realloc(mem, size);
+{ GET_LD
+  size_t osize = tmp_malloc_size(mem);
+  void *ptr = map_realloc(mem, size, LD->stacks.hugepages);
 
   if ( ptr )
   { size = tmp_malloc_size(ptr);
@@ -1675,12 +1841,21 @@ stack_free(void *mem)
 
 size_t
 stack_nalloc(size_t req)
-{ return tmp_nalloc(req);
+{ GET_LD
+
+  return map_nalloc(req, LD->stacks.hugepages);
 }
 
 size_t
 stack_nrealloc(void *mem, size_t req)
-{ return tmp_nrealloc(mem, req);
+{ GET_LD
+
+  return map_nrealloc(mem, req, LD->stacks.hugepages);
+}
+
+void
+stack_hugepages(void *mem, int hp)
+{ map_hugepages(mem, hp);
 }
 
 
@@ -126,11 +126,13 @@ COMMON(void *)		tmp_realloc(void *mem, size_t req);
 COMMON(void)		tmp_free(void *mem);
 COMMON(size_t)		tmp_nalloc(size_t req);
 COMMON(size_t)		tmp_nrealloc(void *mem, size_t req);
+COMMON(size_t)		tmp_malloc_size(void *mem);
 COMMON(void *)		stack_malloc(size_t req);
 COMMON(void *)		stack_realloc(void *mem, size_t req);
 COMMON(void)		stack_free(void *mem);
 COMMON(size_t)		stack_nalloc(size_t req);
 COMMON(size_t)		stack_nrealloc(void *mem, size_t req);
+COMMON(void)		stack_hugepages(void *mem, int hp);
 #ifndef xmalloc
 COMMON(void *)		xmalloc(size_t size);
 COMMON(void *)		xrealloc(void *mem, size_t size);
@@ -37,14 +37,24 @@
 #include "pl-incl.h"
 #include "pl-allocpool.h"
 
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Allocation pools account for memory that   is  allocated for a specific
+purpose, such as the nodes of   tries  that represent tables. Pools can
+have a limit, in which case   alloc_from_pool() raises a resource error
+if the limit is exceeded.  If the pool  has a reclaim() function, this
+is called first to free memory  from   the  pool.  Pools without a limit
+only provide usage statistics.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 alloc_pool *
 new_alloc_pool(const char *name, size_t limit)
 { alloc_pool *p = malloc(sizeof(*p));
 
   if ( p )
-  { memset(p, 0, sizeof(*p));
-    p->limit = limit;
-    p->name  = name;
+  { init_alloc_pool(p, name, limit);
   } else
   { PL_resource_error("memory");
   }
@@ -52,6 +62,13 @@ new_alloc_pool(const char *name, size_t limit)
   return p;
 }
 
+void
+init_alloc_pool(alloc_pool *pool, const char *name, size_t limit)
+{ memset(pool, 0, sizeof(*pool));
+  pool->limit = limit;
+  pool->name  = name;
+}
+
 void
 free_alloc_pool(alloc_pool *pool)
 { pool->freed = TRUE;
@@ -65,24 +82,27 @@ alloc_from_pool(alloc_pool *pool, size_t bytes)
 { void *mem;
 
   if ( pool )
-  { if ( pool->size+bytes <= pool->limit )
-    { ATOMIC_ADD(&pool->size, bytes);
-    } else
-    { PL_resource_error(pool->name);
-      return NULL;
+  { while( pool->size+bytes > pool->limit )
+    { if ( !pool->reclaim || !(*pool->reclaim)(pool, bytes) )
+      { PL_resource_error(pool->name);
+	return NULL;
+      }
     }
+    ATOMIC_ADD(&pool->size, bytes);
   }
 
-  if ( (mem=malloc(bytes)) )
+  if ( (mem=slab_alloc(bytes)) )
     return mem;
 
+  if ( pool )
+    ATOMIC_SUB(&pool->size, bytes);
   PL_resource_error("memory");
   return NULL;
 }
 
 void
 free_to_pool(alloc_pool *pool, void *mem, size_t bytes)
-{ free(mem);
+{ slab_free(mem, bytes);
 
   if ( pool )
   { assert(bytes <= pool->size);
@@ -91,3 +111,255 @@ free_to_pool(alloc_pool *pool, void *mem, size_t bytes)
       free(pool);
   }
 }
+
+
+		 /*******************************
+		 *	  SLAB ALLOCATOR	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The slab allocator serves objects of   up  to SLAB_MAX_SIZE bytes from
+size classes that are a multiple of   SLAB_GRANULE. Each class carves
+objects from SLAB_CHUNK_SIZE chunks and  keeps   a  free list that is
+shared by all threads and protected by  a   mutex.  Each thread keeps a
+cache of free objects per class in   LD->slab.  Allocation and freeing
+use this cache without locking.  The cache   is refilled from and, if it
+grows too large, returned to the   shared  free list in batches of
+SLAB_BATCH objects.
+
+Objects are not owned by a thread:  an   object  that is freed by another
+thread than the one that allocated it  simply   ends  up in the cache of
+the freeing thread.  This is notably the   case  for clauses and clause
+references that are reclaimed by the  gc   thread.  Threads without a
+Prolog engine and terminating threads use   the  shared free list. Slab
+chunks are never returned to the OS.
+
+Memory is accounted to the thread  (heap_allocated, see
+thread_resource_usage/2) when it refills   its  cache rather than for
+each object, keeping this off the fast path.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_SLAB_ALLOC
+
+#define SLAB_CHUNK_SIZE	(64*1024)	/* Chunk carved into objects */
+#define SLAB_BATCH	32		/* # objects moved at once */
+#define SLAB_CACHE_MAX	(2*SLAB_BATCH)	/* Max # objects in thread cache */
+
+typedef struct slab_class
+{ simpleMutex	mutex;			/* Protect the fields below */
+  slab_object  *free;			/* Free list shared by all threads */
+  char	       *top;			/* Free part of the current chunk */
+  char	       *max;			/* End of the current chunk */
+} slab_class;
+
+static slab_class slab_classes[SLAB_CLASSES];
+static size_t	  slab_chunk_space = 0;
+
+#define SLAB_CLASS(bytes)   (((bytes)+SLAB_GRANULE-1)/SLAB_GRANULE - 1)
+#define SLAB_OBJ_SIZE(i)    (((size_t)(i)+1)*SLAB_GRANULE)
+
+void
+initSlabs(void)
+{ int i;
+
+  for(i=0; i<SLAB_CLASSES; i++)
+    simpleMutexInit(&slab_classes[i].mutex);
+}
+
+
+/* get_slab_objects() returns a list of at most `n` objects of class `i`,
+ * preferably from the shared free list.  `*got` is set to the length of
+ * the list.
+ */
+
+static slab_object *
+get_slab_objects(int i, unsigned int n, unsigned int *got)
+{ slab_class *sc = &slab_classes[i];
+  size_t osize = SLAB_OBJ_SIZE(i);
+  slab_object *list = NULL;
+  unsigned int count = 0;
+
+  simpleMutexLock(&sc->mutex);
+  while( count < n && sc->free )
+  { slab_object *o = sc->free;
+
+    sc->free = o->next;
+    o->next = list;
+    list = o;
+    count++;
+  }
+  while( count < n )
+  { slab_object *o;
+
+    if ( (size_t)(sc->max - sc->top) < osize )
+    { char *chunk;
+
+      if ( !(chunk = malloc(SLAB_CHUNK_SIZE)) )
+	break;
+      ATOMIC_ADD(&slab_chunk_space, SLAB_CHUNK_SIZE);
+      sc->top = chunk;
+      sc->max = chunk+SLAB_CHUNK_SIZE;
+    }
+
+    o = (slab_object*)sc->top;
+    sc->top += osize;
+    o->next = list;
+    list = o;
+    count++;
+  }
+  simpleMutexUnlock(&sc->mutex);
+
+  *got = count;
+  return list;
+}
+
+
+static void
+put_slab_objects(int i, slab_object *head, slab_object *tail)
+{ slab_class *sc = &slab_classes[i];
+
+  simpleMutexLock(&sc->mutex);
+  tail->next = sc->free;
+  sc->free = head;
+  simpleMutexUnlock(&sc->mutex);
+}
+
+
+/* release_slab_objects() moves the first `n` objects of class `i` from
+ * the thread cache to the shared free list.
+ */
+
+static void
+release_slab_objects(slab_cache *cache, int i, unsigned int n)
+{ slab_object *head = cache->free[i];
+  slab_object *tail = head;
+  unsigned int k;
+
+  for(k=1; k<n; k++)
+    tail = tail->next;
+
+  cache->free[i]   = tail->next;
+  cache->count[i] -= n;
+  put_slab_objects(i, head, tail);
+}
+
+
+void *
+slab_alloc(size_t bytes)
+{ if ( bytes > 0 && bytes <= SLAB_MAX_SIZE )
+  { GET_LD
+    int i = SLAB_CLASS(bytes);
+    unsigned int got;
+    slab_object *o;
+
+    if ( LD && !LD->slab.closed )
+    { slab_cache *cache = &LD->slab;
+
+      if ( (o=cache->free[i]) )
+      { cache->free[i] = o->next;
+	cache->count[i]--;
+      } else if ( (o=get_slab_objects(i, SLAB_BATCH, &got)) )
+      { cache->free[i] = o->next;
+	cache->count[i] = got-1;
+	LD->accounting.usage.heap_allocated += got*SLAB_OBJ_SIZE(i);
+      }
+    } else
+    { o = get_slab_objects(i, 1, &got);
+    }
+
+    return o;
+  } else
+  { void *mem = malloc(bytes);
+    GET_LD
+
+    if ( mem && LD )			/* see thread_resource_usage/2 */
+      LD->accounting.usage.heap_allocated += bytes;
+
+    return mem;
+  }
+}
+
+
+void
+slab_free(void *mem, size_t bytes)
+{ if ( !mem )
+    return;
+
+  if ( bytes > 0 && bytes <= SLAB_MAX_SIZE )
+  { GET_LD
+    int i = SLAB_CLASS(bytes);
+    slab_object *o = mem;
+
+    if ( LD && !LD->slab.closed )
+    { slab_cache *cache = &LD->slab;
+
+      o->next = cache->free[i];
+      cache->free[i] = o;
+      if ( ++cache->count[i] > SLAB_CACHE_MAX )
+	release_slab_objects(cache, i, SLAB_BATCH);
+    } else
+    { put_slab_objects(i, o, o);
+    }
+  } else
+  { free(mem);
+  }
+}
+
+
+/* flush_slab_cache() is called if a thread terminates.  It returns all
+ * cached objects to the shared free lists.
+ */
+
+void
+flush_slab_cache(slab_cache *cache)
+{ int i;
+
+  cache->closed = TRUE;
+  for(i=0; i<SLAB_CLASSES; i++)
+  { if ( cache->count[i] )
+      release_slab_objects(cache, i, cache->count[i]);
+  }
+}
+
+
+size_t
+slab_space(void)
+{ return slab_chunk_space;
+}
+
+#else /*O_SLAB_ALLOC*/
+
+void
+initSlabs(void)
+{
+}
+
+void *
+slab_alloc(size_t bytes)
+{ void *mem = malloc(bytes);
+  GET_LD
+
+  if ( mem && LD )			/* see thread_resource_usage/2 */
+    LD->accounting.usage.heap_allocated += bytes;
+
+  return mem;
+}
+
+void
+slab_free(void *mem, size_t bytes)
+{ (void)bytes;
+
+  free(mem);
+}
+
+void
+flush_slab_cache(slab_cache *cache)
+{ cache->closed = TRUE;
+}
+
+size_t
+slab_space(void)
+{ return 0;
+}
+
+#endif /*O_SLAB_ALLOC*/
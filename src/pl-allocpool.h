@@ -37,16 +37,52 @@
 #ifndef _PL_ALLOCPOOL_H
 #define _PL_ALLOCPOOL_H
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Small objects that are allocated from a pool  are served by a size-class
+slab allocator with per-thread caches.  This is disabled for Boehm-GC as
+the collector must see all memory and for address sanitizer builds that
+need to track individual objects.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if !defined(O_SLAB_ALLOC) && !defined(HAVE_BOEHM_GC) && \
+    !defined(__SANITIZE_ADDRESS__) && !ALLOC_DEBUG
+#define O_SLAB_ALLOC 1
+#endif
+
+#define SLAB_GRANULE	16		/* Size classes are multiples */
+#define SLAB_CLASSES	16		/* # size classes */
+#define SLAB_MAX_SIZE	(SLAB_GRANULE*SLAB_CLASSES)
+
 typedef struct alloc_pool
 { size_t	size;				/* Current allocation */
   size_t	limit;				/* Limit */
   const char   *name;				/* for appropriate error */
   int		freed;				/* Pool is freed */
+					/* Free memory if limit is reached */
+  int	      (*reclaim)(struct alloc_pool *pool, size_t bytes);
 } alloc_pool;
 
+typedef struct slab_object
+{ struct slab_object *next;			/* Next free object */
+} slab_object;
+
+typedef struct slab_cache
+{ slab_object  *free[SLAB_CLASSES];		/* Thread-local free lists */
+  unsigned int	count[SLAB_CLASSES];		/* Length of the free lists */
+  int		closed;				/* Thread is terminating */
+} slab_cache;
+
 COMMON(alloc_pool*)	new_alloc_pool(const char *name, size_t limit);
+COMMON(void)		init_alloc_pool(alloc_pool *pool,
+					const char *name, size_t limit);
 COMMON(void)		free_alloc_pool(alloc_pool *pool);
 COMMON(void *)		alloc_from_pool(alloc_pool *pool, size_t bytes);
 COMMON(void)		free_to_pool(alloc_pool *pool, void *mem, size_t bytes);
 
+COMMON(void)		initSlabs(void);
+COMMON(void *)		slab_alloc(size_t bytes);
+COMMON(void)		slab_free(void *mem, size_t bytes);
+COMMON(void)		flush_slab_cache(slab_cache *cache);
+COMMON(size_t)		slab_space(void);
+
 #endif /*_PL_ALLOCPOOL_H*/
@@ -1795,7 +1795,7 @@ Finish up the clause.
       goto exit_fail;
     }
 
-    cl = PL_malloc_atomic(size);
+    cl = allocClause(size);
     ATOMIC_ADD(&m->code_size, clsize);
     memcpy(cl, &clause, sizeofClause(0));
     memcpy(cl->codes, baseBuffer(&ci.codes, code), sizeOfBuffer(&ci.codes));
@@ -7046,7 +7046,7 @@ PRED_IMPL("$vm_assert", 3, vm_assert, PL_FA_TRANSPARENT)
     discardBuffer(&ci.codes);
     return rc;
   }
-  cl = PL_malloc_atomic(size);
+  cl = allocClause(size);
   ATOMIC_ADD(&m->code_size, clsize);
   memcpy(cl, &clause, sizeofClause(0));
   GD->statistics.codes += clause.code_size;
@@ -401,6 +401,7 @@ DECL_PLIST(cont);
 DECL_PLIST(trie);
 DECL_PLIST(tabling);
 DECL_PLIST(mutex);
+DECL_PLIST(workpool);
 DECL_PLIST(zip);
 DECL_PLIST(cbtrace);
 DECL_PLIST(wrap);
@@ -472,6 +473,7 @@ initBuildIns(void)
   REG_PLIST(trie);
   REG_PLIST(tabling);
   REG_PLIST(mutex);
+  REG_PLIST(workpool);
   REG_PLIST(zip);
   REG_PLIST(cbtrace);
   REG_PLIST(wrap);
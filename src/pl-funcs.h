@@ -131,7 +131,7 @@ COMMON(void)		clearTriedIndexes(Definition def);
 COMMON(void)		unallocClauseIndexTable(ClauseIndex ci);
 COMMON(void)		deleteActiveClauseFromIndexes(Definition def, Clause cl);
 COMMON(bool)		unify_index_pattern(Procedure proc, term_t value);
-COMMON(void)		deleteIndexes(ClauseList cl, int isnew);
+COMMON(void)		deleteIndexes(Definition def, ClauseList cl, int isnew);
 COMMON(void)		deleteIndexesDefinition(Definition def);
 COMMON(int)		checkClauseIndexSizes(Definition def, int nindexable);
 COMMON(void)		checkClauseIndexes(Definition def);
@@ -455,6 +455,7 @@ COMMON(bool)		abolishProcedure(Procedure proc, Module module);
 COMMON(int)		retract_clause(Clause clause, gen_t gen ARG_LD);
 COMMON(bool)		retractClauseDefinition(Definition def, Clause clause,
 						int notify);
+COMMON(Clause)		allocClause(size_t size);
 COMMON(void)		unallocClause(Clause c);
 COMMON(void)		freeClause(Clause c);
 COMMON(void)		lingerClauseRef(ClauseRef c);
@@ -567,6 +568,7 @@ COMMON(bool)		unifyKey(term_t key, word val);
 COMMON(int)		getKeyEx(term_t key, word *k ARG_LD);
 COMMON(word)		pl_term_complexity(term_t t, term_t mx, term_t count);
 COMMON(void)		markAtomsRecord(Record record);
+COMMON(int)		mayUnifyRecord(Record r, term_t t ARG_LD);
 
 /* pl-rl.c */
 COMMON(void)		install_rl(void);
@@ -593,10 +595,15 @@ COMMON(bool)		restoreStack(Stack s);
 COMMON(void)		trimStacks(int resize ARG_LD);
 COMMON(void)		emptyStacks(void);
 COMMON(void)		freeStacks(ARG1_LD);
+COMMON(int)		poolStacks(ARG1_LD);
+COMMON(void)		freeStackPool(void);
 COMMON(void)		freePrologLocalData(PL_local_data_t *ld);
 COMMON(int)		ensure_room_stack(Stack s, size_t n, int ex);
 COMMON(int)		trim_stack(Stack s);
 COMMON(int)		set_stack_limit(size_t limit);
+COMMON(int)		get_stack_hugepages(term_t t, int *hp);
+COMMON(atom_t)		stack_hugepages_atom(int hp);
+COMMON(int)		set_stack_hugepages(term_t t);
 COMMON(const char *)	signal_name(int sig);
 
 /* pl-sys.c */
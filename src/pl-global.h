@@ -154,10 +154,18 @@ struct PL_global_data
     int		threads_finished;	/* # finished threads */
     int		engines_created;	/* # engines created */
     int		engines_finished;	/* # engines threads */
+    double	engine_create_time;	/* Total time spent creating engines */
     double	thread_cputime;		/* Total CPU time of threads */
 #endif
   } statistics;
 
+  struct				/* Accounting for small objects */
+  { alloc_pool	clauses;		/* Clause */
+    alloc_pool	clause_refs;		/* ClauseRef */
+    alloc_pool	records;		/* Record and RecordRef */
+    alloc_pool	messages;		/* Message queue entries */
+  } alloc_pools;
+
 #ifdef O_PROFILE
   struct
   { struct PL_local_data *thread;	/* Thread being profiled */
@@ -184,6 +192,11 @@ struct PL_global_data
     pthread_cond_t cvar;
 #endif
     struct trie_array *waiting;		/* thread --> trie we are waiting for */
+    struct
+    { struct tbl_help_job *jobs;	/* Jobs for helping threads */
+      size_t	queued;			/* # jobs waiting for a helper */
+      int	waiting;		/* # threads willing to help */
+    } help;
   } tabling;
 #endif
 
@@ -342,6 +355,7 @@ struct PL_global_data
   { ClauseRef	lingering;		/* Unlinked clause refs */
     size_t	lingering_count;	/* # Unlinked clause refs */
     int		cgc_active;		/* CGC is running */
+    unsigned int cgc_considered;	/* # considerClauseGC() scans skipped */
     int64_t	cgc_count;		/* # clause GC calls */
     int64_t	cgc_reclaimed;		/* # clauses reclaimed */
     double	cgc_time;		/* Total time spent in CGC */
@@ -386,6 +400,32 @@ struct PL_global_data
     int			highest_id;	/* Highest Id of life thread  */
     int			peak_id;	/* Highest Id of any thread  */
     PL_thread_info_t  **threads;	/* Pointers to thread-info */
+    int			ldata_accessing; /* # threads with access.ldata */
+    struct
+    { unsigned int	count;		/* # thread-local predicate slots */
+      unsigned int	generation;	/* Last issued slot generation */
+      struct free_local_slot *free;	/* Slots of destroyed predicates */
+    } local_slots;
+    struct
+    { struct stack_set *stacks;	/* Stacks of retired engines */
+      struct PL_local_data *ldata;	/* Local data of retired engines */
+      int		stack_count;	/* # stack sets in the pool */
+      int		ldata_count;	/* # local data in the pool */
+      int		size;		/* Max retired engines kept (flag) */
+      int		reused;		/* # engines created from the pool */
+    } engine_pool;
+#ifdef O_CONTENTION_STATISTICS
+    struct
+    { uint64_t		threshold;	/* Sample waits longer than (nsec) */
+      simpleMutex	lock;		/* Guards the ring */
+      unsigned int	next;		/* Next slot in ring */
+      struct mutex_sample *ring;	/* Recent slow waits */
+    } mutex_samples;
+    struct
+    { unsigned int	collisions;	/* # contended stream locks */
+      mutex_waits	waits;		/* Time spent waiting */
+    } stream_locks;
+#endif
     struct
     { pthread_mutex_t	mutex;
       pthread_cond_t	cond;
@@ -428,6 +468,7 @@ struct PL_local_data
 #endif
   Code		fast_condition;		/* Fast condition support */
   pl_stacks_t   stacks;			/* Prolog runtime stacks */
+  slab_cache	slab;			/* Thread cache for small objects */
   uintptr_t	bases[STG_MASK+1];	/* area base addresses */
   int		alerted;		/* Special mode. See updateAlerted() */
   int		slow_unify;		/* do not use inline unification */
@@ -523,6 +564,15 @@ struct PL_local_data
     double	system_cputime;		/* Kernel saved CPU time */
   } statistics;
 
+  struct
+  { resource_usage usage;		/* Cumulative resource usage */
+    resource_usage base;		/* Usage at last reset */
+    resource_limits limits;		/* Limits on usage - base */
+    int64_t	check_at;		/* Check limits at #inferences */
+    int		discards;		/* Maintain global_discarded */
+    uint64_t	global_discarded;	/* Global bytes discarded by backtracking */
+  } accounting;
+
 #ifdef O_GMP
   struct
   { int		persistent;		/* do persistent operations */
@@ -615,6 +665,11 @@ struct PL_local_data
     int flags;				/* Global flags (TF_*) */
     term_t delay_list;			/* Global delay list */
     term_t idg_current;			/* Current node in IDG (trie symbol) */
+    Table idg_pending;			/* Deferred IDG propagation (symbols) */
+#ifdef O_PLMT
+    int helping;			/* Engine helps completing a table */
+    struct PL_local_data *help_engine;	/* Engine to help completing tables */
+#endif
     struct
     { atom_t max_table_subgoal_size_action;
       size_t max_table_subgoal_size;
@@ -707,9 +762,16 @@ struct PL_local_data
     struct _thread_sig   *sig_head;	/* Head of signal queue */
     struct _thread_sig   *sig_tail;	/* Tail of signal queue */
     DefinitionChain local_definitions;	/* P_THREAD_LOCAL predicates */
+    struct
+    { local_slot       *entries;	/* Localised, by local_definitions.slot */
+      unsigned int	size;		/* Allocated size of entries */
+    } local_slots;
     simpleMutex scan_lock;		/* Hold for asynchronous scans */
     thread_wait_for *waiting_for;	/* thread_wait/2 info */
     alert_channel alert;		/* How to alert the thread */
+#ifdef O_QUEUE_WAKEUP
+    thread_wakeup *wakeup;		/* thread_get_message_any/4 wakeup */
+#endif
   } thread;
 #endif
 
@@ -811,6 +811,7 @@ typedef enum
 #define	ALERT_WAKEUP	     0x040
 #define	ALERT_DEBUG	     0x080
 #define	ALERT_BUFFER	     0x100
+#define	ALERT_RESOURCES	     0x200
 
 
 		 /*******************************
@@ -1354,6 +1355,25 @@ typedef struct gc_stat
   gc_reason_t	reason;			/* why GC was run */
 } gc_stat;
 
+typedef struct resource_usage
+{ double	cputime;		/* User CPU time (seconds) */
+  int64_t	inferences;		/* # inferences */
+  uint64_t	global_allocated;	/* Bytes allocated on the global stack */
+  uint64_t	heap_allocated;		/* Bytes allocated using allocHeap() */
+  uint64_t	records;		/* # records created */
+  uint64_t	record_bytes;		/* Size of these records */
+  uint64_t	messages_sent;		/* # messages sent */
+  uint64_t	messages_received;	/* # messages received */
+  uint64_t	queue_wait;		/* Blocked in message queues (nsec) */
+  uint64_t	mutex_wait;		/* Blocked on mutexes (nsec) */
+} resource_usage;
+
+typedef struct resource_limits
+{ uint64_t	heap;			/* Max heap_allocated (0: none) */
+  double	cpu;			/* Max cputime (0.0: none) */
+  int64_t	inferences;		/* Max inferences (0: none) */
+} resource_limits;
+
 typedef struct gc_stats
 { gc_stat	last[GC_STAT_WINDOW_SIZE];
   gc_stat	aggr[GC_STAT_WINDOW_SIZE];
@@ -1459,9 +1479,16 @@ struct clause_index
 
 typedef struct local_definitions
 { Definition *blocks[MAX_BLOCKS];
+  unsigned int slot;			/* Index in LD->thread.local_slots */
+  unsigned int generation;		/* Validates cached slot entries */
   Definition preallocated[7];
 } local_definitions;
 
+typedef struct local_slot
+{ Definition definition;		/* Localised definition */
+  unsigned int generation;		/* local_definitions.generation */
+} local_slot;
+
 struct definition
 { FunctorDef	functor;		/* Name/Arity of procedure */
   Module	module;			/* module of the predicate */
@@ -1804,6 +1831,11 @@ struct module
   ListCell	lingering;	/* Lingering definitions */
   size_t	code_size;	/* #Bytes used for its procedures */
   size_t	code_limit;	/* Limit for code_size */
+  struct
+  { size_t	clauses;	/* #Bytes in (non-erased) clauses */
+    size_t	indexes;	/* #Bytes in clause index tables */
+    size_t	tables;		/* #Bytes in answer tries */
+  } memory;
 #ifdef O_PLMT
   counting_mutex *mutex;	/* Mutex to guard module modifications */
   struct thread_wait_area *wait;/* Manage waiting threads */
@@ -2012,6 +2044,9 @@ typedef struct
 #define SIG_CLAUSE_GC	  (SIG_PROLOG_OFFSET+3)
 #define SIG_PLABORT	  (SIG_PROLOG_OFFSET+4)
 #define SIG_TUNE_GC	  (SIG_PROLOG_OFFSET+5)
+#ifdef O_PLMT
+#define SIG_RESOURCES	  (SIG_PROLOG_OFFSET+6)
+#endif
 
 
 		 /*******************************
@@ -2060,8 +2095,13 @@ this to enlarge the runtime stacks.  Otherwise use the stack-shifter.
 
 struct stack STACK(caddress);		/* Anonymous stack */
 
+#define STACK_HP_NONE		0	/* Use normal pages */
+#define STACK_HP_TRANSPARENT	1	/* madvise(MADV_HUGEPAGE) */
+#define STACK_HP_EXPLICIT	2	/* mmap(MAP_HUGETLB) if possible */
+
 typedef struct
 { size_t limit;				/* Total stack limit */
+  int	 hugepages;			/* STACK_HP_* */
   struct STACK(LocalFrame) local;	/* local (environment) stack */
   struct STACK(Word)	   global;	/* local (environment) stack */
   struct STACK(TrailEntry) trail;	/* trail stack */
@@ -2418,6 +2458,7 @@ typedef struct debuginfo
 #define PLFLAG_TABLE_SHARED	    0x10000000 /* By default shared tabling */
 #define PLFLAG_RATIONAL		    0x20000000 /* Natural rational numbers */
 #define PLFLAG_DEBUG_ON_INTERRUPT   0x40000000 /* Debug on Control-C */
+#define PLFLAG_TABLE_PARALLEL	    0x80000000 /* Help completing shared tables */
 
 typedef struct
 { unsigned int flags;		/* Fast access to some boolean Prolog flags */
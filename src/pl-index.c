@@ -660,12 +660,37 @@ newClauseIndexTable(iarg_t *hap, hash_hints *hints, IndexContext ctx)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Maintain Module->memory.indexes for the   top-level  indexes of a predicate.
+This is updated when the  index  is  added   to  or  removed  from  the
+predicate, i.e., while the module is known to be alive.  Deep indexes on
+clause lists are not accounted for.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static size_t
+sizeofClauseIndexTable(ClauseIndex ci)
+{ return sizeof(*ci) + ci->buckets * sizeof(struct clause_bucket);
+}
+
+static void
+accountClauseIndex(Definition def, ClauseList cl, ClauseIndex ci, int add)
+{ Module m;
+
+  if ( def && cl == &def->impl.clauses && (m=def->module) )
+  { if ( add )
+      ATOMIC_ADD(&m->memory.indexes, sizeofClauseIndexTable(ci));
+    else
+      ATOMIC_SUB(&m->memory.indexes, sizeofClauseIndexTable(ci));
+  }
+}
+
+
 static void
 freeClauseListRef(ClauseRef cref)
 { ClauseList cl = &cref->value.clauses;
   ClauseRef cr, next;
 
-  deleteIndexes(cl, TRUE);
+  deleteIndexes(NULL, cl, TRUE);
 
   for(cr=cl->first_clause; cr; cr=next)
   { next = cr->next;
@@ -677,7 +702,7 @@ freeClauseListRef(ClauseRef cref)
 
     freeHeap(cl->args, arityFunctor(cref->d.key)*sizeof(*cl->args));
   }
-  freeHeap(cref, SIZEOF_CREF_LIST);
+  free_to_pool(&GD->alloc_pools.clause_refs, cref, SIZEOF_CREF_LIST);
 }
 
 
@@ -724,7 +749,11 @@ unallocClauseIndexTable(ClauseIndex ci)
 
 static ClauseRef
 newClauseListRef(word key)
-{ ClauseRef cref = allocHeapOrHalt(SIZEOF_CREF_LIST);
+{ ClauseRef cref = alloc_from_pool(&GD->alloc_pools.clause_refs,
+				   SIZEOF_CREF_LIST);
+
+  if ( !cref )
+    outOfCore();
 
   memset(cref, 0, SIZEOF_CREF_LIST);
   cref->d.key = key;
@@ -1431,7 +1460,7 @@ deleteActiveClauseFromIndexes(Definition def, Clause cl)
 
 
 void
-deleteIndexes(ClauseList clist, int isnew)
+deleteIndexes(Definition def, ClauseList clist, int isnew)
 { ClauseIndex *cip0;
 
   assert(isnew);			/* TBD for non-new */
@@ -1445,6 +1474,7 @@ deleteIndexes(ClauseList clist, int isnew)
       if ( ISDEADCI(ci) )
 	continue;
 
+      accountClauseIndex(def, clist, ci, FALSE);
       unallocClauseIndexTable(ci);
     }
 
@@ -1647,6 +1677,7 @@ hashDefinition(ClauseList clist, hash_hints *hints, IndexContext ctx)
   }
   ci = newClauseIndexTable(hints->args, hints, ctx);
   insertIndex(ctx->predicate, clist, ci);
+  accountClauseIndex(ctx->predicate, clist, ci, TRUE);
   UNLOCKDEF(ctx->predicate);
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1817,6 +1848,7 @@ replaceIndex(Definition def, ClauseList cl, ClauseIndex *cip, ClauseIndex ci)
       }
     }
 
+    accountClauseIndex(def, cl, old, FALSE);
     linger(&def->lingering, unalloc_ci, old);
   }
 
@@ -627,13 +627,33 @@ ensureStackSpace__LD(size_t gcells, size_t tcells, int flags ARG_LD)
 		 *******************************/
 
 #ifdef O_PLMT
+/* GD->thread.ldata_accessing counts the threads with access.ldata set,
+   so ldata_in_use() only needs to scan the threads if it is non-zero.
+*/
+
+static inline void
+release_ldata__LD(ARG1_LD)
+{ PL_thread_info_t *me = LD->thread.info;
+
+  if ( me->access.ldata )
+  { me->access.ldata = NULL;
+    ATOMIC_DEC(&GD->thread.ldata_accessing);
+  }
+}
+
 static inline PL_local_data_t *
 acquire_ldata__LD(PL_thread_info_t *info ARG_LD)
-{ PL_local_data_t *ld = info->thread_data;
-  LD->thread.info->access.ldata = ld;
-  if ( ld && ld->magic == LD_MAGIC )
-    return ld;
-  LD->thread.info->access.ldata = NULL;
+{ PL_thread_info_t *me = LD->thread.info;
+  PL_local_data_t *ld = info->thread_data;
+
+  if ( ld )
+  { if ( !me->access.ldata )
+      ATOMIC_INC(&GD->thread.ldata_accessing);
+    me->access.ldata = ld;
+    if ( ld->magic == LD_MAGIC )
+      return ld;
+  }
+  release_ldata__LD(PASS_LD1);
   return NULL;
 }
 #endif
@@ -1428,6 +1428,12 @@ PRED_IMPL("$module_property", 2, module_property, 0)
   { return PL_unify_int64(a, sizeof_module(m));
   } else if ( pname == ATOM_program_size )
   { return PL_unify_int64(a, m->code_size);
+  } else if ( pname == ATOM_clause_size )
+  { return PL_unify_int64(a, m->memory.clauses);
+  } else if ( pname == ATOM_index_size )
+  { return PL_unify_int64(a, m->memory.indexes);
+  } else if ( pname == ATOM_table_size )
+  { return PL_unify_int64(a, m->memory.tables);
   } else if ( pname == ATOM_last_modified_generation )
   { return PL_unify_int64(a, m->last_modified);
   } else if ( pname == ATOM_program_space )
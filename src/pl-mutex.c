@@ -343,6 +343,13 @@ PL_mutex_lock(struct pl_mutex *m)
   { m->count++;
   } else
   { int rc;
+#ifdef O_CONTENTION_STATISTICS
+    uint64_t t0 = 0;
+
+    if ( pthread_mutex_trylock(&m->mutex) == 0 )
+      goto locked;
+    t0 = wait_clock();
+#endif
 #ifdef HAVE_PTHREAD_MUTEX_TIMEDLOCK
     for(;;)
     { struct timespec deadline;
@@ -361,6 +368,14 @@ PL_mutex_lock(struct pl_mutex *m)
     rc = pthread_mutex_lock(&m->mutex);
 #endif
     assert(rc == 0);
+#ifdef O_CONTENTION_STATISTICS
+    m->collisions++;
+    record_mutex_wait(&m->waits, m,
+		      m->anonymous ? "<mutex>" : PL_atom_chars(m->id),
+		      wait_clock()-t0, NULL);
+  locked:
+    m->locked++;
+#endif
     m->count = 1;
     m->owner = self;
   }
@@ -390,6 +405,9 @@ PL_mutex_trylock(struct pl_mutex *m)
   } else if ( (rc = pthread_mutex_trylock(&m->mutex)) == 0 )
   { m->count = 1;
     m->owner = self;
+#ifdef O_CONTENTION_STATISTICS
+    m->locked++;
+#endif
   } else
   { assert(rc == EBUSY);
     return FALSE;
@@ -137,6 +137,16 @@ extern int recursiveMutexUnlock(recursiveMutex *m);
 #endif
 #endif
 
+#ifdef O_CONTENTION_STATISTICS
+#define MUTEX_WAIT_BUCKETS 20		/* wait histogram: log2(usec) */
+
+typedef struct mutex_waits
+{ uint64_t     time;			/* Total time waited (nsec) */
+  uint64_t     max;			/* Longest wait (nsec) */
+  unsigned int histogram[MUTEX_WAIT_BUCKETS]; /* # waits per bucket */
+} mutex_waits;
+#endif
+
 typedef struct counting_mutex
 { simpleMutex mutex;			/* mutex itself */
   const char  *name;			/* name of the mutex */
@@ -144,6 +154,7 @@ typedef struct counting_mutex
   unsigned int lock_count;		/* # times unlocked */
 #ifdef O_CONTENTION_STATISTICS
   unsigned int collisions;		/* # contentions */
+  mutex_waits  waits;			/* Time spent waiting */
 #endif
   struct counting_mutex *next;		/* next of allocated chain */
   struct counting_mutex *prev;		/* prvious in allocated chain */
@@ -152,6 +163,9 @@ typedef struct counting_mutex
 extern counting_mutex  *allocSimpleMutex(const char *name);
 extern void		initSimpleMutex(counting_mutex *m, const char *name);
 extern void		freeSimpleMutex(counting_mutex *m);
+#ifdef O_CONTENTION_STATISTICS
+extern void		countingMutexWait(counting_mutex *m);
+#endif
 
 #else /*O_PLMT*/
 
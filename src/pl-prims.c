@@ -5541,6 +5541,15 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
     v->value.i = GD->statistics.modules;
   else if (key == ATOM_codes)				/* codes */
     v->value.i = GD->statistics.codes;
+  else if (key == ATOM_clause_space)			/* clause_space */
+    v->value.i = GD->alloc_pools.clauses.size +
+		 GD->alloc_pools.clause_refs.size;
+  else if (key == ATOM_record_space)			/* record_space */
+    v->value.i = GD->alloc_pools.records.size;
+  else if (key == ATOM_message_space)			/* message_space */
+    v->value.i = GD->alloc_pools.messages.size;
+  else if (key == ATOM_slab_space)			/* slab_space */
+    v->value.i = slab_space();
   else if (key == ATOM_epoch)
   { v->type = V_FLOAT;
     v->value.f = LD->statistics.start_time;
@@ -5605,6 +5614,12 @@ swi_statistics__LD(atom_t key, Number v, PL_local_data_t *ld)
 		 GD->statistics.engines_created;
   else if ( key == ATOM_engines_created )
     v->value.i = GD->statistics.engines_created;
+  else if ( key == ATOM_engines_reused )
+    v->value.i = GD->thread.engine_pool.reused;
+  else if ( key == ATOM_engine_create_time )
+  { v->type = V_FLOAT;
+    v->value.f = GD->statistics.engine_create_time;
+  }
   else if ( key == ATOM_thread_cputime )
   { v->type = V_FLOAT;
     v->value.f = GD->statistics.thread_cputime;
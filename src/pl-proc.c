@@ -297,7 +297,7 @@ resetProcedure(Procedure proc, bool isnew)
     tbl_reset_tabling_attributes(def);
 
   if ( isnew )
-  { deleteIndexes(&def->impl.clauses, TRUE);
+  { deleteIndexes(def, &def->impl.clauses, TRUE);
     freeCodesDefinition(def, FALSE);
   } else
     freeCodesDefinition(def, TRUE);	/* carefully sets to S_VIRGIN */
@@ -1094,7 +1094,11 @@ release_clause(Clause cl)
 
 ClauseRef
 newClauseRef(Clause clause, word key)
-{ ClauseRef cref = allocHeapOrHalt(SIZEOF_CREF_CLAUSE);
+{ ClauseRef cref = alloc_from_pool(&GD->alloc_pools.clause_refs,
+				   SIZEOF_CREF_CLAUSE);
+
+  if ( !cref )
+    outOfCore();
 
   DEBUG(MSG_CGC_CREF_PL,
 	Sdprintf("/**/ a(%p, %p, %d, '%s').\n",
@@ -1120,7 +1124,7 @@ freeClauseRef(ClauseRef cref)
 
   release_clause(cl);
 
-  freeHeap(cref, SIZEOF_CREF_CLAUSE);
+  free_to_pool(&GD->alloc_pools.clause_refs, cref, SIZEOF_CREF_CLAUSE);
 }
 
 
@@ -1323,6 +1327,9 @@ assertDefinition(Definition def, Clause clause, ClauseRef where ARG_LD)
   release_def(def);
   DEBUG(CHK_SECURE, checkDefinition(def));
   UNLOCKDEF(def);
+					/* removed in retract_clause(), etc. */
+  ATOMIC_ADD(&def->module->memory.clauses,
+	     sizeofClause(clause->code_size) + SIZEOF_CREF_CLAUSE);
 
   if ( unlikely(!!LD->transaction.generation) && def && true(def, P_DYNAMIC) )
   { if ( LD->transaction.generation < LD->transaction.gen_max )
@@ -1471,6 +1478,7 @@ removeClausesPredicate(Definition def, int sfindex, int fromfile)
 
   if ( deleted )
   { ATOMIC_SUB(&def->module->code_size, memory);
+    ATOMIC_SUB(&def->module->memory.clauses, memory);
     ATOMIC_ADD(&GD->clauses.erased_size, memory);
     ATOMIC_ADD(&GD->clauses.erased, deleted);
     if( true(def, P_DIRTYREG) )
@@ -1543,6 +1551,7 @@ retract_clause(Clause clause, gen_t generation ARG_LD)
     ATOMIC_INC(&GD->clauses.db_erased_refs);
 
   ATOMIC_SUB(&def->module->code_size, size);
+  ATOMIC_SUB(&def->module->memory.clauses, size);
   ATOMIC_ADD(&GD->clauses.erased_size, size);
   ATOMIC_INC(&GD->clauses.erased);
   if( true(def, P_DIRTYREG) )
@@ -1577,9 +1586,28 @@ retractClauseDefinition(Definition def, Clause clause, int notify)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+allocClause() allocates memory for a clause of `size` bytes, which must
+be sizeofClause(code_size).  Small clauses   are  served from the slab
+allocator.  See pl-allocpool.c.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+Clause
+allocClause(size_t size)
+{ Clause cl = alloc_from_pool(&GD->alloc_pools.clauses, size);
+
+  if ( !cl )
+    outOfCore();
+
+  return cl;
+}
+
+
 void
 unallocClause(Clause c)
-{ ATOMIC_SUB(&GD->statistics.codes, c->code_size);
+{ size_t size = sizeofClause(c->code_size);
+
+  ATOMIC_SUB(&GD->statistics.codes, c->code_size);
   ATOMIC_DEC(&GD->statistics.clauses);
   if ( c->source_no )			/* set by assert_term() */
   { if ( c->owner_no != c->source_no )
@@ -1589,11 +1617,10 @@ unallocClause(Clause c)
 
 #ifdef ALLOC_DEBUG
 #define ALLOC_FREE_MAGIC 0xFB
-  size_t size = sizeofClause(c->code_size);
   memset(c, ALLOC_FREE_MAGIC, size);
 #endif
 
-  PL_free(c);
+  free_to_pool(&GD->alloc_pools.clauses, c, size);
 }
 
 
@@ -1818,6 +1845,7 @@ reconsultFinalizePredicate(sf_reload *rl, Definition def, p_reload *r ARG_LD)
 
     if ( deleted )
     { ATOMIC_SUB(&def->module->code_size, memory);
+      ATOMIC_SUB(&def->module->memory.clauses, memory);
       ATOMIC_ADD(&GD->clauses.erased_size, memory);
       ATOMIC_ADD(&GD->clauses.erased, deleted);
       if( true(def, P_DIRTYREG) )
@@ -2116,6 +2144,17 @@ CGC builds on the following components and invariants:
         destroy the clause.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* (*) cgc_thread_stats() visits all threads and engines.  The inference
+   throttle is per thread and  new  engines  start  at  zero, so with many
+   (short lived) engines, as used by the green threads of spawn/2, we would
+   scan all of them over and over again.  If there are more than
+   CGC_SCAN_THREADS engines we therefore only scan once every
+   engines/CGC_SCAN_THREADS times, keeping the amortized cost per call at
+   CGC_SCAN_THREADS threads.  Without (many) engines nothing changes.
+*/
+
+#define CGC_SCAN_THREADS 64
+
 static int
 considerClauseGC(ARG1_LD)
 { size_t pending  = GD->clauses.erased_size - GD->clauses.erased_size_last;
@@ -2134,8 +2173,19 @@ considerClauseGC(ARG1_LD)
 
   if ( LD->statistics.inferences > LD->clauses.cgc_inferences )
   { int rgc;
+#ifdef O_PLMT
+    int engines = ( GD->statistics.engines_created -
+		    GD->statistics.engines_finished );
+    unsigned int every = ( engines > CGC_SCAN_THREADS
+			   ? (unsigned int)engines/CGC_SCAN_THREADS : 0 );
+#endif
 
     LD->clauses.cgc_inferences = LD->statistics.inferences + 500;
+#ifdef O_PLMT
+    if ( every > 1 &&			/* see (*) */
+	 ATOMIC_INC(&GD->clauses.cgc_considered) % every != 0 )
+      return FALSE;
+#endif
 
     stats.dirty_pred_clauses = GD->clauses.dirty;
     if ( stats.dirty_pred_clauses == (size_t)-1 )
@@ -2502,7 +2552,7 @@ maybeUnregisterDirtyDefinition(Definition def)
 		       predicateName(def));
 	    });
       unregisterDirtyDefinition(def);
-      deleteIndexes(&def->impl.clauses, TRUE);
+      deleteIndexes(def, &def->impl.clauses, TRUE);
       freeHeap(def->impl.any.args, sizeof(arg_info)*def->functor->arity);
       if ( def->tabling )
 	freeHeap(def->tabling, sizeof(*def->tabling));
@@ -3913,7 +3963,7 @@ PRED_IMPL("copy_predicate_clauses", 2, copy_predicate_clauses, PL_FA_TRANSPARENT
 
     if ( visibleClause(cl, generation) )
     { size_t size = sizeofClause(cl->code_size);
-      Clause copy = PL_malloc_atomic(size);
+      Clause copy = allocClause(size);
 
       memcpy(copy, cl, size);
       copy->predicate = copy_def;
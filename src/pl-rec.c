@@ -217,7 +217,8 @@ unallocRecordList(RecordList rl)
 
 typedef enum
 { ENONE = 0,
-  EFAST_SERIALIZE
+  EFAST_SERIALIZE,
+  EFAST_WRITE
 } cerror;
 
 typedef struct
@@ -229,6 +230,9 @@ typedef struct
   int	     lock;			/* lock compiled atoms */
   cerror     error;			/* generated error */
   word	     econtext[1];		/* error context */
+  size_t     chunk;			/* Flush code beyond this (0: never) */
+  size_t     flushed;			/* Bytes of code flushed */
+  IOSTREAM  *out;			/* Flush code here (NULL: discard) */
 } compile_info, *CompileInfo;
 
 #define	PL_TYPE_VARIABLE	(1)	/* variable */
@@ -468,6 +472,28 @@ typedef struct
 #define isAttVarP(p)  ((word)(p) & 0x1)
 #define valAttVarP(p) ((Word)((word)(p) & ~0x1L))
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+flush_code() is used by fast_write/2 for large  terms.  If the code buffer
+exceeds info->chunk, its content is written   to  info->out or, if this is
+NULL, discarded while counting the bytes. This keeps the memory needed to
+serialize a term bounded by the chunk size.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+flush_code(CompileInfo info)
+{ size_t len = sizeOfBuffer(&info->code);
+
+  if ( info->out && Sfwrite(info->code.base, 1, len, info->out) != len )
+  { info->error = EFAST_WRITE;
+    return FALSE;
+  }
+  info->flushed += len;
+  emptyBuffer(&info->code, info->chunk*2);
+
+  return TRUE;
+}
+
+
 static int
 compile_term_to_heap(term_agenda *agenda, CompileInfo info ARG_LD)
 { Word p;
@@ -475,6 +501,11 @@ compile_term_to_heap(term_agenda *agenda, CompileInfo info ARG_LD)
   while( (p=nextTermAgenda(agenda)) )
   { word w;
 
+    if ( unlikely(info->chunk) &&
+	 sizeOfBuffer(&info->code) >= info->chunk &&
+	 !flush_code(info) )
+      return FALSE;
+
   again:
     w = *p;
 
@@ -494,7 +525,7 @@ compile_term_to_heap(term_agenda *agenda, CompileInfo info ARG_LD)
       { intptr_t n = info->nvars++;
 	Word ap = valPAttVar(w);
 
-	if ( isEmptyBuffer(&info->code) )
+	if ( isEmptyBuffer(&info->code) && info->flushed == 0 )
 	{ addOpCode(info, PL_REC_ALLOCVAR);	/* only an attributed var */
 	  info->size++;
 	}
@@ -676,7 +707,8 @@ compileTermToHeap__LD() is the core of the recorded database.
 
 Returns NULL if there is insufficient   memory.  Otherwise the result of
 the  allocation  function.   The   default    allocation   function   is
-PL_malloc_atomic_unmanaged().
+the records pool (see pl-allocpool.c); such records are freed using
+freeRecord().
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 Record
@@ -700,6 +732,9 @@ compileTermToHeap__LD(term_t t,
   info.nvars = 0;
   info.external = (flags & R_EXTERNAL);
   info.lock = !(info.external || (flags&R_NOLOCK));
+  info.chunk = 0;
+  info.flushed = 0;
+  info.out = NULL;
 
   initTermAgenda(&agenda, 1, valTermRef(t));
   rc = compile_term_to_heap(&agenda, &info PASS_LD);
@@ -712,10 +747,11 @@ compileTermToHeap__LD(term_t t,
     if ( allocate )
       record = (*allocate)(closure, size);
     else
-      record = PL_malloc_atomic_unmanaged(size);
+      record = alloc_from_pool(&GD->alloc_pools.records, size);
 
     if ( record )
-    {
+    { LD->accounting.usage.records++;
+      LD->accounting.usage.record_bytes += size;
 #ifdef REC_MAGIC
       record->magic = REC_MAGIC;
 #endif
@@ -795,6 +831,8 @@ rec_error(CompileInfo info)
 		PL_put_atom(t, info->econtext[0]) &&
 		PL_permission_error("fast_serialize", "blob", t) );
     }
+    case EFAST_WRITE:
+      return FALSE;			/* reported by PL_release_stream() */
     default:
       assert(0);
       return FALSE;
@@ -802,12 +840,21 @@ rec_error(CompileInfo info)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+compile_external_record_to() compiles t into an external record. If chunk
+is non-zero, code is flushed to out (or   discarded if out is NULL) each
+time the code buffer exceeds chunk  bytes.   The  header  always reflects
+the total code size.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
 static int
-compile_external_record(term_t t, record_data *data ARG_LD)
+compile_external_record_to(term_t t, record_data *data,
+			   IOSTREAM *out, size_t chunk ARG_LD)
 { Word p;
   int first = REC_HDR;
   term_agenda agenda;
-  int scode, rc;
+  size_t scode;
+  int rc;
 
   DEBUG(CHK_SECURE, checkData(valTermRef(t)));
   p = valTermRef(t);
@@ -817,6 +864,9 @@ compile_external_record(term_t t, record_data *data ARG_LD)
   initBuffer(&data->info.code);
   data->info.external = TRUE;
   data->info.lock = FALSE;
+  data->info.chunk = chunk;
+  data->info.flushed = 0;
+  data->info.out = out;
 
   if ( isInteger(*p) )			/* integer-only record */
   { int64_t v;
@@ -859,8 +909,10 @@ general:
   restoreVars(&data->info);
   unvisit(PASS_LD1);
   if ( !rc )
+  { discardBuffer(&data->info.code);
     return rec_error(&data->info);
-  scode = (int)sizeOfBuffer(&data->info.code);
+  }
+  scode = data->info.flushed + sizeOfBuffer(&data->info.code);
 
   initBuffer(&data->hdr);
   addBuffer(&data->hdr, first, uchar);			/* magic code */
@@ -872,6 +924,12 @@ general:
 }
 
 
+static int
+compile_external_record(term_t t, record_data *data ARG_LD)
+{ return compile_external_record_to(t, data, NULL, 0 PASS_LD);
+}
+
+
 char *
 PL_record_external(term_t t, size_t *len)
 { GET_LD
@@ -979,6 +1037,58 @@ PRED_IMPL("fast_term_serialized", 2, fast_term_serialized, 0)
   }
 }
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Large terms are written and read  in   chunks  of FASTRW_CHUNK bytes. The
+fast_term header contains the code size,  so   fast_write/2  first  does a
+counting pass that discards the code  beyond   FASTRW_CHUNK.  If the term
+turns out to be large, the header   is written and the term is compiled
+again, now flushing the code directly to   the  stream. Small terms only
+take the first pass. While flushing, the term  is marked (variables bound
+to their number, cycle marks), so GC  and stack shifts are blocked as the
+stream may call Prolog.
+
+fast_read/2 decodes records with more  than   FASTRW_CHUNK  bytes of code
+from a window that is refilled from the  stream. Because reading may call
+Prolog (e.g., for user defined streams), GC   and stack shifts are blocked
+while the term is being created and   the  global stack area is cleared
+first such that it always contains valid data.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FASTRW_FAST  512		/* Record in local buffer */
+#define FASTRW_CHUNK 65536		/* Chunk size for large terms */
+#define FASTRW_MAXOP 32			/* Max fixed-size bytes for an op */
+
+static int fast_read_chunked(IOSTREAM *in, size_t codes, size_t gsize,
+			     size_t nvars, term_t t ARG_LD);
+
+static int
+fast_write_chunked(IOSTREAM *out, term_t t, record_data *data ARG_LD)
+{ record_data data2;
+  size_t shdr  = sizeOfBuffer(&data->hdr);
+  size_t scode = data->info.flushed + sizeOfBuffer(&data->info.code);
+  int rc;
+
+  if ( Sfwrite(data->hdr.base, 1, shdr, out) != shdr )
+    return FALSE;
+
+  blockGC(0 PASS_LD);
+  rc = compile_external_record_to(t, &data2, out, FASTRW_CHUNK PASS_LD);
+  unblockGC(0 PASS_LD);
+
+  if ( rc )
+  { size_t len = sizeOfBuffer(&data2.info.code);
+
+    assert(!data2.simple);
+    assert(data2.info.flushed+len == scode);
+    (void)scode;
+    rc = (Sfwrite(data2.info.code.base, 1, len, out) == len);
+    discard_record_data(&data2);
+  }
+
+  return rc;
+}
+
+
 /** fast_write(+Stream, +Term)
 */
 
@@ -992,11 +1102,14 @@ PRED_IMPL("fast_write", 2, fast_write, 0)
     int rc;
 
     if ( out->encoding == ENC_OCTET )
-    { if ( (rc=compile_external_record(A2, &data PASS_LD)) )
+    { if ( (rc=compile_external_record_to(A2, &data,
+					  NULL, FASTRW_CHUNK PASS_LD)) )
       { if ( data.simple )
 	{ size_t len = sizeOfBuffer(&data.info.code);
 
 	  rc = (Sfwrite(data.info.code.base, 1, len, out) == len);
+	} else if ( data.info.flushed > 0 )
+	{ rc = fast_write_chunked(out, A2, &data PASS_LD);
 	} else
 	{ size_t shdr  = sizeOfBuffer(&data.hdr);
 	  size_t scode = sizeOfBuffer(&data.info.code);
@@ -1019,8 +1132,6 @@ PRED_IMPL("fast_write", 2, fast_write, 0)
 }
 
 
-#define FASTRW_FAST 512
-
 static char *
 readSizeInt(IOSTREAM *in, char *to, size_t *sz)
 { size_t r = 0;
@@ -1132,18 +1243,25 @@ PRED_IMPL("fast_read", 2, fast_read, 0)
 	case REC_HDR|REC_GROUND:
 	case REC_HDR:
 	{ char *np;
-	  size_t codes, gsize, nvars;
+	  size_t codes, gsize, nvars = 0;
 
 	  rec[0] = m;
 
 	  if ( (np=readSizeInt(in, &rec[1], &codes)) &&
 	       (np=readSizeInt(in, np, &gsize)) &&
-	       ((m&REC_GROUND) || (np=readSizeInt(in, np, &nvars))) &&
-	       (rec = realloc_record(rec, &np, codes)) &&
-	       Sfread(np, 1, codes, in) == codes )
-	    rc = TRUE;
-	  else
-	    rc = PL_syntax_error("fastrw_term", in);
+	       ((m&REC_GROUND) || (np=readSizeInt(in, np, &nvars))) )
+	  { if ( codes > FASTRW_CHUNK )
+	    { rc = fast_read_chunked(in, codes, gsize, nvars, A2 PASS_LD);
+	      goto out;
+	    }
+	    if ( (rec = realloc_record(rec, &np, codes)) &&
+		 Sfread(np, 1, codes, in) == codes )
+	      rc = TRUE;
+	    else
+	      rc = PL_syntax_error("fastrw_term", in);
+	  } else
+	  { rc = PL_syntax_error("fastrw_term", in);
+	  }
 	  break;
 	}
 	default:
@@ -1188,6 +1306,11 @@ typedef struct
   uint		nvars;			/* Variables seen */
   uint		dicts;			/* # dicts found */
   TmpBuffer	avars;			/* Values stored for attvars */
+  IOSTREAM     *in;			/* Chunked: read more code from here */
+  const char   *end;			/* Chunked: end of data in window */
+  char	       *window;			/* Chunked: data window */
+  size_t	wsize;			/* Chunked: allocated window size */
+  size_t	left;			/* Chunked: code bytes still in `in` */
   Word	        vars_buf[MAX_FAST_VARS];
 } copy_info, *CopyInfo;
 
@@ -1328,6 +1451,67 @@ fetchChars(CopyInfo b, unsigned len, Word to)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+fill_copy_window() is used by  fast_read/2   on  large records. It shifts
+the unprocessed data to the start of the  window and fills the remainder
+from the stream, growing the window if   `need` bytes do not fit. Returns
+TRUE if at least `min` bytes are available.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+fill_copy_window(CopyInfo b, size_t need, size_t min)
+{ size_t avail = b->end - b->data;
+  size_t room;
+
+  if ( avail > 0 && b->data != b->window )
+    memmove(b->window, b->data, avail);
+  if ( need > b->wsize )
+  { char *nw;
+
+    if ( !(nw = realloc(b->window, need)) )
+      return PL_no_memory();
+    b->window = nw;
+    b->wsize  = need;
+  }
+
+  room = b->wsize - avail;
+  if ( room > b->left )
+    room = b->left;
+  if ( room > 0 && Sfread(b->window+avail, 1, room, b->in) != room )
+    return FALSE;
+  b->left -= room;
+  b->base  = b->data = b->window;
+  b->end   = b->window + avail + room;
+
+  return (size_t)(b->end - b->data) >= min;
+}
+
+#define NEED_DATA(b, n) \
+	( likely(!(b)->in) || \
+	  (size_t)((b)->end - (b)->data) >= (size_t)(n) || \
+	  fill_copy_window(b, n, n) )
+
+static size_t
+counted_size(CopyInfo b)		/* size of <SizeInt><bytes> at data */
+{ const char *s = b->data;
+  size_t len = fetchSizeInt(b);
+  size_t hdr = b->data - s;
+
+  b->data = s;
+  return hdr+len;
+}
+
+#ifdef O_GMP
+static size_t
+mpz_bytes(const char *s)		/* see addMPZToBuffer() */
+{ int size = (int)(((unsigned)(s[0]&0xff)<<24) | ((s[1]&0xff)<<16) |
+		   ((s[2]&0xff)<<8) | (s[3]&0xff));
+
+  return size < 0 ? -size : size;
+}
+#endif
+
+
 static int
 copy_record(Word p, CopyInfo b ARG_LD)
 { term_agenda agenda;
@@ -1337,6 +1521,11 @@ copy_record(Word p, CopyInfo b ARG_LD)
   do
   {
   right_recursion:
+    if ( unlikely(b->in != NULL) &&
+	 (size_t)(b->end - b->data) < FASTRW_MAXOP &&
+	 !fill_copy_window(b, FASTRW_MAXOP, 1) )
+      return FALSE;
+
     switch( (tag = fetchOpCode(b)) )
     { case PL_TYPE_VARIABLE:
       { intptr_t n = fetchSizeInt(b);
@@ -1390,12 +1579,16 @@ copy_record(Word p, CopyInfo b ARG_LD)
 	continue;
       }
       case PL_TYPE_EXT_ATOM:
-      { fetchAtom(b, p);
+      { if ( !NEED_DATA(b, counted_size(b)) )
+	  return FALSE;
+	fetchAtom(b, p);
 	PL_unregister_atom(*p);
 	continue;
       }
       case PL_TYPE_EXT_WATOM:
-      { fetchAtomW(b, p);
+      { if ( !NEED_DATA(b, counted_size(b)) )
+	  return FALSE;
+	fetchAtomW(b, p);
 	PL_unregister_atom(*p);
 	continue;
       }
@@ -1422,9 +1615,13 @@ copy_record(Word p, CopyInfo b ARG_LD)
       }
 #ifdef O_GMP
       case PL_REC_MPZ:
+	if ( !NEED_DATA(b, 4+mpz_bytes(b->data)) )
+	  return FALSE;
 	b->data = loadMPZFromCharp(b->data, p, &b->gstore);
 	continue;
       case PL_REC_MPQ:
+	if ( !NEED_DATA(b, 8+mpz_bytes(b->data)+mpz_bytes(b->data+4)) )
+	  return FALSE;
 	b->data = loadMPQFromCharp(b->data, p, &b->gstore);
 	continue;
 #endif
@@ -1441,10 +1638,14 @@ copy_record(Word p, CopyInfo b ARG_LD)
 	continue;
       }
       case PL_TYPE_STRING:
-      { size_t lw, len = fetchSizeInt(b);
+      { size_t lw, len;
 	int pad;
 	word hdr;
 
+	if ( !NEED_DATA(b, counted_size(b)) )
+	  return FALSE;
+	len = fetchSizeInt(b);
+
 	lw = (len+sizeof(word))/sizeof(word); /* see globalNString() */
 	pad = (lw*sizeof(word) - len);
 	*p = consPtr(b->gstore, TAG_STRING|STG_GLOBAL);
@@ -1492,9 +1693,13 @@ copy_record(Word p, CopyInfo b ARG_LD)
 	opcode_atom = fetchOpCode(b);
 	switch(opcode_atom)
 	{ case PL_TYPE_EXT_ATOM:
+	    if ( !NEED_DATA(b, counted_size(b)) )
+	      return FALSE;
 	    fetchAtom(b, &name);
 	    break;
 	  case PL_TYPE_EXT_WATOM:
+	    if ( !NEED_DATA(b, counted_size(b)) )
+	      return FALSE;
 	    fetchAtomW(b, &name);
 	    break;
 	  case PL_TYPE_NIL:
@@ -1516,6 +1721,8 @@ copy_record(Word p, CopyInfo b ARG_LD)
       { atom_t name;
 
 	arity = (int)fetchSizeInt(b);
+	if ( !NEED_DATA(b, counted_size(b)) )
+	  return FALSE;
 	fetchAtom(b, &name);
 	fdef = lookupFunctorDef(name, arity);
 	goto compound;
@@ -1561,6 +1768,7 @@ copyRecordToGlobal(term_t copy, Record r, int flags ARG_LD)
   b.base = b.data = dataRecord(r);
   b.gbase = b.gstore = gTop;
   b.version_map = NULL;
+  b.in = NULL;
 
   if ( (rc=init_copy_vars(&b, r->nvars)) == TRUE )
   { gTop += r->gsize;
@@ -1768,6 +1976,174 @@ markAtomsRecord(Record record)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+mayUnifyRecord() walks the  record  and  t  in   parallel  and  returns
+FALSE if they cannot unify.   It  reads  the   record  in  place,  i.e.,
+without copying it to the global stack.   This allows for scanning large
+records, notably messages in a  queue,   against  a  partially instantiated
+pattern at the cost of reading up  to   the  first mismatch rather than
+copying the entire term.  Subterms of  the   record  that  face a variable
+in t are skipped.  Atomic data, including floats, strings  and  64-bit
+integers, is compared exactly.  If TRUE is returned,  the  caller  must
+still copy and unify as the test  is   conservative  for variables that
+appear multiple times in the record,  attributed variables, unbounded
+integers and cycles.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_ATOMGC
+static void
+skip_atom(atom_t a)
+{ (void)a;
+}
+#endif
+
+int
+mayUnifyRecord(Record r, term_t t ARG_LD)
+{
+#ifdef O_ATOMGC
+  copy_info b;
+  term_agenda agenda;
+  int is_compound = FALSE;
+  int rc = TRUE;
+  Word p = valTermRef(t);
+
+#ifdef REC_MAGIC
+  assert(r->magic == REC_MAGIC);
+#endif
+  b.base = b.data = dataRecord(r);
+  b.version_map = NULL;
+
+  do
+  { const char *here;
+    word fdef;
+    size_t arity;
+    int tag;
+
+    deRef(p);
+  right_recursion:
+    if ( canBind(*p) )
+    { scanAtomsRecord(&b, skip_atom);	/* skip the subterm */
+      continue;
+    }
+
+    here = b.data;
+    switch( (tag=fetchOpCode(&b)) )
+    { case PL_TYPE_VARIABLE:
+      case PL_REC_CYCLE:
+	skipSizeInt(&b);
+	continue;
+      case PL_REC_ALLOCVAR:
+	goto right_recursion;
+#ifdef O_ATTVAR
+      case PL_TYPE_ATTVAR:
+	skipSizeInt(&b);
+	scanAtomsRecord(&b, skip_atom);	/* the attribute value */
+	continue;
+#endif
+      case PL_TYPE_NIL:
+	if ( *p != ATOM_nil )
+	  goto nomatch;
+	continue;
+      case PL_TYPE_DICT:
+	if ( *p != ATOM_dict )
+	  goto nomatch;
+	continue;
+      case PL_TYPE_ATOM:
+	if ( *p != fetchWord(&b) )
+	  goto nomatch;
+	continue;
+      case PL_TYPE_TAGGED_INTEGER:
+	if ( *p != consInt(fetchInt64(&b)) )
+	  goto nomatch;
+	continue;
+      case PL_TYPE_INTEGER:
+      { int64_t i = fetchInt64(&b);
+
+	if ( !isBignum(*p) || valBignum(*p) != i )
+	  goto nomatch;
+	continue;
+      }
+      case PL_TYPE_FLOAT:
+      case PL_TYPE_EXT_FLOAT:
+      { double f;
+
+	if ( !isFloat(*p) )
+	  goto nomatch;
+	if ( tag == PL_TYPE_FLOAT )
+	  fetchFloat(&b, &f);
+	else
+	  fetchExtFloat(&b, &f);
+	if ( memcmp(&f, valIndirectP(*p), sizeof(f)) != 0 )
+	  goto nomatch;			/* as equalIndirect() */
+	continue;
+      }
+      case PL_TYPE_STRING:
+      { size_t len = fetchSizeInt(&b);
+	Word f;
+
+	if ( !isString(*p) )
+	  goto nomatch;
+	f = addressIndirect(*p);
+	if ( wsizeofInd(*f)*sizeof(word)-padHdr(*f) != len ||
+	     memcmp(b.data, f+1, len) != 0 )
+	  goto nomatch;
+	b.data += len;
+	continue;
+      }
+      case PL_TYPE_COMPOUND:
+	fdef = fetchWord(&b);
+	if ( !isTerm(*p) || functorTerm(*p) != fdef )
+	  goto nomatch;
+	arity = arityFunctor(fdef);
+      compound:
+	p = argTermP(*p, 0);
+	if ( !is_compound )
+	{ is_compound = TRUE;
+	  initTermAgenda(&agenda, arity, p);
+	} else
+	{ if ( !pushWorkAgenda(&agenda, arity, p) )
+	    goto out;			/* no memory: just say maybe */
+	}
+	continue;
+      case PL_TYPE_CONS:
+	if ( !isTerm(*p) || functorTerm(*p) != FUNCTOR_dot2 )
+	  goto nomatch;
+	arity = 2;
+	goto compound;
+      case PL_TYPE_EXT_COMPOUND:
+      case PL_TYPE_EXT_COMPOUND_V2:
+	if ( !isTerm(*p) )
+	  goto nomatch;
+	break;
+      case PL_TYPE_EXT_ATOM:
+      case PL_TYPE_EXT_WATOM:
+	if ( isTerm(*p) )
+	  goto nomatch;
+	break;
+      default:				/* other atomic data */
+	if ( isTerm(*p) || isAtom(*p) )
+	  goto nomatch;
+	break;
+    }
+    b.data = here;			/* no precise test; skip */
+    scanAtomsRecord(&b, skip_atom);
+  } while ( is_compound && (p=nextTermAgendaNoDeRef(&agenda)) );
+
+out:
+  if ( is_compound )
+    clearTermAgenda(&agenda);
+
+  return rc;
+
+nomatch:
+  rc = FALSE;
+  goto out;
+#else
+  return TRUE;
+#endif
+}
+
+
 #ifdef O_DEBUG_ATOMGC
 void
 unregister_atom_rec(atom_t a)
@@ -1798,7 +2174,7 @@ freeRecord(Record record)
   }
 #endif
 
-  PL_free(record);
+  free_to_pool(&GD->alloc_pools.records, record, record->size);
 
   succeed;
 }
@@ -1806,7 +2182,7 @@ freeRecord(Record record)
 
 void
 unallocRecordRef(RecordRef r)
-{ freeHeap(r, sizeof(*r));
+{ free_to_pool(&GD->alloc_pools.records, r, sizeof(*r));
 }
 
 
@@ -1816,7 +2192,7 @@ freeRecordRef(RecordRef r)
 
   freeRecord(r->record);
   if ( reclaim_now )
-    freeHeap(r, sizeof(*r));
+    free_to_pool(&GD->alloc_pools.records, r, sizeof(*r));
   else
     r->record = NULL;
 }
@@ -1836,6 +2212,7 @@ PL_recorded_external(const char *rec, term_t t)
 
   b.base = b.data = rec;
   b.version_map = NULL;
+  b.in = NULL;
   fetchBuf(&b, &m, uchar);
 
   if ( !REC_COMPAT(m) )
@@ -1917,6 +2294,60 @@ PL_recorded_external(const char *rec, term_t t)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+fast_read_chunked() reads  the  code  of  a   large  record  from  `in`
+through a window of FASTRW_CHUNK bytes.  See the FASTRW section.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+fast_read_chunked(IOSTREAM *in, size_t codes, size_t gsize, size_t nvars,
+		  term_t t ARG_LD)
+{ copy_info b;
+  term_t tmp;
+  int rc;
+
+  if ( !(tmp=PL_new_term_ref()) )
+    return FALSE;
+  if ( !(b.window = malloc(FASTRW_CHUNK)) )
+    return PL_no_memory();
+  b.wsize = FASTRW_CHUNK;
+  b.in = in;
+  b.left = codes;
+  b.base = b.data = b.end = b.window;
+  b.version_map = NULL;
+  b.dicts = 0;
+
+  if ( (b.gbase = b.gstore = allocGlobal(gsize)) )
+  { memset(b.gbase, 0, gsize*sizeof(word));	/* all variables */
+    if ( (rc=init_copy_vars(&b, (uint)nvars)) == TRUE )
+    { blockGC(0 PASS_LD);
+      rc = copy_record(valTermRef(tmp), &b PASS_LD);
+      unblockGC(0 PASS_LD);
+      free_copy_vars(&b);
+    }
+  } else
+  { rc = FALSE;				/* global stack overflow */
+  }
+  free(b.window);
+
+  if ( rc == TRUE )
+  { if ( b.left > 0 || b.data != b.end || b.gstore != b.gbase+gsize )
+      return PL_syntax_error("fastrw_term", in);
+    if ( b.dicts )
+      resortDictsInTerm(tmp);
+    DEBUG(CHK_SECURE, checkData(valTermRef(tmp)));
+
+    return PL_unify(t, tmp);
+  } else if ( rc == FALSE )
+  { if ( !PL_exception(0) )
+      PL_syntax_error("fastrw_term", in);
+    return FALSE;
+  } else
+  { return raiseStackOverflow(rc);
+  }
+}
+
+
 int
 PL_erase_external(char *rec)
 { PL_free(rec);
@@ -2040,11 +2471,14 @@ record(term_t key, term_t term, term_t ref, int az)
 
   if ( !(copy = compileTermToHeap(term, 0)) )
     return PL_no_memory();
-  r = allocHeapOrHalt(sizeof(*r));
+  if ( !(r = alloc_from_pool(&GD->alloc_pools.records, sizeof(*r))) )
+  { PL_erase(copy);
+    return PL_no_memory();
+  }
   r->record = copy;
   if ( ref && !PL_unify_recref(ref, r) )
   { PL_erase(copy);
-    freeHeap(r, sizeof(*r));
+    free_to_pool(&GD->alloc_pools.records, r, sizeof(*r));
     return FALSE;
   }
 
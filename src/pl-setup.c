@@ -84,6 +84,11 @@ setupProlog(void)
   LD->signal.pending[1] = 0;
   LD->statistics.start_time = WallTime();
 
+  init_alloc_pool(&GD->alloc_pools.clauses,     "clauses",     (size_t)-1);
+  init_alloc_pool(&GD->alloc_pools.clause_refs, "clause_refs", (size_t)-1);
+  init_alloc_pool(&GD->alloc_pools.records,     "records",     (size_t)-1);
+  init_alloc_pool(&GD->alloc_pools.messages,    "messages",    (size_t)-1);
+
   startCritical;
   DEBUG(1, Sdprintf("wam_table ...\n"));
   initWamTable();
@@ -313,6 +318,9 @@ static struct signame
 #endif
   { SIG_CLAUSE_GC,     "prolog:clause_gc",     0 },
   { SIG_PLABORT,       "prolog:abort",         0 },
+#ifdef SIG_RESOURCES
+  { SIG_RESOURCES,     "prolog:resources",     0 },
+#endif
 
   { -1,		NULL,     0}
 };
@@ -826,6 +834,9 @@ initSignals(void)
 #ifdef SIG_THREAD_SIGNAL
   PL_signal(SIG_THREAD_SIGNAL|PL_SIGSYNC, executeThreadSignals);
 #endif
+#ifdef SIG_RESOURCES
+  PL_signal(SIG_RESOURCES|PL_SIGSYNC,     resourceLimitsChanged);
+#endif
 #ifdef SIG_ATOM_GC
   PL_signal(SIG_ATOM_GC|PL_SIGSYNC,       agc_handler);
 #endif
@@ -1462,10 +1473,16 @@ init_stack(Stack s, char *name, size_t size, size_t spare, int gc)
 }
 
 
-static int
-allocStacks(void)
-{ GET_LD
-  size_t minglobal = 8*SIZEOF_VOIDP K;
+typedef struct stack_set
+{ struct stack_set *next;		/* next in GD->thread.engine_pool */
+  void	 *global;			/* global+local stack */
+  void	 *trail;			/* trail stack */
+  int	  hugepages;			/* LD->stacks.hugepages */
+} stack_set;				/* lives in the argument stack */
+
+static void
+initial_stack_sizes(size_t *global, size_t *local, size_t *trail, size_t *arg)
+{ size_t minglobal = 8*SIZEOF_VOIDP K;
   size_t minlocal  = 4*SIZEOF_VOIDP K;
   size_t mintrail  = 4*SIZEOF_VOIDP K;
   size_t minarg    = 1*SIZEOF_VOIDP K;
@@ -1474,17 +1491,51 @@ allocStacks(void)
   size_t iglobal = nextStackSizeAbove(minglobal-1);
   size_t ilocal  = nextStackSizeAbove(minlocal-1);
 
-  itrail  = stack_nalloc(itrail);
-  minarg  = stack_nalloc(minarg);
-  iglobal = stack_nalloc(iglobal+ilocal)-ilocal;
+  *trail  = stack_nalloc(itrail);
+  *arg    = stack_nalloc(minarg);
+  *global = stack_nalloc(iglobal+ilocal)-ilocal;
+  *local  = ilocal;
+}
+
+
+static int
+allocStacks(void)
+{ GET_LD
+  size_t iglobal, ilocal, itrail, minarg;
+
+  initial_stack_sizes(&iglobal, &ilocal, &itrail, &minarg);
 
   gBase = NULL;
   tBase = NULL;
   aBase = NULL;
 
-  gBase = (Word)       stack_malloc(iglobal + ilocal);
-  tBase = (TrailEntry) stack_malloc(itrail);
-  aBase = (Word *)     stack_malloc(minarg);
+#ifdef O_PLMT
+  if ( GD->thread.engine_pool.stacks )
+  { stack_set *set, **prev;
+
+    PL_LOCK(L_THREAD);
+    for(prev = &GD->thread.engine_pool.stacks; (set=*prev); prev = &set->next)
+    { if ( set->hugepages == LD->stacks.hugepages &&
+	   tmp_malloc_size(set->global) == iglobal + ilocal &&
+	   tmp_malloc_size(set->trail)  == itrail &&
+	   tmp_malloc_size(set)         == minarg )
+      { *prev = set->next;
+	GD->thread.engine_pool.stack_count--;
+	gBase = set->global;
+	tBase = set->trail;
+	aBase = (Word *)set;
+	break;
+      }
+    }
+    PL_UNLOCK(L_THREAD);
+  }
+
+  if ( !gBase )
+#endif
+  { gBase = (Word)       stack_malloc(iglobal + ilocal);
+    tBase = (TrailEntry) stack_malloc(itrail);
+    aBase = (Word *)     stack_malloc(minarg);
+  }
 
   if ( !gBase || !tBase || !aBase )
   { if ( gBase )
@@ -1531,6 +1582,72 @@ freeStacks(ARG1_LD)
 }
 
 
+#ifdef O_PLMT
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+poolStacks() is called instead of freeStacks() when an engine is retired.
+If the stacks still have the size allocStacks() gave them and the pool is
+not full (see the Prolog flag `engine_pool_size`),  they are kept for the
+next engine and we return TRUE.  The  administration  lives  in the first
+bytes of the argument stack, so the pool itself never allocates.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+poolStacks(ARG1_LD)
+{ size_t iglobal, ilocal, itrail, minarg;
+  stack_set *set;
+  int rc = FALSE;
+
+  if ( !gBase || !tBase || !aBase ||
+       GD->thread.engine_pool.stack_count >= GD->thread.engine_pool.size )
+    return FALSE;
+
+  initial_stack_sizes(&iglobal, &ilocal, &itrail, &minarg);
+  if ( tmp_malloc_size(gBase-1) != iglobal + ilocal ||
+       (void*)lBase != addPointer(gBase-1, iglobal) ||
+       tmp_malloc_size(tBase) != itrail ||
+       tmp_malloc_size(aBase) != minarg )
+    return FALSE;			/* resized */
+
+  set = (stack_set *)aBase;
+  set->global    = gBase-1;		/* see initPrologStacks() */
+  set->trail     = tBase;
+  set->hugepages = LD->stacks.hugepages;
+
+  PL_LOCK(L_THREAD);
+  if ( GD->thread.engine_pool.stack_count < GD->thread.engine_pool.size )
+  { set->next = GD->thread.engine_pool.stacks;
+    GD->thread.engine_pool.stacks = set;
+    GD->thread.engine_pool.stack_count++;
+    rc = TRUE;
+  }
+  PL_UNLOCK(L_THREAD);
+
+  if ( rc )
+  { gTop = NULL; gBase = NULL;
+    lTop = NULL; lBase = NULL;
+    tTop = NULL; tBase = NULL;
+    aTop = NULL; aBase = NULL;
+  }
+
+  return rc;
+}
+
+
+void
+freeStackPool(void)
+{ stack_set *set;
+
+  while( (set=GD->thread.engine_pool.stacks) )
+  { GD->thread.engine_pool.stacks = set->next;
+    stack_free(set->global);
+    stack_free(set->trail);
+    stack_free(set);
+  }
+  GD->thread.engine_pool.stack_count = 0;
+}
+#endif /*O_PLMT*/
+
+
 int
 trim_stack(Stack s)
 { if ( s->spare < s->def_spare )
@@ -1705,6 +1822,71 @@ set_stack_limit(size_t limit)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Huge page policy for the stacks.  Values are `false`, `transparent` (or
+`true`), which uses madvise(MADV_HUGEPAGE)   and  `explicit`, which uses
+mmap(MAP_HUGETLB) and falls back to   transparent  huge pages if no huge
+pages are reserved.  Huge  pages  only   apply  to  stacks  large enough
+to be mmapped.  Changing the policy   immediately affects transparent
+huge pages.  Explicit huge pages are used after the next stack shift.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+int
+get_stack_hugepages(term_t t, int *hp)
+{ GET_LD
+  atom_t a;
+
+  if ( !PL_get_atom_ex(t, &a) )
+    return FALSE;
+
+  if ( a == ATOM_false )
+    *hp = STACK_HP_NONE;
+  else if ( a == ATOM_true || a == ATOM_transparent )
+    *hp = STACK_HP_TRANSPARENT;
+  else if ( a == ATOM_explicit )
+    *hp = STACK_HP_EXPLICIT;
+  else
+    return PL_domain_error("stack_hugepages", t);
+
+  return TRUE;
+}
+
+
+atom_t
+stack_hugepages_atom(int hp)
+{ switch(hp)
+  { case STACK_HP_TRANSPARENT:
+      return ATOM_transparent;
+    case STACK_HP_EXPLICIT:
+      return ATOM_explicit;
+    default:
+      return ATOM_false;
+  }
+}
+
+
+int
+set_stack_hugepages(term_t t)
+{ GET_LD
+  int hp;
+
+  if ( !get_stack_hugepages(t, &hp) )
+    return FALSE;
+
+  if ( hp != LD->stacks.hugepages )
+  { LD->stacks.hugepages = hp;
+
+    if ( gBase )
+    { stack_hugepages(gBase-1, hp);	/* see initPrologStacks() */
+      stack_hugepages(tBase, hp);
+      stack_hugepages(aBase, hp);
+    }
+  }
+
+  return TRUE;
+}
+
+
 static
 PRED_IMPL("$set_prolog_stack", 4, set_prolog_stack, 0)
 { PRED_LD
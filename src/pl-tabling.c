@@ -154,6 +154,8 @@ static table_props *get_predicate_table_props(Definition def);
 static int	inner_is_monotonic(ARG1_LD);
 static int	mono_queue_answer(trie *atrie, term_t ans, word an ARG_LD);
 static trie    *idg_propagate_change(idg_node *n, int flags);
+static int	idg_flush_pending(ARG1_LD);
+static void	idg_discard_pending(PL_local_data_t *ld);
 
 #define WL_IS_SPECIAL(wl)  (((intptr_t)(wl)) & 0x1)
 #define WL_IS_WORKLIST(wl) ((wl) && !WL_IS_SPECIAL(wl))
@@ -171,6 +173,15 @@ static trie    *idg_propagate_change(idg_node *n, int flags);
 
 #define DL_IS_DELAY_LIST(dl)	((dl) && (dl) != DL_UNDEFINED)
 
+static uint64_t table_access_clock = 0;	/* see evict_tables() */
+
+static inline unsigned
+table_eviction(const trie *atrie)
+{ Definition def = atrie->data.predicate;
+
+  return def && def->tabling ? (def->tabling->flags&TP_EVICT) : 0;
+}
+
 
 #ifdef O_PLMT
 #define	LOCK_SHARED_TABLE(t)	countingMutexLock(&GD->tabling.mutex);
@@ -219,6 +230,8 @@ static int	table_needs_work(trie *atrie);
 static void	register_waiting(int tid, trie *atrie);
 static void	unregister_waiting(int tid, trie *atrie);
 static int	is_deadlock(trie *atrie);
+static int	offer_help_job(worklist *wl, trie_node *an, term_t a0 ARG_LD);
+static void	abandon_help_jobs(tbl_component *scc);
 
 #else /*O_PLMT*/
 
@@ -289,6 +302,10 @@ free_component(tbl_component *c, int flags)
       free_worklist_set(c->delay_worklists, WLFS_FREE_NONE);
     if ( c->created_worklists )
       free_worklist_set(c->created_worklists, WLFS_FREE_ALL);
+#ifdef O_PLMT
+    if ( c->help_pending )
+      abandon_help_jobs(c);
+#endif
     if ( c->children )
       push_component_set(&stack, c->children);
     if ( c->merged )
@@ -380,6 +397,7 @@ merge_component(tbl_component *c)
 static void
 wl_set_component(worklist *wl, tbl_component *c)
 { wl->component = c;
+  wl->table->data.component = c;
   wl->executing = FALSE;
   if ( !wl->in_global_wl && wl_has_work(wl) )
     add_global_worklist(wl);
@@ -2147,6 +2165,7 @@ restore_tabling_status(tbl_status *state)
 		 *******************************/
 
 static void release_variant_table_node(trie *trie, trie_node *node);
+static int  evict_tables(alloc_pool *pool, size_t bytes);
 
 static trie *
 variant_table(int shared ARG_LD)
@@ -2178,6 +2197,9 @@ variant_table(int shared ARG_LD)
     }
   }
 
+  if ( !pool->reclaim )
+    pool->reclaim = evict_tables;
+
   if ( *tp == NULL )
   { trie *t;
 
@@ -2219,6 +2241,8 @@ reset_answer_table(trie *atrie, int cleanup)
   { atrie->data.worklist = NULL;		/* make fresh again */
   }
   clear(atrie, TRIE_COMPLETE);
+  atrie->data.cost     = 0.0;
+  atrie->data.scc_size = 0;
 
   if ( (n=atrie->data.IDG) )
   { if ( true(atrie, TRIE_ISSHARED) )
@@ -2462,9 +2486,10 @@ retry:
     }
 
 #ifdef O_PLMT
-    if ( !claim_answer_table(atrie, clrefp, flags PASS_LD) )
-    { discardBuffer(&vars);
-      return NULL;
+    if ( !(LD->tabling.helping && table_needs_work(atrie)) &&
+	 !claim_answer_table(atrie, clrefp, flags PASS_LD) )
+    { discardBuffer(&vars);		/* a helper never claims (see */
+      return NULL;			/* offer_help_job()) */
     }
 #endif
 
@@ -2507,6 +2532,7 @@ void
 clearThreadTablingData(PL_local_data_t *ld)
 { reset_global_worklist(ld->tabling.component);
   reset_newly_created_worklists(ld->tabling.component, WLFS_KEEP_COMPLETE);
+  idg_discard_pending(ld);
   clear_variant_table(ld);
 }
 
@@ -2849,6 +2875,7 @@ new_worklist(trie *trie)
   wl->table = trie;
   if ( trie->data.worklist == WL_GROUND )
     wl->ground = TRUE;
+  wl->started = WallTime();
   initBuffer(&wl->delays);
   initBuffer(&wl->pos_undefined);
   trie->data.worklist = wl;
@@ -2913,7 +2940,6 @@ clean_worklist(worklist *wl)
 static void
 complete_worklist(worklist *wl)
 { clean_worklist(wl);
-
   COMPLETE_WORKLIST(wl->table, set(wl->table, TRIE_COMPLETE));
 }
 
@@ -3171,6 +3197,8 @@ unify_complete_or_invalid(term_t t, trie *atrie,
  *     dynamic predicate)
  *   - `fresh` (if `create` is `FALSE`)
  *   - `fresh(SCC, WL)` (if `create` is `TRUE`)
+ *   - `help` (if `create` is `TRUE`, we are helping another thread and
+ *     the table needs work, see offer_help_job())
  *
  * @param `create` If `TRUE`, we are going to use this worklist for
  * filling the trie.  This is used by '$tbl_variant_table'/5 and
@@ -3179,7 +3207,15 @@ unify_complete_or_invalid(term_t t, trie *atrie,
 
 static int
 unify_table_status(term_t t, trie *trie, Definition def, int create ARG_LD)
-{ if ( true(trie, TRIE_COMPLETE) )
+{ if ( !idg_flush_pending(PASS_LD1) )
+    return FALSE;
+
+#ifdef O_PLMT
+  if ( create && LD->tabling.helping && table_needs_work(trie) )
+    return PL_unify_atom(t, ATOM_help);	/* see offer_help_job() */
+#endif
+
+  if ( true(trie, TRIE_COMPLETE) )
   { return unify_complete_or_invalid(t, trie, def, create PASS_LD);
   } else
   { worklist *wl = trie->data.worklist;
@@ -3319,6 +3355,7 @@ tbl_add_worklist(trie *atrie, tbl_component *scc)
     wl = new_worklist(atrie);
 
   wl->component = scc;
+  atrie->data.component = scc;
   add_global_worklist(wl);
   add_newly_created_worklist(wl);
   clear(atrie, TRIE_COMPLETE);
@@ -3424,6 +3461,157 @@ PRED_IMPL("$tbl_destroy_table", 1, tbl_destroy_table, 0)
 }
 
 
+		 /*******************************
+		 *	   TABLE EVICTION	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Tables of predicates declared using `as eviction(Policy)` are caches. If
+allocating a trie node would exceed the   table space, the node pool calls
+evict_tables(), which resets complete  tables   of  such predicates to
+_fresh_, such that they are recomputed when called again.  Tables with the
+`lru` policy are evicted first, least  recently used first.  Next we evict
+tables with the `cost` policy, cheapest  first,   where  the cost is the
+wall time between creating and completing the table.
+
+We only evict tables that are complete, not being enumerated (trie
+references), not part of the IDG and  without conditional answers as
+these may be referenced from delay lists.  The variant trie itself is
+left untouched because we may be adding to it.  Eviction stops if the pool
+is below TABLE_EVICT_TARGET(), such that we do not have to scan the
+variant table for each allocation.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TABLE_EVICT_TARGET(pool) ((pool)->limit/8*7)
+
+typedef struct evict_candidate
+{ trie	       *atrie;			/* Answer trie */
+  unsigned	policy;			/* TP_EVICT_LRU or TP_EVICT_COST */
+  uint64_t	accessed;		/* Last access stamp */
+  double	cost;			/* Time to compute */
+} evict_candidate;
+
+static int
+is_evictable(trie *atrie)
+{ return ( true(atrie, TRIE_COMPLETE) &&
+	   atrie->data.worklist != WL_DYNAMIC &&
+	   !atrie->references &&
+	   !atrie->data.IDG &&
+	   atrie->node_count > 1 );
+}
+
+static void *
+add_evict_candidate(trie_node *n, void *ctx)
+{ trie *atrie;
+  unsigned policy;
+
+  if ( n->value &&
+       (atrie=symbol_trie(n->value)) &&
+       (policy=table_eviction(atrie)) &&
+       is_evictable(atrie) )
+  { evict_candidate c = { .atrie    = atrie,
+			  .policy   = policy,
+			  .accessed = atrie->data.accessed,
+			  .cost     = atrie->data.cost
+			};
+
+    addBuffer((TmpBuffer)ctx, c, evict_candidate);
+  }
+
+  return NULL;
+}
+
+static int
+compare_evict_candidates(const void *p1, const void *p2)
+{ const evict_candidate *c1 = p1;
+  const evict_candidate *c2 = p2;
+
+  if ( c1->policy != c2->policy )
+    return c1->policy == TP_EVICT_LRU ? -1 : 1;
+  if ( c1->policy == TP_EVICT_COST && c1->cost != c2->cost )
+    return c1->cost < c2->cost ? -1 : 1;
+
+  return ( c1->accessed < c2->accessed ? -1 :
+	   c1->accessed > c2->accessed ?  1 : 0 );
+}
+
+static void *
+conditional_answer(trie_node *n, void *ctx)
+{ (void)ctx;
+
+  return n->value && answer_is_conditional(n) ? n : NULL;
+}
+
+static int
+evict_table(trie *atrie)
+{ if ( map_trie_node(&atrie->root, conditional_answer, NULL) )
+    return FALSE;
+
+#ifdef O_PLMT
+  if ( true(atrie, TRIE_ISSHARED) )
+  { int rc = FALSE;
+
+    if ( !countingMutexTryLock(&GD->tabling.mutex) )
+      return FALSE;				/* we may hold it ourselves */
+    if ( !atrie->tid && is_evictable(atrie) )
+    { take_trie(atrie, PL_thread_self());
+      reset_answer_table(atrie, FALSE);
+      drop_trie(atrie);
+      rc = TRUE;
+    }
+    UNLOCK_SHARED_TABLE(atrie);
+
+    return rc;
+  }
+#endif
+
+  reset_answer_table(atrie, FALSE);
+  return TRUE;
+}
+
+static int
+evict_tables(alloc_pool *pool, size_t bytes)
+{ GET_LD
+  trie *vtrie;
+  tmp_buffer buf;
+  evict_candidate *c, *e;
+  size_t target = TABLE_EVICT_TARGET(pool);
+  size_t size0 = pool->size;
+
+  if ( !LD )
+    return FALSE;
+#ifdef O_PLMT
+  if ( pool == GD->tabling.node_pool )
+    vtrie = GD->tabling.variant_table;
+  else
+#endif
+  if ( pool == LD->tabling.node_pool )
+    vtrie = LD->tabling.variant_table;
+  else
+    return FALSE;
+  if ( !vtrie )
+    return FALSE;
+
+  initBuffer(&buf);
+  acquire_trie(vtrie);
+  map_trie_node(&vtrie->root, add_evict_candidate, &buf);
+  release_trie(vtrie);
+  c = baseBuffer(&buf, evict_candidate);
+  e = topBuffer(&buf, evict_candidate);
+  qsort(c, e-c, sizeof(*c), compare_evict_candidates);
+
+  for(; c < e && pool->size+bytes > target; c++)
+  { if ( evict_table(c->atrie) )
+    { DEBUG(MSG_TABLING_ABOLISH,
+	    print_answer_table(c->atrie, "Evicted"));
+    }
+  }
+  discardBuffer(&buf);
+
+  return pool->size < size0;
+}
+
+
 /** '$tbl_pop_worklist'(+SCC, -Worklist) is semidet.
  *
  * Pop next worklist from the component.
@@ -3440,6 +3628,8 @@ PRED_IMPL("$tbl_pop_worklist", 2, tbl_pop_worklist, 0)
 
       if ( (wl=pop_worklist(scc PASS_LD)) )
 	return PL_unify_pointer(A2, wl);
+      if ( scc->help_pending )		/* first collect the helper results */
+	return FALSE;
 
       if (
 #ifndef O_AC_EAGER
@@ -4400,6 +4590,16 @@ PRED_IMPL("$tbl_wkl_work", 6, tbl_wkl_work, PL_FA_NONDETERMINISTIC)
 	  ) )
       break;			/* resource errors */
 
+#ifdef O_PLMT
+    if ( !IS_TNOT(sp->term) &&
+	 offer_help_job(state->list, an, A2 PASS_LD) )
+    { PL_reset_term_refs(susp);
+      Undo(fli_context->mark);
+      can = NULL;
+      continue;
+    }
+#endif
+
     DEBUG(MSG_TABLING_WORK,
 	  { Sdprintf("Work: %d %d\n\t",
 		     (int)state->acp_index,
@@ -4443,10 +4643,27 @@ tbl_variant_table(term_t closure, term_t variant, term_t Trie,
   Definition def = NULL;
   atom_t clref = 0;
 
-  get_closure_predicate(closure, &def);
+  if ( !idg_flush_pending(PASS_LD1) )
+    return FALSE;
+
+  if ( !get_closure_predicate(closure, &def) )
+  { Procedure proc;			/* no closure: lookup the predicate */
+
+    if ( !get_procedure(variant, &proc, 0, GP_RESOLVE) )
+      return FALSE;
+    def = proc->definition;
+  }
 
   if ( (atrie=get_answer_table(def, variant, ret, &clref, flags PASS_LD)) )
-  { if ( !idg_init_variant(atrie, def, variant PASS_LD)  ||
+  { if ( table_eviction(atrie) )
+      atrie->data.accessed = ATOMIC_INC(&table_access_clock);
+    TRIE_STAT_INC(atrie, calls);
+    if ( clref ||
+	 ( true(atrie, TRIE_COMPLETE) &&
+	   complete_or_invalid_status(atrie) == ATOM_complete ) )
+      TRIE_STAT_INC(atrie, reused);
+
+    if ( !idg_init_variant(atrie, def, variant PASS_LD)  ||
 	 !idg_add_edge(atrie, NULL PASS_LD) )
       return FALSE;
 
@@ -4626,6 +4843,32 @@ PRED_IMPL("$tbl_table_status", 4, tbl_table_status, 0)
 }
 
 
+/** '$tbl_reset_statistics'(+ATrie)
+ *
+ * Clear the statistics of an answer trie.  Used by load_tables/1 such
+ * that loading a table is not counted as a call and its load time is
+ * not reported as completion time.
+ */
+
+static
+PRED_IMPL("$tbl_reset_statistics", 1, tbl_reset_statistics, 0)
+{ trie *atrie;
+
+  if ( get_trie(A1, &atrie) )
+  {
+#ifdef O_TRIE_STATS
+    memset(&atrie->stats, 0, sizeof(atrie->stats));
+#endif
+    atrie->data.cost     = 0.0;
+    atrie->data.scc_size = 0;
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+
 /** '$tbl_table_pi'(+ATrie, -PredicateIndicator)
  *
  * Get the predicate indicator that is associated with an answer trie.
@@ -4744,6 +4987,7 @@ PRED_IMPL("$tbl_table_complete_all", 3, tbl_table_complete_all, 0)
     size_t ntables = worklist_set_to_array(c->created_worklists, &wls);
     size_t i;
     int rc;
+    double now = WallTime();
 
     wls_reeval_complete(wls, ntables);
     rc = unify_leader_clause(c, A3 PASS_LD);
@@ -4752,6 +4996,9 @@ PRED_IMPL("$tbl_table_complete_all", 3, tbl_table_complete_all, 0)
     { worklist *wl = wls[i];
       trie *atrie = wl->table;
 
+      atrie->data.cost     = now - wl->started;
+      atrie->data.scc_size = (unsigned int)ntables;
+
       DEBUG(MSG_TABLING_WORK,
 	    { term_t t = PL_new_term_ref();
 	      unify_trie_term(atrie->data.variant, NULL, t PASS_LD);
@@ -6504,6 +6751,7 @@ typedef struct idg_propagate_state
 #define IDG_CHANGED_NODE	0x0001		/* Normal node change */
 #define IDG_CHANGED_MONO	0x0002		/* Monotonic node change */
 #define IDG_PROPAGATE_FORCE	0x0004		/* See (**) */
+#define IDG_CHANGED_NOW		0x0008		/* Do not defer (lazy) */
 
 static void
 idg_changed_loop(idg_propagate_state *state, int flags)
@@ -6634,6 +6882,117 @@ idg_need_invalidated(idg_node *n)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Lazy invalidation (Prolog flag `table_invalidation` is `lazy`)
+
+If a dynamic predicate changes  we  only   mark  its  IDG  node  and
+remember the trie. The transitive propagation of the falsecount to the
+dependent tables is delayed until this thread  looks at a table again,
+which implies that a sequence of  updates   costs  only a single graph
+traversal.  We  only  defer  propagation    for  private  tables  when
+running outside a scheduling component  and   outside  monotonic  assert
+propagation.  Erasing a clause of a  monotonic   dynamic  predicate is
+never deferred: it must mark the dependent  monotonic tables for forced
+re-evaluation before a subsequent  assert  queues   answers  for them.
+Private tables may only be used by  this thread, so `LD->tabling.idg_pending`
+is a complete description of the tables that may be out of date.
+
+The pending table maps trie symbols  to   themselves.  We  keep  the
+symbols registered such that abolishing the   table  cannot free the
+trie. If the IDG node was destroyed we simply skip the entry.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static int
+idg_defer_change(trie *atrie, int flags)
+{ GET_LD
+  Table pending;
+  atom_t symbol;
+
+  if ( !(flags == IDG_CHANGED_NODE &&
+	 true(&LD->tabling, TF_INVALIDATE_LAZY) &&
+	 false(atrie, TRIE_ISSHARED) &&
+	 !LD->tabling.has_scheduling_component &&
+	 !LD->tabling.in_assert_propagation) )
+    return FALSE;
+
+  if ( !(pending=LD->tabling.idg_pending) )
+    pending = LD->tabling.idg_pending = newHTable(4);
+
+  symbol = trie_symbol(atrie);
+  if ( !lookupHTable(pending, (void*)symbol) )
+  { PL_register_atom(symbol);
+    addNewHTable(pending, (void*)symbol, (void*)symbol);
+  }
+
+  DEBUG(MSG_TABLING_IDG_CHANGED, Sdprintf(" (deferred)\n"));
+  return TRUE;
+}
+
+
+static int
+idg_flush_pending(ARG1_LD)
+{ Table pending;
+
+  if ( (pending=LD->tabling.idg_pending) && pending->size > 0 )
+  { tmp_buffer buf;
+    TableEnum en;
+    void *k, *v;
+    atom_t *ap, *end;
+    int rc = TRUE;
+
+    initBuffer(&buf);
+    en = newTableEnum(pending);
+    while( advanceTableEnum(en, &k, &v) )
+      addBuffer(&buf, (atom_t)k, atom_t);
+    freeTableEnum(en);
+    clearHTable(pending);
+
+    ap  = baseBuffer(&buf, atom_t);
+    end = topBuffer(&buf, atom_t);
+    for(; ap < end; ap++)
+    { trie *atrie;
+      idg_node *n;
+
+      if ( rc &&
+	   (atrie=symbol_trie(*ap)) &&
+	   (n=atrie->data.IDG) )
+      { trie *incomplete;
+
+	if ( (incomplete=idg_propagate_change(n, IDG_CHANGED_NODE)) )
+	{ n->falsecount = 0;
+	  idg_propagate_change(n, 0);
+	  rc = change_incomplete_error(incomplete);
+	}
+      }
+      PL_unregister_atom(*ap);
+    }
+    discardBuffer(&buf);
+
+    return rc;
+  }
+
+  return TRUE;
+}
+
+
+static void
+idg_discard_pending(PL_local_data_t *ld)
+{ Table pending;
+
+  if ( (pending=ld->tabling.idg_pending) )
+  { TableEnum en;
+    void *k, *v;
+
+    ld->tabling.idg_pending = NULL;
+    en = newTableEnum(pending);
+    while( advanceTableEnum(en, &k, &v) )
+      PL_unregister_atom((atom_t)k);
+    freeTableEnum(en);
+    destroyHTable(pending);
+  }
+}
+
+
 static int
 idg_changed(trie *atrie, int flags)
 { idg_node *n;
@@ -6650,6 +7009,8 @@ idg_changed(trie *atrie, int flags)
       return change_incomplete_error(atrie);
     if ( ATOMIC_INC(&n->falsecount) == 1 )
     { TRIE_STAT_INC(n, invalidated);
+      if ( idg_defer_change(atrie, flags) )
+	return TRUE;
       if ( (incomplete=idg_propagate_change(n, flags)) )
       { n->falsecount = 0;
 	idg_propagate_change(n, 0);
@@ -6682,7 +7043,7 @@ PRED_IMPL("$idg_falsecount", 2, idg_falsecount, 0)
 { PRED_LD
   trie *atrie;
 
-  if ( get_trie(A1, &atrie) )
+  if ( get_trie(A1, &atrie) && idg_flush_pending(PASS_LD1) )
   { idg_node *n;
 
     if ( (n=atrie->data.IDG) )
@@ -7211,7 +7572,7 @@ PRED_IMPL("$idg_mono_invalidate", 1, idg_mono_invalidate, 0)
 { trie *atrie;
 
   if ( get_trie(A1, &atrie) )
-    return idg_changed(atrie, IDG_CHANGED_NODE);
+    return idg_changed(atrie, IDG_CHANGED_NODE|IDG_CHANGED_NOW);
 
   return FALSE;
 }
@@ -7675,6 +8036,25 @@ setMonotonicMode(atom_t a)
     return PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_table_monotonic, value);
   }
 
+  return TRUE;
+}
+
+int
+setInvalidationMode(atom_t a)
+{ GET_LD
+
+  if ( a == ATOM_eager )
+  { clear(&LD->tabling, TF_INVALIDATE_LAZY);
+    return idg_flush_pending(PASS_LD1);
+  } else if ( a == ATOM_lazy )
+  { set(&LD->tabling, TF_INVALIDATE_LAZY);
+  } else
+  { term_t value = PL_new_term_ref();
+
+    PL_put_atom(value, a);
+    return PL_error(NULL, 0, NULL, ERR_DOMAIN, ATOM_table_invalidation, value);
+  }
+
   return TRUE;
 }
 
@@ -7694,6 +8074,7 @@ tbl_is_predicate_attribute(atom_t key)
 	   key == ATOM_tshared ||
 	   key == ATOM_opaque ||
 	   key == ATOM_lazy ||
+	   key == ATOM_eviction ||
 	   key == ATOM_tabled
 	 );
 }
@@ -7736,6 +8117,12 @@ tbl_get_predicate_attribute(Definition def, atom_t att, term_t value)
     { return PL_unify_integer(value, !!true(p, TP_LAZY));
     } else if ( att == ATOM_tabled )
     { return PL_unify_integer(value, !!true(p, TP_TABLED));
+    } else if ( att == ATOM_eviction )
+    { if ( true(p, TP_EVICT_LRU) )
+	return PL_unify_atom(value, ATOM_lru);
+      if ( true(p, TP_EVICT_COST) )
+	return PL_unify_atom(value, ATOM_cost);
+      return FALSE;
     } else
     { size_t v0;
 
@@ -7824,6 +8211,24 @@ tbl_set_predicate_attribute(Definition def, atom_t att, term_t value)
   { return set_bool_attr(p, TP_LAZY, value);
   } else if ( att == ATOM_tabled )
   { return set_bool_attr(p, TP_TABLED, value);
+  } else if ( att == ATOM_eviction )
+  { atom_t a;
+    unsigned int flag;
+
+    if ( !PL_get_atom_ex(value, &a) )
+      return FALSE;
+    if ( a == ATOM_lru )
+      flag = TP_EVICT_LRU;
+    else if ( a == ATOM_cost )
+      flag = TP_EVICT_COST;
+    else if ( a == ATOM_none )
+      flag = 0;
+    else
+      return PL_domain_error("eviction", value);
+
+    clear(p, TP_EVICT);
+    set(p, flag);
+    return TRUE;
   } else
   { size_t v;
 
@@ -8291,21 +8696,360 @@ is_deadlock(trie *atrie)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Cooperative completion of shared tables.  A thread that waits for another
+thread to complete a shared table  (see claim_answer_table()) helps this
+thread by running continuations of  its   SCC.  The  owner remains the
+only thread that manipulates its  worklists   and  components: it hands
+out an (answer, suspension) pair as a   job  holding the Continuation and
+the TargetSkeleton of the dependency and  adds the answers returned by
+the helper using '$tbl_wkl_add_answer'/4.  See completion_/1.
+
+A helper runs the continuation in a private engine  such that it does not
+touch the tabling state of the waiting thread.   Each thread creates this
+engine the first time it helps and   keeps  it until it terminates.  The
+helper only uses complete tables: it  never   claims  a table and reports
+the status `help` for any table  that   needs  work (see get_answer_table()
+and unify_table_status()).  The tabling  entry   points  then  capture the
+remainder of the continuation by shifting   '$tbl_help_call'(Goal), which
+is returned to the owner.  The owner  calls   Goal  and continues with the
+captured continuation.  Continuations that suspend   on a table are handed
+back the same way.  The owner thus  never   executes  a  part  of a job a
+second time.  An exception raised by  a   job  is  re-raised by the owner,
+as if it had executed the  continuation.   If  the  owner abandons the SCC,
+the helper stops by raising '$tbl_help_bail'.   Jobs are only offered for
+unconditional answers of SCCs without negation and tables that are not
+moded or incremental.
+
+A waiting thread only runs jobs of  the   SCC  of the table it waits for,
+such that it is not busy with  another   SCC  when  its table completes.
+The owner maintains atrie->data.component for this.  The waiter compares
+this pointer with job->scc while holding  the mutex, but never follows
+it.  A stale value therefore only causes a missed or useless job.
+
+The helper engine is not the  owner's   engine.  Continuations  that use
+thread-specific state, such as global   variables,  thread-local
+predicates, the current input and output  or thread_self/1, see the
+state of the helper engine.  This is documented with the flag
+table_parallel_completion, which is false by default.
+
+The job list is protected by GD->tabling.mutex  and changes are signalled
+using GD->tabling.cvar, i.e., the same pair  we use to wait for shared
+tables.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef enum
+{ HJ_QUEUED = 0,			/* Waiting for a helper */
+  HJ_RUNNING,				/* Being processed by a helper */
+  HJ_DONE				/* Waiting for the owner */
+} help_job_status;
+
+typedef struct tbl_help_job
+{ struct tbl_help_job *next;		/* Next in GD->tabling.help.jobs */
+  help_job_status status;		/* HJ_* */
+  tbl_component *scc;			/* Owning SCC (NULL: abandoned) */
+  worklist     *target;			/* Worklist for the answers */
+  record_t	goal;			/* Continuation-TargetSkeleton */
+  record_t	answers;		/* Results (NULL: run by the owner) */
+} tbl_help_job;
+
+
+static int
+help_table(const trie *atrie)
+{ return ( false(atrie, TRIE_ISMAP) && !atrie->data.IDG );
+}
+
+
+static void
+link_help_job(tbl_help_job *job)
+{ tbl_help_job **p = &GD->tabling.help.jobs;
+
+  while(*p)
+    p = &(*p)->next;
+  *p = job;
+}
+
+
+static void
+unlink_help_job(tbl_help_job *job)
+{ tbl_help_job **p;
+
+  for(p = &GD->tabling.help.jobs; *p; p = &(*p)->next)
+  { if ( *p == job )
+    { *p = job->next;
+      return;
+    }
+  }
+}
+
+
+static void
+free_help_job(tbl_help_job *job)
+{ if ( job->goal )
+    PL_erase(job->goal);
+  if ( job->answers )
+    PL_erase(job->answers);
+  freeHeap(job, sizeof(*job));
+}
+
+
+/* offer_help_job() is called from '$tbl_wkl_work'/6 after the dependency
+ * has been unified.  a0 is the answer, followed by the Continuation,
+ * TargetSkeleton, TargetWorklist and Delays.  If the pair may be handled
+ * by a helper, queue it and return TRUE.
+ */
+
+static int
+offer_help_job(worklist *wl, trie_node *an, term_t a0 ARG_LD)
+{ int waiting = GD->tabling.help.waiting;
+  worklist *target;
+  void *ptr;
+  term_t goal;
+  tbl_help_job *job;
+
+  if ( waiting == 0 ||
+       GD->tabling.help.queued >= (size_t)waiting*2 ||
+       !truePrologFlag(PLFLAG_TABLE_PARALLEL) ||
+       LD->tabling.in_answer_completion ||
+       LD->tabling.in_assert_propagation ||
+       !an || answer_is_conditional(an) ||
+       wl->component->neg_status != SCC_NEG_NONE ||
+       !help_table(wl->table) ||
+       !PL_get_nil(a0+4) ||
+       !PL_get_pointer(a0+3, &ptr) ||
+       !help_table((target=ptr)->table) )
+    return FALSE;
+
+  if ( !(goal=PL_new_term_ref()) ||
+       !PL_cons_functor(goal, FUNCTOR_minus2, a0+1, a0+2) )
+  { PL_clear_exception();
+    return FALSE;
+  }
+
+  job = allocHeapOrHalt(sizeof(*job));
+  memset(job, 0, sizeof(*job));
+  job->scc    = wl->component;
+  job->target = target;
+  if ( !(job->goal = PL_record(goal)) )
+  { freeHeap(job, sizeof(*job));
+    return FALSE;
+  }
+
+  LOCK_SHARED_TABLE(NULL);
+  link_help_job(job);
+  GD->tabling.help.queued++;
+  job->scc->help_pending++;
+  cv_broadcast(&GD->tabling.cvar);
+  UNLOCK_SHARED_TABLE(NULL);
+
+  return TRUE;
+}
+
+
+/* Called from free_component() if the SCC is discarded while jobs are
+ * pending, e.g., due to an exception.  Jobs being processed are freed
+ * by the helper.
+ */
+
+static void
+abandon_help_jobs(tbl_component *scc)
+{ tbl_help_job *job, *next;
+
+  LOCK_SHARED_TABLE(NULL);
+  for(job = GD->tabling.help.jobs; job; job = next)
+  { next = job->next;
+
+    if ( job->scc == scc )
+    { if ( job->status == HJ_RUNNING )
+      { job->scc = NULL;
+      } else
+      { if ( job->status == HJ_QUEUED )
+	  GD->tabling.help.queued--;
+	unlink_help_job(job);
+	free_help_job(job);
+      }
+    }
+  }
+  scc->help_pending = 0;
+  UNLOCK_SHARED_TABLE(NULL);
+}
+
+
+/* Run in the helper engine.  Returns a record holding the list of
+ * results or exception(Error) if the job raised an exception.  If the
+ * owner abandoned the job, the result is irrelevant and we return NULL.
+ */
+
+static record_t
+help_job_answers(tbl_help_job *job)
+{ GET_LD
+  static predicate_t pred = NULL;
+  record_t answers = NULL;
+  fid_t fid;
+  term_t av;
+
+  if ( !pred )
+    pred = PL_predicate("$tbl_help_run", 3, "$tabling");
+
+  if ( (fid=PL_open_foreign_frame()) )
+  { if ( (av=PL_new_term_refs(3)) &&
+	 PL_put_pointer(av+0, job) &&
+	 PL_recorded(job->goal, av+1) )
+    { qid_t qid;
+
+      if ( (qid=PL_open_query(NULL, PL_Q_NODEBUG|PL_Q_CATCH_EXCEPTION,
+			      pred, av)) )
+      { term_t ex;
+
+	if ( PL_next_solution(qid) )
+	{ answers = PL_record(av+2);
+	} else if ( (ex=PL_exception(qid)) )
+	{ term_t t;
+
+	  if ( (t=PL_new_term_ref()) &&
+	       PL_unify_term(t, PL_FUNCTOR, FUNCTOR_exception1,
+			          PL_TERM, ex) )
+	    answers = PL_record(t);
+	}
+	PL_cut_query(qid);
+      }
+    }
+    PL_discard_foreign_frame(fid);
+  }
+
+  return answers;
+}
+
+
+/* Process a job from the queue.  Must be called with GD->tabling.mutex
+ * locked, which is released while running the job.  Returns FALSE if
+ * we cannot help, i.e., we failed to create the helper engine.
+ */
+
+static int
+run_help_job(tbl_help_job *job)
+{ GET_LD
+  PL_engine_t me;
+  record_t answers = NULL;
+  int rc = FALSE;
+
+  job->status = HJ_RUNNING;
+  GD->tabling.help.queued--;
+  UNLOCK_SHARED_TABLE(NULL);
+
+  if ( !LD->tabling.help_engine )
+  { PL_thread_attr_t attrs;
+
+    memset(&attrs, 0, sizeof(attrs));
+    attrs.stack_limit = LD->stacks.limit;
+    if ( (LD->tabling.help_engine = PL_create_engine(&attrs)) )
+      LD->tabling.help_engine->tabling.helping = TRUE;
+  }
+  if ( LD->tabling.help_engine &&
+       PL_set_engine(LD->tabling.help_engine, &me) == PL_ENGINE_SET )
+  { answers = help_job_answers(job);
+    PL_set_engine(me, NULL);
+    rc = TRUE;
+  }
+
+  LOCK_SHARED_TABLE(NULL);
+  if ( job->scc && rc )
+  { job->answers = answers;
+    job->status  = HJ_DONE;
+    cv_broadcast(&GD->tabling.cvar);
+  } else if ( job->scc )		/* could not help: back to the queue */
+  { job->status  = HJ_QUEUED;
+    GD->tabling.help.queued++;
+    cv_broadcast(&GD->tabling.cvar);
+  } else				/* abandoned by the owner */
+  { unlink_help_job(job);
+    if ( answers )
+      PL_erase(answers);
+    free_help_job(job);
+  }
+
+  return rc;
+}
+
+
+static tbl_help_job *
+queued_help_job(tbl_component *scc)
+{ tbl_help_job *job;
+
+  for(job = GD->tabling.help.jobs; job; job = job->next)
+  { if ( job->status == HJ_QUEUED && job->scc == scc )
+      return job;
+  }
+
+  return NULL;
+}
+
+
+static tbl_help_job *
+done_help_job(tbl_component *scc)
+{ tbl_help_job *job;
+
+  for(job = GD->tabling.help.jobs; job; job = job->next)
+  { if ( job->status == HJ_DONE && job->scc == scc )
+      return job;
+  }
+
+  return NULL;
+}
+
+
+/* Called from freePrologThread() to destroy the engine the thread used
+ * for helping other threads.
+ */
+
+void
+destroyTablingHelpEngine(PL_local_data_t *ld)
+{ PL_engine_t e;
+
+  if ( (e=ld->tabling.help_engine) )
+  { ld->tabling.help_engine = NULL;
+    PL_destroy_engine(e);
+  }
+}
+
+
 static int
 wait_for_table_to_complete(trie *atrie)
-{ DEBUG(MSG_TABLING_SHARED,
+{ GET_LD
+  int help = ( truePrologFlag(PLFLAG_TABLE_PARALLEL) &&
+	       !LD->tabling.helping );
+
+  DEBUG(MSG_TABLING_SHARED,
 	print_answer_table(atrie, "waiting for %d to complete", atrie->tid));
 
+  if ( help )
+    GD->tabling.help.waiting++;
+
   do
-  { if ( cv_wait(&GD->tabling.cvar, &GD->tabling.mutex.mutex) == CV_INTR )
+  { tbl_help_job *job;
+
+    if ( help && (job=queued_help_job(atrie->data.component)) )
+    { if ( !run_help_job(job) )
+      { GD->tabling.help.waiting--;
+	help = FALSE;
+      }
+      continue;
+    }
+
+    if ( cv_wait(&GD->tabling.cvar, &GD->tabling.mutex.mutex) == CV_INTR )
     { if ( PL_handle_signals() < 0 )
       { DEBUG(MSG_TABLING_SHARED,
 	      print_answer_table(atrie, "Ready (interrupted"));
+	if ( help )
+	  GD->tabling.help.waiting--;
 	return FALSE;
       }
     }
   } while( atrie->tid != 0 );
 
+  if ( help )
+    GD->tabling.help.waiting--;
+
   DEBUG(MSG_TABLING_SHARED,
 	print_answer_table(atrie,
 			   table_needs_work(atrie) ? "Ready (abandonned)"
@@ -8316,6 +9060,99 @@ wait_for_table_to_complete(trie *atrie)
 #endif /*O_PLMT*/
 
 
+/** '$tbl_help_done'(+SCC, +Block, -TargetWorklist, -Result) is semidet.
+ *
+ * Collect the result of a job  handed   out  to a helping thread. Result
+ * is a list of answers for   TargetWorklist  or the Continuation-Skeleton
+ * pair if the job must be executed by the owner.  If Block is `true`,
+ * wait for a pending job.  Fails if there are no (completed) jobs.
+ */
+
+static
+PRED_IMPL("$tbl_help_done", 4, tbl_help_done, 0)
+{
+#ifdef O_PLMT
+  PRED_LD
+  tbl_component *scc;
+  int block;
+
+  if ( get_scc(A1, &scc) && scc->help_pending > 0 &&
+       PL_get_bool_ex(A2, &block) )
+  { tbl_help_job *job;
+    term_t t;
+    int rc;
+
+    LOCK_SHARED_TABLE(NULL);
+    while( !(job=done_help_job(scc)) )
+    { if ( !block )
+      { UNLOCK_SHARED_TABLE(NULL);
+	return FALSE;
+      }
+      if ( (job=queued_help_job(scc)) )	/* no helper took it; do it ourselves */
+      { GD->tabling.help.queued--;
+	break;
+      }
+      if ( cv_wait(&GD->tabling.cvar, &GD->tabling.mutex.mutex) == CV_INTR &&
+	   PL_handle_signals() < 0 )
+      { UNLOCK_SHARED_TABLE(NULL);
+	return FALSE;
+      }
+    }
+    unlink_help_job(job);
+    scc->help_pending--;
+    UNLOCK_SHARED_TABLE(NULL);
+
+    rc = ( (t=PL_new_term_ref()) &&
+	   PL_recorded(job->answers ? job->answers : job->goal, t) &&
+	   PL_unify_pointer(A3, job->target) &&
+	   PL_unify(A4, t) );
+    free_help_job(job);
+
+    return rc;
+  }
+#endif
+
+  return FALSE;
+}
+
+
+/** '$tbl_help_abandoned'(+Job) is semidet.
+ *
+ * True if the owner no longer needs the result of Job.  Called by
+ * '$tbl_help_run'/3.
+ */
+
+static
+PRED_IMPL("$tbl_help_abandoned", 1, tbl_help_abandoned, 0)
+{
+#ifdef O_PLMT
+  void *ptr;
+
+  if ( PL_get_pointer_ex(A1, &ptr) )
+  { tbl_help_job *job = ptr;
+
+    return job->scc == NULL;
+  }
+#endif
+
+  return FALSE;
+}
+
+
+/** '$tbl_helping' is semidet.
+ *
+ * True if we run in the engine that helps completing a shared table
+ * (see offer_help_job()).
+ */
+
+static
+PRED_IMPL("$tbl_helping", 0, tbl_helping, 0)
+{ PRED_LD
+
+  return LD->tabling.helping;
+}
+
+
 		 /*******************************
 		 *	     UNTABLE		*
 		 *******************************/
@@ -8370,6 +9207,7 @@ initTabling(void)
   setPrologFlag("max_table_answer_size",	  FT_INTEGER, -1);
   setPrologFlag("max_answers_for_subgoal",	  FT_INTEGER, -1);
   setPrologFlag("table_monotonic",	          FT_ATOM,    "eager");
+  setPrologFlag("table_invalidation",	          FT_ATOM,    "eager");
 }
 
 		 /*******************************
@@ -8390,6 +9228,9 @@ BeginPredDefs(tabling)
   PRED_DEF("$tbl_wkl_is_false",		1, tbl_wkl_is_false,	     0)
   PRED_DEF("$tbl_wkl_answer_trie",	2, tbl_wkl_answer_trie,      0)
   PRED_DEF("$tbl_wkl_work",		6, tbl_wkl_work,          NDET)
+  PRED_DEF("$tbl_help_done",		4, tbl_help_done,	     0)
+  PRED_DEF("$tbl_help_abandoned",	1, tbl_help_abandoned,	     0)
+  PRED_DEF("$tbl_helping",		0, tbl_helping,		     0)
   PRED_DEF("$tbl_variant_table",	6, tbl_variant_table,	     0)
   PRED_DEF("$tbl_abstract_table",       6, tbl_abstract_table,       0)
   PRED_DEF("$tbl_existing_variant_table", 5, tbl_existing_variant_table, 0)
@@ -8404,6 +9245,7 @@ BeginPredDefs(tabling)
   PRED_DEF("$tbl_table_status",         2, tbl_table_status,         0)
   PRED_DEF("$tbl_table_status",		4, tbl_table_status,	     0)
   PRED_DEF("$tbl_table_pi",             2, tbl_table_pi,	     0)
+  PRED_DEF("$tbl_reset_statistics",     1, tbl_reset_statistics,     0)
   PRED_DEF("$tbl_table_complete_all",	3, tbl_table_complete_all,   0)
   PRED_DEF("$tbl_free_component",       1, tbl_free_component,       0)
   PRED_DEF("$tbl_table_discard_all",    1, tbl_table_discard_all,    0)
@@ -47,6 +47,7 @@ typedef enum
 #define COMPONENT_MAGIC	0x67e9124f
 
 #define TF_MONOTONIC_LAZY	0x0001
+#define TF_INVALIDATE_LAZY	0x0002
 
 
 		 /*******************************
@@ -85,6 +86,7 @@ typedef struct tbl_component
   worklist_set         *created_worklists;	/* Worklists created */
   worklist_set	       *delay_worklists;	/* Worklists in need for delays */
   trie		       *leader;			/* Leading variant */
+  size_t		help_pending;		/* # jobs handed to helpers */
 } tbl_component;
 
 typedef struct tbl_status
@@ -129,6 +131,7 @@ typedef struct worklist
   tbl_component*component;		/* component I belong to */
   trie	       *table;			/* My answer table */
   Definition	predicate;		/* Predicate we are associated with */
+  double	started;		/* WallTime() at creation */
 
   buffer	delays;			/* Delayed answers */
   buffer	pos_undefined;		/* Positive undefined */
@@ -276,6 +279,9 @@ COMMON(void)	merge_tabling_trail(tbl_trail *into, tbl_trail *from);
 #define TP_SHARED	(0x0004)	/* Shared tabling */
 #define TP_OPAQUE	(0x0008)	/* Declared opaque */
 #define TP_LAZY		(0x0010)	/* Lazy (monotonic) */
+#define TP_EVICT_LRU	(0x0020)	/* eviction(lru) */
+#define TP_EVICT_COST	(0x0040)	/* eviction(cost) */
+#define TP_EVICT	(TP_EVICT_LRU|TP_EVICT_COST)
 
 typedef struct table_props
 { unsigned int	flags;			/* TP_* flags */
@@ -292,6 +298,7 @@ typedef struct table_props
 		 *******************************/
 
 COMMON(void)	clearThreadTablingData(PL_local_data_t *ld);
+COMMON(void)	destroyTablingHelpEngine(PL_local_data_t *ld);
 COMMON(term_t)	init_delay_list(void);
 COMMON(void)	tbl_push_delay(atom_t atrie, Word wrapper,
 			       trie_node *answer ARG_LD);
@@ -310,4 +317,5 @@ COMMON(int)	tbl_is_restraint_flag(atom_t key);
 COMMON(int)	tbl_get_restraint_flag(term_t t, atom_t key ARG_LD);
 COMMON(int)	tbl_set_restraint_flag(term_t t, atom_t key ARG_LD);
 COMMON(int)	setMonotonicMode(atom_t a);
+COMMON(int)	setInvalidationMode(atom_t a);
 #endif /*_PL_TABLING_H*/
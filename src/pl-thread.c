@@ -59,6 +59,19 @@
 #include "pl-comp.h"
 #include <stdio.h>
 #include <math.h>
+#if defined(HAVE_DLADDR) && defined(HAVE_DLFCN_H)
+#include <dlfcn.h>
+#endif
+#ifdef O_QUEUE_WAKEUP
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+#endif
 
 #if __WINDOWS__				/* this is a stub.  Should be detected */
 #undef HAVE_PTHREAD_SETNAME_NP		/* in configure.ac */
@@ -134,6 +147,21 @@ _syscall0(pid_t,gettid)
 typedef cpuset_t cpu_set_t;
 #endif
 
+/* NUMA placement uses the Linux system calls directly such that we do
+ * not depend on libnuma.
+ */
+#if defined(__linux__) && defined(SYS_set_mempolicy) && \
+    defined(SYS_move_pages) && defined(SYS_getcpu) && \
+    defined(HAVE_PTHREAD_ATTR_SETAFFINITY_NP)
+#define O_NUMA 1
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1<<1)
+#endif
+#endif
+
 #ifdef HAVE_SEMA_INIT			/* Solaris */
 #include <synch.h>
 
@@ -451,15 +479,28 @@ static void	destroy_thread_message_queue(message_queue *queue);
 static void	init_message_queue(message_queue *queue, size_t max_size);
 static size_t	sizeof_message_queue(message_queue *queue);
 static size_t	sizeof_local_definitions(PL_local_data_t *ld);
+static void	free_local_slots(void);
 static void	freeThreadSignals(PL_local_data_t *ld);
 static thread_handle *create_thread_handle(PL_thread_info_t *info);
 static void	free_thread_info(PL_thread_info_t *info);
 static void	set_system_thread_id(PL_thread_info_t *info);
+#ifdef O_NUMA
+static void	numa_localise_thread(PL_thread_info_t *info);
+static int	get_numa_cpuset(int node, cpu_set_t *set);
+#endif
 static thread_handle *symbol_thread_handle(atom_t a);
 static void	destroy_interactor(thread_handle *th, int gc);
 static PL_engine_t PL_current_engine(void);
 static void	detach_engine(PL_engine_t e);
 static void	free_thread_wait(PL_local_data_t *ld);
+static int	get_resource_limits(term_t options, atom_t opttype,
+				    resource_limits *l);
+static void	set_resource_limits(PL_local_data_t *ld,
+				    const resource_limits *l);
+#ifdef O_QUEUE_WAKEUP
+static void	signal_wakeup(thread_wakeup *w);
+static void	free_thread_wakeup(PL_local_data_t *ld);
+#endif
 
 static int	unify_queue(term_t t, message_queue *q);
 static int	get_message_queue_unlocked__LD(term_t t, message_queue **queue ARG_LD);
@@ -580,9 +621,23 @@ clean_ld_free_list(void)
 }
 
 static void
-maybe_free_local_data(PL_local_data_t *ld)
+maybe_free_local_data(PL_local_data_t *ld, int is_engine)
 { if ( !ldata_in_use(ld) )
-  { free_local_data(ld);
+  { if ( is_engine &&
+	 GD->thread.engine_pool.ldata_count < GD->thread.engine_pool.size )
+    { PL_LOCK(L_THREAD);
+      if ( GD->thread.engine_pool.ldata_count < GD->thread.engine_pool.size )
+      { simpleMutexDelete(&ld->thread.scan_lock);
+	ld->next_free = GD->thread.engine_pool.ldata;
+	GD->thread.engine_pool.ldata = ld;
+	GD->thread.engine_pool.ldata_count++;
+	ld = NULL;
+      }
+      PL_UNLOCK(L_THREAD);
+      if ( !ld )
+	return;
+    }
+    free_local_data(ld);
   } else
   { PL_LOCK(L_THREAD);
     clean_ld_free_list();
@@ -603,6 +658,7 @@ static void
 freePrologThread(PL_local_data_t *ld, int after_fork)
 { PL_thread_info_t *info;
   int acknowledge;
+  int is_engine;
   double time;
   PL_local_data_t *old_ld;
 
@@ -617,6 +673,7 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
   { GET_LD
 
     info = ld->thread.info;
+    is_engine = info->is_engine;
     DEBUG(MSG_THREAD, Sdprintf("Freeing prolog thread %d (status = %d)\n",
 			       info->pl_tid, info->status));
 
@@ -646,6 +703,7 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
 	info->in_exit_hooks = FALSE;
 	ld->critical--;   /* endCritical */
       }
+      destroyTablingHelpEngine(ld);
     } else
     { acknowledge = FALSE;
       info->detached = TRUE;		/* cleanup */
@@ -658,13 +716,17 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
 
     destroy_event_list(&ld->event.hook.onthreadexit);
     free_thread_wait(ld);
+#ifdef O_QUEUE_WAKEUP
+    free_thread_wakeup(ld);
+#endif
     cleanupLocalDefinitions(ld);
 
     DEBUG(MSG_THREAD, Sdprintf("Destroying data\n"));
     ld->magic = 0;
     if ( ld->stacks.global.base )		/* otherwise not initialised */
     { simpleMutexLock(&ld->thread.scan_lock);
-      freeStacks(ld);
+      if ( !(is_engine && !after_fork && poolStacks(ld)) )
+	freeStacks(ld);
       simpleMutexUnlock(&ld->thread.scan_lock);
     }
     freePrologLocalData(ld);
@@ -690,6 +752,10 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
     if ( ld->locale.current )
       releaseLocale(ld->locale.current);
   #endif
+    if ( info->access.ldata )		/* see acquire_ldata() */
+    { info->access.ldata = NULL;
+      ATOMIC_DEC(&GD->thread.ldata_accessing);
+    }
     info->thread_data = NULL;		/* avoid a loop */
     info->has_tid = FALSE;		/* needed? */
     if ( !after_fork )
@@ -698,8 +764,9 @@ freePrologThread(PL_local_data_t *ld, int after_fork)
     if ( info->detached || acknowledge )
       free_thread_info(info);
 
+    flush_slab_cache(&ld->slab);	/* return cached objects */
     ld->thread.info = NULL;		/* help force a crash if ld used */
-    maybe_free_local_data(ld);
+    maybe_free_local_data(ld, is_engine && !after_fork);
 
     if ( acknowledge )			/* == canceled */
     { DEBUG(MSG_CLEANUP_THREAD,
@@ -770,6 +837,7 @@ reinit_threads_after_fork(void)
     m->lock_count = 0;
 #ifdef O_CONTENTION_STATISTICS
     m->collisions = 0;
+    memset(&m->waits, 0, sizeof(m->waits));
 #endif
   }
 
@@ -872,6 +940,10 @@ initPrologThreads(void)
     info->pl_tid = 1;
     info->debug = TRUE;
     GD->thread.highest_id = 1;
+    GD->thread.engine_pool.size = ENGINE_POOL_SIZE;
+#ifdef O_CONTENTION_STATISTICS
+    simpleMutexInit(&GD->thread.mutex_samples.lock);
+#endif
     info->thread_data = &PL_local_data;
     info->status = PL_THREAD_RUNNING;
     PL_local_data.thread.info = info;
@@ -920,6 +992,21 @@ cleanupThreads(void)
     if ( info )
       freeHeap(info, sizeof(*info));
   }
+  while( GD->thread.engine_pool.ldata )
+  { PL_local_data_t *ld = GD->thread.engine_pool.ldata;
+
+    GD->thread.engine_pool.ldata = ld->next_free;
+    freeHeap(ld, sizeof(*ld));
+  }
+  GD->thread.engine_pool.ldata_count = 0;
+  freeStackPool();
+  free_local_slots();
+#ifdef O_CONTENTION_STATISTICS
+  if ( GD->thread.mutex_samples.ring )
+  { free(GD->thread.mutex_samples.ring);
+    GD->thread.mutex_samples.ring = NULL;
+  }
+#endif
   freeHeap(GD->thread.threads,
 	   GD->thread.thread_max * sizeof(*GD->thread.threads));
   GD->thread.threads = NULL;
@@ -1362,7 +1449,18 @@ alloc_thread(void)
 { PL_thread_info_t *info;
   PL_local_data_t *ld;
 
-  ld = allocHeapOrHalt(sizeof(PL_local_data_t));
+  ld = NULL;
+  if ( GD->thread.engine_pool.ldata )
+  { PL_LOCK(L_THREAD);
+    if ( (ld=GD->thread.engine_pool.ldata) )
+    { GD->thread.engine_pool.ldata = ld->next_free;
+      GD->thread.engine_pool.ldata_count--;
+      GD->thread.engine_pool.reused++;
+    }
+    PL_UNLOCK(L_THREAD);
+  }
+  if ( !ld )
+    ld = allocHeapOrHalt(sizeof(PL_local_data_t));
   memset(ld, 0, sizeof(PL_local_data_t));
 
   do
@@ -1510,6 +1608,12 @@ alertThread(PL_thread_info_t *info)
         cv_broadcast(&ld->thread.alert.obj.queue->drain_var);
 	done = TRUE;
 	break;
+#ifdef O_QUEUE_WAKEUP
+      case ALERT_WAKEUP_FD:
+	signal_wakeup(ld->thread.alert.obj.wakeup);
+	done = TRUE;
+	break;
+#endif
     }
     PL_UNLOCK(L_ALERT);
     if ( done )
@@ -1741,6 +1845,8 @@ static const opt_spec make_thread_options[] =
   { ATOM_inherit_from,	 OPT_TERM },
   { ATOM_affinity,	 OPT_TERM },
   { ATOM_queue_max_size, OPT_SIZE },
+  { ATOM_stack_hugepages, OPT_TERM },
+  { ATOM_numa_node,	 OPT_INT },
   { NULL_ATOM,		 0 }
 };
 
@@ -1776,6 +1882,10 @@ start_thread(void *closure)
   blockSignal(SIGINT);			/* only the main thread processes */
 					/* Control-C */
   set_system_thread_id(info);		/* early to get exit code ok */
+#ifdef O_NUMA
+  if ( info->numa_local )
+    numa_localise_thread(info);		/* before allocating the stacks */
+#endif
 
   if ( !initialise_thread(info) )
     return (void *)FALSE;
@@ -1885,6 +1995,7 @@ copy_local_data(PL_local_data_t *ldnew, PL_local_data_t *ldold,
   ldnew->arith.rat                = ldold->arith.rat;
 #endif
   ldnew->arith.f                  = ldold->arith.f;
+  ldnew->stacks.hugepages	  = ldold->stacks.hugepages;
   if ( ldold->prolog_flag.table )
   { PL_LOCK(L_PLFLAG);
     ldnew->prolog_flag.table	  = copyHTable(ldold->prolog_flag.table);
@@ -1964,14 +2075,30 @@ get_cpuset(term_t affinity, cpu_set_t *set)
 
 #endif /*defined(HAVE_PTHREAD_ATTR_SETAFFINITY_NP) || defined(HAVE_SCHED_SETAFFINITY)*/
 
+/* set_affinity() binds the thread to the CPUs in affinity.  If the thread
+ * is also bound to a NUMA node (numa_node >= 0), only the CPUs of the
+ * node are used.  thread_create/3 verified that this set is not empty.
+ */
+
 static int
-set_affinity(term_t affinity, pthread_attr_t *attr)
+set_affinity(term_t affinity, int numa_node, pthread_attr_t *attr)
 {
 #ifdef HAVE_PTHREAD_ATTR_SETAFFINITY_NP
   cpu_set_t cpuset;
 
   if ( !get_cpuset(affinity, &cpuset) )
     return EINVAL;
+#ifdef O_NUMA
+  if ( numa_node >= 0 )
+  { cpu_set_t nodeset;
+
+    if ( !get_numa_cpuset(numa_node, &nodeset) )
+      return EINVAL;
+    CPU_AND(&cpuset, &cpuset, &nodeset);
+  }
+#else
+  (void)numa_node;
+#endif
 
   return pthread_attr_setaffinity_np(attr, sizeof(cpuset), &cpuset);
 #endif
@@ -1980,6 +2107,115 @@ set_affinity(term_t affinity, pthread_attr_t *attr)
 }
 
 
+		 /*******************************
+		 *	  NUMA PLACEMENT	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The thread_create/3 option numa_node(Node) runs the thread on the CPUs of
+Node and makes Node the preferred node  for the memory it allocates.  If
+the thread is bound to a node  or  a   CPU  set  (affinity  option), the
+thread's stacks are allocated by  the  new   thread  itself  and  thus
+first-touched on the right node.  Its  PL_local_data_t, however, has been
+allocated and initialised by the  creating   thread  and  is moved using
+move_pages().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_NUMA
+
+static int
+get_numa_cpuset(int node, cpu_set_t *set)
+{ char fname[100];
+  FILE *fd;
+  int rc = FALSE;
+
+  Ssprintf(fname, "/sys/devices/system/node/node%d/cpulist", node);
+  CPU_ZERO(set);
+  if ( (fd=fopen(fname, "r")) )
+  { int from, to, c;
+
+    while ( fscanf(fd, "%d", &from) == 1 )
+    { to = from;
+      if ( (c=fgetc(fd)) == '-' )
+      { if ( fscanf(fd, "%d", &to) != 1 )
+	  break;
+	c = fgetc(fd);
+      }
+      for( ; from <= to && from < CPU_SETSIZE; from++ )
+      { CPU_SET(from, set);
+	rc = TRUE;
+      }
+      if ( c != ',' )
+	break;
+    }
+    fclose(fd);
+  }
+
+  return rc;
+}
+
+
+static int
+set_numa_affinity(int node, pthread_attr_t *attr)
+{ cpu_set_t cpuset;
+
+  if ( !get_numa_cpuset(node, &cpuset) )
+    return EINVAL;
+
+  return pthread_attr_setaffinity_np(attr, sizeof(cpuset), &cpuset);
+}
+
+
+static void
+numa_localise_thread(PL_thread_info_t *info)
+{ int node = info->numa_node;
+  uintptr_t psize = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)info->thread_data;
+  uintptr_t end   = start + sizeof(PL_local_data_t);
+  size_t count;
+
+  if ( node >= 0 )
+  { unsigned long mask[16] = {0};
+
+    if ( node < (int)(sizeof(mask)*8) )
+    { mask[node/(sizeof(long)*8)] |= 1UL<<(node%(sizeof(long)*8));
+      (void)syscall(SYS_set_mempolicy, MPOL_PREFERRED,
+		    mask, (unsigned long)sizeof(mask)*8);
+    }
+  } else
+  { unsigned int cpu, n;
+
+    if ( syscall(SYS_getcpu, &cpu, &n, NULL) != 0 )
+      return;
+    node = (int)n;
+  }
+
+  start = (start+psize-1) & ~(psize-1);	/* pages only used by ld */
+  end   = end & ~(psize-1);
+  if ( end > start && (count = (end-start)/psize) > 0 )
+  { void **pages = malloc(count*sizeof(*pages));
+    int   *nodes = malloc(count*sizeof(*nodes));
+    int   *status = malloc(count*sizeof(*status));
+
+    if ( pages && nodes && status )
+    { size_t i;
+
+      for(i=0; i<count; i++)
+      { pages[i] = (void*)(start+i*psize);
+	nodes[i] = node;
+      }
+      (void)syscall(SYS_move_pages, 0, (unsigned long)count,
+		    pages, nodes, status, MPOL_MF_MOVE);
+    }
+    free(pages);
+    free(nodes);
+    free(status);
+  }
+}
+
+#endif /*O_NUMA*/
+
+
 word
 pl_thread_create(term_t goal, term_t id, term_t options)
 { GET_LD
@@ -1994,10 +2230,14 @@ pl_thread_create(term_t goal, term_t id, term_t options)
   term_t at_exit = 0;
   term_t affinity = 0;
   size_t queue_max_size = 0;
+  term_t hugepages = 0;
+  int hp = STACK_HP_NONE;
+  int numa_node = -1;
   int rc = 0;
   const char *func;
   int debug = -1;
   int detached = FALSE;
+  resource_limits limits = {0};
 
   if ( !PL_is_callable(goal) )
     return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_callable, goal);
@@ -2022,11 +2262,55 @@ pl_thread_create(term_t goal, term_t id, term_t options)
 		     &at_exit,
 		     &inherit_from,
 		     &affinity,
-		     &queue_max_size) )
+		     &queue_max_size,
+		     &hugepages,
+		     &numa_node) ||
+       !get_resource_limits(options, ATOM_thread_option, &limits) )
   { free_thread_info(info);
     fail;
   }
   info->detached = detached;
+  if ( hugepages && !get_stack_hugepages(hugepages, &hp) )
+  { free_thread_info(info);
+    return FALSE;
+  }
+  if ( numa_node < -1 )
+  { term_t ex = PL_new_term_ref();
+
+    free_thread_info(info);
+    return ( PL_put_integer(ex, numa_node) &&
+	     PL_error(NULL, 0, NULL, ERR_DOMAIN,
+		      ATOM_not_less_than_zero, ex) );
+  }
+#ifdef O_NUMA
+  if ( numa_node >= 0 )
+  { cpu_set_t cpuset;
+
+    if ( !get_numa_cpuset(numa_node, &cpuset) )
+    { term_t ex = PL_new_term_ref();
+
+      free_thread_info(info);
+      return ( PL_put_integer(ex, numa_node) &&
+	       PL_error(NULL, 0, NULL, ERR_EXISTENCE,
+			ATOM_numa_node, ex) );
+    }
+    if ( affinity )			/* run on CpuSet AND Node */
+    { cpu_set_t cpus;
+
+      if ( !get_cpuset(affinity, &cpus) )
+      { free_thread_info(info);
+	return FALSE;
+      }
+      CPU_AND(&cpus, &cpus, &cpuset);
+      if ( CPU_COUNT(&cpus) == 0 )
+      { free_thread_info(info);
+	return PL_domain_error("numa_node_cpu_affinity", affinity);
+      }
+    }
+  }
+  info->numa_node  = numa_node;
+  info->numa_local = (numa_node >= 0 || affinity);
+#endif
   if ( at_exit && !PL_is_callable(at_exit) )
   { free_thread_info(info);
     return PL_error(NULL, 0, NULL, ERR_TYPE, ATOM_callable, at_exit);
@@ -2078,6 +2362,10 @@ pl_thread_create(term_t goal, term_t id, term_t options)
   info->goal = PL_record(goal);
   info->module = PL_context();
   copy_local_data(ldnew, ldold, queue_max_size);
+  set_resource_limits(ldnew, &limits);
+  updateAlerted(ldnew);
+  if ( hugepages )
+    ldnew->stacks.hugepages = hp;
   if ( at_exit )
     register_event_hook(&ldnew->event.hook.onthreadexit, 0, FALSE, at_exit, 0);
 
@@ -2087,7 +2375,11 @@ pl_thread_create(term_t goal, term_t id, term_t options)
     rc = pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
   }
   if ( rc == 0 && affinity )
-    rc = set_affinity(affinity, &attr);
+    rc = set_affinity(affinity, numa_node, &attr);
+#ifdef O_NUMA
+  else if ( rc == 0 && numa_node >= 0 )
+    rc = set_numa_affinity(numa_node, &attr);
+#endif
   if ( rc == 0 )
   {
 #ifdef USE_COPY_STACK_SIZE
@@ -3160,13 +3452,16 @@ PRED_IMPL("$engine_create", 3, engine_create, 0)
   size_t stack	      =	0;
   atom_t alias	      =	NULL_ATOM;
   term_t inherit_from =	0;
+  resource_limits limits = {0};
+  double t0	      = WallTime();
 
   memset(&attrs, 0, sizeof(attrs));
   if ( !scan_options(A3, 0,
 		     ATOM_engine_option, make_engine_options,
 		     &stack,
 		     &alias,
-		     &inherit_from) )
+		     &inherit_from) ||
+       !get_resource_limits(A3, ATOM_engine_option, &limits) )
     return FALSE;
 
   if ( stack )
@@ -3183,6 +3478,8 @@ PRED_IMPL("$engine_create", 3, engine_create, 0)
     int rc;
 
     new->thread.info->is_engine = TRUE;
+    set_resource_limits(new, &limits);
+    updateAlerted(new);
     th = create_thread_handle(new->thread.info);
     set(th, TH_IS_INTERACTOR);
     ATOMIC_INC(&GD->statistics.engines_created);
@@ -3229,6 +3526,10 @@ PRED_IMPL("$engine_create", 3, engine_create, 0)
 
     PL_erase(r);
 
+    PL_LOCK(L_THREAD);
+    GD->statistics.engine_create_time += WallTime() - t0;
+    PL_UNLOCK(L_THREAD);
+
     return TRUE;
   }
 
@@ -3571,6 +3872,7 @@ typedef enum
 static int dispatch_cond_wait(message_queue *queue,
 			      queue_wait_type wait,
 			      struct timespec *deadline ARG_LD);
+static void signal_readers(message_queue *queue);
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 This code deals with telling other threads something.  The interface:
@@ -3593,6 +3895,7 @@ typedef struct thread_message
   record_t            message;		/* message in queue */
   word		      key;		/* Indexing key */
   uint64_t	      sequence_id;	/* Numbered sequence */
+  int		      priority;		/* Priority in priority queue */
 } thread_message;
 
 
@@ -3604,10 +3907,11 @@ create_thread_message(term_t msg ARG_LD)
   if ( !(rec=compileTermToHeap(msg, R_NOLOCK)) )
     return NULL;
 
-  if ( (msgp = allocHeap(sizeof(*msgp))) )
-  { msgp->next    = NULL;
-    msgp->message = rec;
-    msgp->key     = getIndexOfTerm(msg);
+  if ( (msgp = alloc_from_pool(&GD->alloc_pools.messages, sizeof(*msgp))) )
+  { msgp->next     = NULL;
+    msgp->message  = rec;
+    msgp->key      = getIndexOfTerm(msg);
+    msgp->priority = 0;
   } else
   { freeRecord(rec);
   }
@@ -3621,7 +3925,103 @@ free_thread_message(thread_message *msg)
 { if ( msg->message )
     freeRecord(msg->message);
 
-  freeHeap(msg, sizeof(*msg));
+  free_to_pool(&GD->alloc_pools.messages, msg, sizeof(*msg));
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A priority queue (message_queue_create/2  option priority(true)) keeps
+its messages ordered on descending priority and  in FIFO order for equal
+priorities.  Thus, getting a message with   an  unbound pattern pops the
+head and selective receive finds the  highest priority match first. The
+array queue->segments holds the last message   of each priority in the
+queue, sorted on descending priority.  Adding a message finds its place
+using binary search on the segments,  so   the  cost  depends  on the
+number of distinct priorities rather than on the length of the queue.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct prio_segment
+{ int		  priority;		/* Priority of the segment */
+  thread_message *tail;			/* Last message with this priority */
+} prio_segment;
+
+/* find_segment() returns the index of the segment for priority or the
+ * index at which such a segment must be inserted.
+ */
+
+static size_t
+find_segment(message_queue *queue, int priority)
+{ size_t l = 0, h = queue->segment_count;
+
+  while( l < h )
+  { size_t m = (l+h)/2;
+
+    if ( queue->segments[m].priority > priority )
+      l = m+1;
+    else
+      h = m;
+  }
+
+  return l;
+}
+
+
+static void
+queue_prio_message(message_queue *queue, thread_message *msgp)
+{ size_t i = find_segment(queue, msgp->priority);
+  thread_message *after;
+
+  if ( i < queue->segment_count &&
+       queue->segments[i].priority == msgp->priority )
+  { after = queue->segments[i].tail;
+  } else
+  { if ( queue->segment_count == queue->segment_allocated )
+    { size_t n = queue->segment_allocated ? queue->segment_allocated*2 : 4;
+
+      queue->segments = PL_realloc(queue->segments,
+				   n*sizeof(*queue->segments));
+      queue->segment_allocated = n;
+    }
+    memmove(&queue->segments[i+1], &queue->segments[i],
+	    (queue->segment_count-i)*sizeof(*queue->segments));
+    queue->segment_count++;
+    queue->segments[i].priority = msgp->priority;
+    after = (i > 0 ? queue->segments[i-1].tail : NULL);
+  }
+  queue->segments[i].tail = msgp;
+
+  if ( after )
+  { msgp->next = after->next;
+    after->next = msgp;
+    if ( queue->tail == after )
+      queue->tail = msgp;
+  } else
+  { if ( !(msgp->next = queue->head) )
+      queue->tail = msgp;
+    queue->head = msgp;
+  }
+}
+
+
+/* unlink_prio_message() updates the segments if msgp, which follows
+ * prev, is removed from a priority queue.
+ */
+
+static void
+unlink_prio_message(message_queue *queue,
+		    thread_message *msgp, thread_message *prev)
+{ size_t i = find_segment(queue, msgp->priority);
+  prio_segment *s = &queue->segments[i];
+
+  assert(i < queue->segment_count && s->priority == msgp->priority);
+  if ( s->tail == msgp )
+  { if ( prev && prev->priority == msgp->priority )
+    { s->tail = prev;
+    } else
+    { memmove(s, s+1, (queue->segment_count-i-1)*sizeof(*s));
+      queue->segment_count--;
+    }
+  }
 }
 
 
@@ -3669,16 +4069,71 @@ queue_message(message_queue *queue, thread_message *msgp,
   }
 
   msgp->sequence_id = ++queue->sequence_next;
-  if ( !queue->head )
+  if ( queue->priority )
+  { queue_prio_message(queue, msgp);
+  } else if ( !queue->head )
   { queue->head = queue->tail = msgp;
   } else
   { queue->tail->next = msgp;
     queue->tail = msgp;
   }
   queue->size++;
+  signal_readers(queue);
+
+  return TRUE;
+}
+
+
+#ifdef O_QUEUE_WAKEUP
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+A thread waiting in thread_get_message_any/4  or wait_for_input/3 cannot
+wait on the condition variables of all   its queues.  Instead, it adds a
+queue_watch to the watchers of each   queue and waits on its own wakeup,
+an eventfd or pipe that can also be   passed to poll() together with the
+file descriptors of streams.  A watcher   counts  as waiting, so senders
+that find queue->waiting non-zero call signal_readers(), which writes to
+the wakeup of each watcher.  wakeup->signalled  avoids writing again to
+a wakeup that was not yet drained.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+signal_wakeup(thread_wakeup *w)
+{ if ( COMPARE_AND_SWAP_INT(&w->signalled, FALSE, TRUE) )
+  { uint64_t one = 1;
+    ssize_t rc;
+
+#ifdef HAVE_SYS_EVENTFD_H
+    rc = write(w->fd[1], &one, sizeof(one));
+#else
+    rc = write(w->fd[1], &one, 1);
+#endif
+    (void)rc;				/* EAGAIN: pipe is full */
+  }
+}
+
+static void
+signal_watchers(message_queue *queue)
+{ queue_watch *w;
+
+  for(w=queue->watchers; w; w=w->next)
+    signal_wakeup(w->wakeup);
+}
+#endif /*O_QUEUE_WAKEUP*/
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+signal_readers() wakes up threads waiting for a message on queue.  The
+caller must hold the queue-mutex.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-  if ( queue->waiting )
-  { if ( queue->waiting > queue->waiting_var && queue->waiting > 1 )
+static void
+signal_readers(message_queue *queue)
+{ if ( queue->waiting )
+  {
+#ifdef O_QUEUE_WAKEUP
+    signal_watchers(queue);
+#endif
+    if ( queue->waiting > queue->waiting_var && queue->waiting > 1 )
     { DEBUG(MSG_QUEUE,
 	    Sdprintf("%d: %d of %d non-var waiters on %p; broadcasting\n",
 		     PL_thread_self(),
@@ -3695,8 +4150,104 @@ queue_message(message_queue *queue, thread_message *msgp,
   { DEBUG(MSG_QUEUE, Sdprintf("%d: no waiters on %p\n",
 			      PL_thread_self(), queue));
   }
+}
 
-  return TRUE;
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Lock-free sending.  Messages sent to an  unbounded queue are pushed onto
+queue->inbox using compare-and-swap  without   locking  queue->mutex. A
+reader holds queue->mutex and moves the   inbox  to the queue using
+collect_inbox() before it looks at the queue.  As a result, the senders
+do not contend for the queue mutex under high fan-in.  A sender only
+locks the mutex if it must signal waiting readers.  The sender first
+pushes and then reads queue->waiting, while a reader first increments
+queue->waiting and then checks the inbox  before waiting. Thus, either
+the reader sees the message or the sender sees the waiting reader.
+
+queue->senders counts the senders that use   the queue without holding
+its mutex.  After setting queue->destroyed, code that destroys a queue
+must call wait_for_senders() before discarding it.
+
+Bounded queues (max_size), selective receive and peeking use the queue
+under its mutex as before.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+/* push_inbox() pushes the chain first..last of n messages, linked in
+ * FIFO order, onto the inbox using a single compare-and-swap.  As the
+ * inbox is LIFO, the chain is reversed first.
+ */
+
+static void
+push_inbox(message_queue *queue,
+	   thread_message *first, thread_message *last, size_t n)
+{ thread_message *head, *msgp, *next, *top = NULL;
+
+  for(msgp = first; msgp; msgp = next)	/* reverse: FIFO -> LIFO */
+  { next = msgp->next;
+    msgp->next = top;
+    top = msgp;
+  }
+
+  ATOMIC_ADD(&queue->inbox_size, n);
+  do
+  { head = queue->inbox;
+    first->next = head;
+  } while ( !COMPARE_AND_SWAP_PTR(&queue->inbox, head, last) );
+}
+
+
+/* collect_inbox() moves the messages from the inbox to the queue in the
+ * order in which they were pushed.  The caller must hold the queue-mutex.
+ */
+
+static void
+collect_inbox(message_queue *queue)
+{ if ( queue->inbox )
+  { thread_message *list, *msgp, *next, *first = NULL, *last = NULL;
+    size_t n = 0;
+
+    simpleMutexLock(&queue->gc_mutex);	/* see markAtomsMessageQueue() */
+    do
+    { list = queue->inbox;
+    } while ( !COMPARE_AND_SWAP_PTR(&queue->inbox, list, NULL) );
+
+    for(msgp = list; msgp; msgp = next)	/* reverse: LIFO -> FIFO */
+    { next = msgp->next;
+      msgp->next = first;
+      first = msgp;
+      if ( !last )
+	last = msgp;
+      n++;
+    }
+    for(msgp = first; msgp; msgp = msgp->next)
+      msgp->sequence_id = ++queue->sequence_next;
+
+    if ( first )
+    { if ( !queue->head )
+	queue->head = first;
+      else
+	queue->tail->next = first;
+      queue->tail = last;
+    }
+    simpleMutexUnlock(&queue->gc_mutex);
+
+    queue->size += n;
+    ATOMIC_SUB(&queue->inbox_size, n);
+  }
+}
+
+
+static void
+wait_for_senders(message_queue *queue)
+{ MEMORY_BARRIER();
+  while ( queue->senders > 0 )
+  {
+#ifdef __WINDOWS__
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+  }
 }
 
 
@@ -3907,10 +4458,29 @@ cv_timedwait(message_queue *queue,
 
 #endif /*__WINDOWS__*/
 
+/* wait_clock() returns a monotonic time in nanoseconds that is used to
+ * measure how long a thread is blocked.
+ */
+
+uint64_t
+wait_clock(void)
+{ struct timespec now;
+
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  get_current_timespec(&now);
+#endif
+
+  return (uint64_t)now.tv_sec*1000000000 + (uint64_t)now.tv_nsec;
+}
+
+
 static int
 dispatch_cond_wait(message_queue *queue, queue_wait_type wait,
 		   struct timespec *deadline ARG_LD)
-{ int rc;
+{ uint64_t t0 = wait_clock();
+  int rc;
 
   LD->thread.alert.obj.queue = queue;
   LD->thread.alert.type	     = wait == QUEUE_WAIT_READ ? ALERT_QUEUE_RD
@@ -3926,6 +4496,7 @@ dispatch_cond_wait(message_queue *queue, queue_wait_type wait,
   LD->thread.alert.type = 0;
   LD->thread.alert.obj.queue = NULL;
   PL_UNLOCK(L_ALERT);
+  LD->accounting.usage.queue_wait += wait_clock()-t0;
 
   return rc;
 }
@@ -3970,106 +4541,145 @@ we also need to lock to avoid  get_message() destroying the record while
 markAtomsMessageQueue() scans it. This fixes the reopened Bug#142.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+/* scan_message_queue() searches the queue for a message that unifies
+ * with msg and removes it.  seen is the sequence id of the last message
+ * examined in a previous scan.  It is not used for priority queues as
+ * these are not ordered on sequence id.  Returns TRUE if a message was found,
+ * FALSE on an exception and -1 if there is no matching message.  Must
+ * be called with queue->mutex locked.
+ */
+
 static int
-get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
-{ int isvar = PL_is_variable(msg) ? 1 : 0;
-  word key = (isvar ? 0L : getIndexOfTerm(msg));
-  fid_t fid = PL_open_foreign_frame();
-  uint64_t seen = 0;
+scan_message_queue(message_queue *queue, term_t msg, word key, int isvar,
+		   uint64_t *seen, fid_t fid ARG_LD)
+{ thread_message *msgp;
+  thread_message *prev = NULL;
 
-  QSTAT(getmsg);
+  collect_inbox(queue);
+  msgp = queue->head;
 
   DEBUG(MSG_QUEUE,
-	{ Sdprintf("%d: get_message(%p) key 0x%lx for ",
-		   PL_thread_self(), queue, key);
-	  PL_write_term(Serror, msg, 1200, PL_WRT_QUOTED|PL_WRT_NEWLINE);
-	});
+	Sdprintf("%d: queue size=%ld\n",
+		 PL_thread_self(), (long)queue->size));
 
-  for(;;)
-  { int rc;
-    thread_message *msgp = queue->head;
-    thread_message *prev = NULL;
+  for( ; msgp; prev = msgp, msgp = msgp->next )
+  { term_t tmp;
+    int rc;
 
-    if ( queue->destroyed )
-      return MSG_WAIT_DESTROYED;
+    if ( msgp->sequence_id < *seen && !queue->priority )
+    { QSTAT(skipped);
+      DEBUG(MSG_QUEUE, Sdprintf("Already seen %ld (<%ld)\n",
+				(long)msgp->sequence_id, (long)*seen));
+      continue;
+    }
+    *seen = msgp->sequence_id;
+
+    if ( key && msgp->key && key != msgp->key )
+    { DEBUG(MSG_QUEUE, Sdprintf("Message key mismatch\n"));
+      continue;				/* fast search */
+    }
+    if ( !isvar && !mayUnifyRecord(msgp->message, msg PASS_LD) )
+    { DEBUG(MSG_QUEUE, Sdprintf("Message does not match\n"));
+      continue;				/* avoid copying the message */
+    }
 
+    QSTAT(unified);
+    tmp = PL_new_term_ref();
+    if ( !PL_recorded(msgp->message, tmp) )
+      return raiseStackOverflow(GLOBAL_OVERFLOW);
     DEBUG(MSG_QUEUE,
-	  Sdprintf("%d: queue size=%ld\n",
-		   PL_thread_self(), (long)queue->size));
+	  { Sdprintf("%d: found term ", PL_thread_self());
+	    PL_write_term(Serror, tmp, 1200, PL_WRT_QUOTED|PL_WRT_NEWLINE);
+	  });
 
-    for( ; msgp; prev = msgp, msgp = msgp->next )
-    { term_t tmp;
+    rc = PL_unify(msg, tmp);
 
-      if ( msgp->sequence_id < seen )
-      { QSTAT(skipped);
-	DEBUG(MSG_QUEUE, Sdprintf("Already seen %ld (<%ld)\n",
-				  (long)msgp->sequence_id, (long)seen));
-	continue;
-      }
-      seen = msgp->sequence_id;
+    if ( rc )
+    { term_t ex = PL_new_term_ref();
 
-      if ( key && msgp->key && key != msgp->key )
-      { DEBUG(MSG_QUEUE, Sdprintf("Message key mismatch\n"));
-	continue;			/* fast search */
+      if ( !(rc=foreignWakeup(ex PASS_LD)) )
+      { if ( !isVar(*valTermRef(ex)) )
+	  PL_raise_exception(ex);
       }
+    }
 
-      QSTAT(unified);
-      tmp = PL_new_term_ref();
-      if ( !PL_recorded(msgp->message, tmp) )
-      { PL_discard_foreign_frame(fid);
-        return raiseStackOverflow(GLOBAL_OVERFLOW);
-      }
-      DEBUG(MSG_QUEUE,
-	    { Sdprintf("%d: found term ", PL_thread_self());
-	      PL_write_term(Serror, tmp, 1200, PL_WRT_QUOTED|PL_WRT_NEWLINE);
-	    });
+    if ( rc )
+    { DEBUG(MSG_QUEUE, Sdprintf("%d: match\n", PL_thread_self()));
 
-      rc = PL_unify(msg, tmp);
+      if (GD->atoms.gc_active)
+	markAtomsRecord(msgp->message);
 
-      if ( rc )
-      { term_t ex = PL_new_term_ref();
-
-	if ( !(rc=foreignWakeup(ex PASS_LD)) )
-	{ if ( !isVar(*valTermRef(ex)) )
-	    PL_raise_exception(ex);
-	}
+      simpleMutexLock(&queue->gc_mutex);	/* see (*) */
+      if ( queue->priority )
+	unlink_prio_message(queue, msgp, prev);
+      if ( prev )
+      { if ( !(prev->next = msgp->next) )
+	  queue->tail = prev;
+      } else
+      { if ( !(queue->head = msgp->next) )
+	  queue->tail = NULL;
+      }
+      simpleMutexUnlock(&queue->gc_mutex);
+
+      free_thread_message(msgp);
+      queue->size--;
+      LD->accounting.usage.messages_received++;
+      if ( queue->wait_for_drain )
+      { DEBUG(MSG_QUEUE, Sdprintf("Queue drained. wakeup writers\n"));
+	cv_signal(&queue->drain_var);
       }
 
-      if ( rc )
-      { DEBUG(MSG_QUEUE, Sdprintf("%d: match\n", PL_thread_self()));
+      return TRUE;
+    } else if ( exception_term )
+    { return FALSE;
+    }
 
-	if (GD->atoms.gc_active)
-	  markAtomsRecord(msgp->message);
+    PL_rewind_foreign_frame(fid);
+  }
 
-        simpleMutexLock(&queue->gc_mutex);	/* see (*) */
-	if ( prev )
-	{ if ( !(prev->next = msgp->next) )
-	    queue->tail = prev;
-	} else
-	{ if ( !(queue->head = msgp->next) )
-	    queue->tail = NULL;
-	}
-        simpleMutexUnlock(&queue->gc_mutex);
+  return -1;
+}
 
-	free_thread_message(msgp);
-	queue->size--;
-	if ( queue->wait_for_drain )
-	{ DEBUG(MSG_QUEUE, Sdprintf("Queue drained. wakeup writers\n"));
-	  cv_signal(&queue->drain_var);
-	}
 
+static int
+get_message(message_queue *queue, term_t msg, struct timespec *deadline ARG_LD)
+{ int isvar = PL_is_variable(msg) ? 1 : 0;
+  word key = (isvar ? 0L : getIndexOfTerm(msg));
+  fid_t fid = PL_open_foreign_frame();
+  uint64_t seen = 0;
+
+  QSTAT(getmsg);
+
+  DEBUG(MSG_QUEUE,
+	{ Sdprintf("%d: get_message(%p) key 0x%lx for ",
+		   PL_thread_self(), queue, key);
+	  PL_write_term(Serror, msg, 1200, PL_WRT_QUOTED|PL_WRT_NEWLINE);
+	});
+
+  for(;;)
+  { int rc;
+
+    if ( queue->destroyed )
+      return MSG_WAIT_DESTROYED;
+
+    rc = scan_message_queue(queue, msg, key, isvar, &seen, fid PASS_LD);
+    switch( rc )
+    { case TRUE:
 	PL_close_foreign_frame(fid);
 	return TRUE;
-      } else if ( exception_term )
-      { PL_close_foreign_frame(fid);
+      case FALSE:
+	PL_close_foreign_frame(fid);
 	return FALSE;
-      }
-
-      PL_rewind_foreign_frame(fid);
     }
 
     queue->waiting++;
     queue->waiting_var += isvar;
+    MEMORY_BARRIER();			/* see push_inbox() */
+    if ( queue->inbox )
+    { queue->waiting--;
+      queue->waiting_var -= isvar;
+      continue;
+    }
     DEBUG(MSG_QUEUE_WAIT, Sdprintf("%d: waiting on queue\n", PL_thread_self()));
     rc = dispatch_cond_wait(queue, QUEUE_WAIT_READ, deadline PASS_LD);
     switch ( rc )
@@ -4119,11 +4729,12 @@ peek_message(message_queue *queue, term_t msg ARG_LD)
   word key = getIndexOfTerm(msg);
   fid_t fid = PL_open_foreign_frame();
 
-  msgp = queue->head;
-
+  collect_inbox(queue);
   for( msgp = queue->head; msgp; msgp = msgp->next )
   { if ( key && msgp->key && key != msgp->key )
       continue;
+    if ( !mayUnifyRecord(msgp->message, msg PASS_LD) )
+      continue;
 
     if ( !PL_recorded(msgp->message, tmp) )
       return raiseStackOverflow(GLOBAL_OVERFLOW);
@@ -4155,12 +4766,17 @@ destroy_message_queue(message_queue *queue)
 
   assert(!queue->waiting && !queue->wait_for_drain);
 
+  collect_inbox(queue);
   for( msgp = queue->head; msgp; msgp = next )
   { next = msgp->next;
 
     free_thread_message(msgp);
   }
 
+  if ( queue->segments )
+  { PL_free(queue->segments);
+    queue->segments = NULL;
+  }
   simpleMutexDelete(&queue->gc_mutex);
   cv_destroy(&queue->cond_var);
   if ( queue->max_size > 0 )
@@ -4187,7 +4803,11 @@ destroy_thread_message_queue(message_queue *q)
     q->destroyed = TRUE;
     if ( q->waiting || q->wait_for_drain )
     { if ( q->waiting )
-	cv_broadcast(&q->cond_var);
+      { cv_broadcast(&q->cond_var);
+#ifdef O_QUEUE_WAKEUP
+	signal_watchers(q);
+#endif
+      }
       if ( q->wait_for_drain )
 	cv_broadcast(&q->drain_var);
     } else
@@ -4195,6 +4815,7 @@ destroy_thread_message_queue(message_queue *q)
     simpleMutexUnlock(&q->mutex);
   }
 
+  wait_for_senders(q);
   destroy_message_queue(q);
 }
 
@@ -4222,6 +4843,10 @@ sizeof_message_queue(message_queue *queue)
   { size += sizeof(*msgp);
     size += msgp->message->size;
   }
+  for( msgp = queue->inbox; msgp; msgp = msgp->next )
+  { size += sizeof(*msgp);
+    size += msgp->message->size;
+  }
   simpleMutexUnlock(&queue->gc_mutex);
 
   return size;
@@ -4345,15 +4970,28 @@ wait_queue_message(term_t qterm, message_queue *q, thread_message *msg,
   return rc;
 }
 
+static int lockfree_send_messages(term_t qterm,
+				  thread_message *first, thread_message *last,
+				  size_t n ARG_LD);
+
 static int
 thread_send_message__LD(term_t queue, term_t msgterm,
-			struct timespec *deadline ARG_LD)
+			struct timespec *deadline, int priority ARG_LD)
 { message_queue *q;
   thread_message *msg;
   int rc;
 
   if ( !(msg = create_thread_message(msgterm PASS_LD)) )
     return PL_no_memory();
+  msg->priority = priority;
+
+  if ( (rc=lockfree_send_messages(queue, msg, msg, 1 PASS_LD)) >= 0 )
+  { if ( rc )
+      LD->accounting.usage.messages_sent++;
+    else
+      free_thread_message(msg);
+    return rc;
+  }
 
   if ( !get_message_queue__LD(queue, &q PASS_LD) )
   { free_thread_message(msg);
@@ -4365,6 +5003,8 @@ thread_send_message__LD(term_t queue, term_t msgterm,
 
   if ( rc == FALSE )
     free_thread_message(msg);
+  else if ( rc == TRUE )
+    LD->accounting.usage.messages_sent++;
 
   return rc;
 }
@@ -4373,17 +5013,102 @@ static
 PRED_IMPL("thread_send_message", 2, thread_send_message, PL_FA_ISO)
 { PRED_LD
 
-  return thread_send_message__LD(A1, A2, NULL PASS_LD);
+  return thread_send_message__LD(A1, A2, NULL, 0 PASS_LD);
 }
 
+static const opt_spec send_message_options[] =
+{ { ATOM_priority,	OPT_INT },
+  { NULL_ATOM,		0 }
+};
+
 static
 PRED_IMPL("thread_send_message", 3, thread_send_message, 0)
 { PRED_LD
   struct timespec deadline;
   struct timespec *dlop=NULL;
+  int priority = 0;
 
   return process_deadline_options(A3,&deadline,&dlop)
-    &&   thread_send_message__LD(A1, A2, dlop PASS_LD);
+    &&   scan_options(A3, 0, ATOM_timeout_option, send_message_options,
+		      &priority)
+    &&   thread_send_message__LD(A1, A2, dlop, priority PASS_LD);
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_send_messages(+Queue, +List)
+    Send all elements of List to Queue.  The messages are recorded before
+    the queue is accessed.  For an unbounded queue they are added as one
+    block, i.e., messages sent concurrently by other threads are not
+    interleaved.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+free_thread_messages(thread_message *msgp)
+{ thread_message *next;
+
+  for( ; msgp; msgp = next )
+  { next = msgp->next;
+    free_thread_message(msgp);
+  }
+}
+
+
+static
+PRED_IMPL("thread_send_messages", 2, thread_send_messages, 0)
+{ PRED_LD
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  thread_message *first = NULL, *last = NULL, *msgp, *next;
+  message_queue *q;
+  size_t count = 0;
+  int rc = TRUE;
+
+  while( PL_get_list_ex(tail, head, tail) )
+  { if ( !(msgp = create_thread_message(head PASS_LD)) )
+    { free_thread_messages(first);
+      return PL_no_memory();
+    }
+    if ( last )
+      last->next = msgp;
+    else
+      first = msgp;
+    last = msgp;
+    count++;
+  }
+  if ( !PL_get_nil_ex(tail) )
+  { free_thread_messages(first);
+    return FALSE;
+  }
+
+  if ( first &&
+       (rc=lockfree_send_messages(A1, first, last, count PASS_LD)) >= 0 )
+  { if ( rc )
+      LD->accounting.usage.messages_sent += count;
+    else
+      free_thread_messages(first);
+    return rc;
+  }
+
+  if ( !get_message_queue__LD(A1, &q PASS_LD) )
+  { free_thread_messages(first);
+    return FALSE;
+  }
+
+  for(msgp = first; msgp; msgp = next)
+  { next = msgp->next;
+    msgp->next = NULL;
+
+    if ( !(rc=wait_queue_message(A1, q, msgp, NULL PASS_LD)) )
+    { free_thread_message(msgp);
+      free_thread_messages(next);
+      break;
+    }
+    LD->accounting.usage.messages_sent++;
+  }
+  release_message_queue(q);
+
+  return rc;
 }
 
 
@@ -4522,7 +5247,7 @@ free_queue_symbol(void *name, void *value)
 
 
 static message_queue *
-unlocked_message_queue_create(term_t queue, long max_size)
+unlocked_message_queue_create(term_t queue, long max_size, int priority)
 { GET_LD
   atom_t name = NULL_ATOM;
   message_queue *q;
@@ -4553,6 +5278,7 @@ unlocked_message_queue_create(term_t queue, long max_size)
   q = PL_malloc(sizeof(*q));
   init_message_queue(q, max_size);
   q->type = QTYPE_QUEUE;
+  q->priority = priority;		/* before the queue is visible */
   if ( !id )
   { mqref ref;
     int new;
@@ -4687,6 +5413,53 @@ get_message_queue__LD(term_t t, message_queue **queue ARG_LD)
 }
 
 
+/* lockfree_send_messages() sends the n messages first..last to qterm
+ * without locking the queue if the queue is unbounded.  Returns TRUE if
+ * the messages were sent, FALSE on an error and -1 if the caller must use
+ * the locked path.  See push_inbox().
+ */
+
+static int
+lockfree_send_messages(term_t qterm,
+		       thread_message *first, thread_message *last, size_t n
+		       ARG_LD)
+{ message_queue *q;
+  PL_blob_t *type;
+  void *data;
+
+  if ( PL_get_blob(qterm, &data, NULL, &type) && type == &message_queue_blob )
+  { mqref *ref = data;
+
+    q = ref->queue;
+    ATOMIC_INC(&q->senders);
+  } else
+  { int rc;
+
+    PL_LOCK(L_THREAD);
+    if ( (rc=get_message_queue_unlocked__LD(qterm, &q PASS_LD)) )
+      ATOMIC_INC(&q->senders);
+    PL_UNLOCK(L_THREAD);
+    if ( !rc )
+      return FALSE;
+  }
+
+  if ( q->destroyed || !q->initialized || q->max_size > 0 || q->priority )
+  { ATOMIC_DEC(&q->senders);
+    return -1;
+  }
+
+  push_inbox(q, first, last, n);
+  if ( q->waiting )
+  { simpleMutexLock(&q->mutex);
+    signal_readers(q);
+    simpleMutexUnlock(&q->mutex);
+  }
+  ATOMIC_DEC(&q->senders);
+
+  return TRUE;
+}
+
+
 /* Release a message queue, deleting it if it is no longer needed
 */
 
@@ -4699,7 +5472,8 @@ release_message_queue(message_queue *queue)
   simpleMutexUnlock(&queue->mutex);
 
   if ( del )
-  { destroy_message_queue(queue);
+  { wait_for_senders(queue);
+    destroy_message_queue(queue);
     if ( !queue->anonymous )
       PL_free(queue);
   }
@@ -4711,7 +5485,7 @@ PRED_IMPL("message_queue_create", 1, message_queue_create, 0)
 { int rval;
 
   PL_LOCK(L_THREAD);
-  rval = (unlocked_message_queue_create(A1, 0) ? TRUE : FALSE);
+  rval = (unlocked_message_queue_create(A1, 0, FALSE) ? TRUE : FALSE);
   PL_UNLOCK(L_THREAD);
 
   return rval;
@@ -4721,6 +5495,7 @@ PRED_IMPL("message_queue_create", 1, message_queue_create, 0)
 static const opt_spec message_queue_options[] =
 { { ATOM_alias,		OPT_ATOM },
   { ATOM_max_size,	OPT_SIZE },
+  { ATOM_priority,	OPT_BOOL },
   { NULL_ATOM,		0 }
 };
 
@@ -4730,12 +5505,14 @@ PRED_IMPL("message_queue_create", 2, message_queue_create2, 0)
 { PRED_LD
   atom_t alias = 0;
   size_t max_size = 0;			/* to be processed */
+  int priority = FALSE;
   message_queue *q;
 
   if ( !scan_options(A2, 0,
 		     ATOM_queue_option, message_queue_options,
 		     &alias,
-		     &max_size) )
+		     &max_size,
+		     &priority) )
     fail;
 
   if ( alias )
@@ -4744,7 +5521,7 @@ PRED_IMPL("message_queue_create", 2, message_queue_create2, 0)
   }
 
   PL_LOCK(L_THREAD);
-  q = unlocked_message_queue_create(A1, max_size);
+  q = unlocked_message_queue_create(A1, max_size, priority);
   PL_UNLOCK(L_THREAD);
 
   return q ? TRUE : FALSE;
@@ -4778,7 +5555,11 @@ PRED_IMPL("message_queue_destroy", 1, message_queue_destroy, 0)
   simpleMutexUnlock(&q->gc_mutex);
 
   if ( q->waiting )
-    cv_broadcast(&q->cond_var);
+  { cv_broadcast(&q->cond_var);
+#ifdef O_QUEUE_WAKEUP
+    signal_watchers(q);
+#endif
+  }
   if ( q->wait_for_drain )
     cv_broadcast(&q->drain_var);
 
@@ -4803,7 +5584,7 @@ message_queue_alias_property(message_queue *q, term_t prop ARG_LD)
 
 static int		/* message_queue_property(Queue, size(Size)) */
 message_queue_size_property(message_queue *q, term_t prop ARG_LD)
-{ return PL_unify_integer(prop, q->size);
+{ return PL_unify_integer(prop, q->size + q->inbox_size);
 }
 
 
@@ -4817,6 +5598,14 @@ message_queue_max_size_property(message_queue *q, term_t prop ARG_LD)
   fail;
 }
 
+static int		/* message_queue_property(Queue, priority(Bool)) */
+message_queue_priority_property(message_queue *q, term_t prop ARG_LD)
+{ if ( q->priority )
+    return PL_unify_bool(prop, TRUE);
+
+  fail;
+}
+
 static int		/* message_queue_property(Queue, waiting(Count)) */
 message_queue_waiting_property(message_queue *q, term_t prop ARG_LD)
 { int waiting;
@@ -4831,6 +5620,7 @@ static const tprop qprop_list [] =
 { { FUNCTOR_alias1,	    message_queue_alias_property },
   { FUNCTOR_size1,	    message_queue_size_property },
   { FUNCTOR_max_size1,	    message_queue_max_size_property },
+  { FUNCTOR_priority1,	    message_queue_priority_property },
   { FUNCTOR_waiting1,	    message_queue_waiting_property },
   { 0,			    NULL }
 };
@@ -5103,6 +5893,387 @@ PRED_IMPL("thread_get_message", 3, thread_get_message, 0)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_get_messages(+Queue, -List, +Options)
+    Wait for a message as thread_get_message/3 and unify List with this
+    message followed by up to max(N)-1 further messages that are already
+    in the queue.  The queue mutex is acquired only once.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static const opt_spec get_messages_options[] =
+{ { ATOM_max,		OPT_SIZE|OPT_INF },
+  { NULL_ATOM,		0 }
+};
+
+static
+PRED_IMPL("thread_get_messages", 3, thread_get_messages, 0)
+{ PRED_LD
+  struct timespec deadline;
+  struct timespec *dlop=NULL;
+  size_t max = (size_t)-1;
+  term_t tail = PL_copy_term_ref(A2);
+  term_t head = PL_new_term_ref();
+  int rc;
+
+  if ( !process_deadline_options(A3,&deadline,&dlop) ||
+       !scan_options(A3, 0, ATOM_timeout_option, get_messages_options, &max) )
+    return FALSE;
+
+  if ( max == 0 )
+    return PL_unify_nil(A2);
+  if ( !PL_unify_list(tail, head, tail) )
+    return FALSE;
+
+  for(;;)
+  { message_queue *q;
+    size_t count = 1;
+
+    if ( !get_message_queue__LD(A1, &q PASS_LD) )
+      return FALSE;
+
+    if ( (rc=get_message(q, head, dlop PASS_LD)) == TRUE )
+    { while( count < max )
+      { collect_inbox(q);
+	if ( !q->head )
+	  break;
+	if ( !PL_unify_list(tail, head, tail) ||
+	     get_message(q, head, NULL PASS_LD) != TRUE )
+	{ rc = FALSE;
+	  break;
+	}
+	count++;
+      }
+    }
+    release_message_queue(q);
+
+    if ( rc == MSG_WAIT_INTR )
+    { if ( PL_handle_signals() >= 0 )
+	continue;
+      return FALSE;
+    }
+
+    break;
+  }
+
+  switch(rc)
+  { case TRUE:
+      return PL_unify_nil(tail);
+    case MSG_WAIT_DESTROYED:
+      return PL_error(NULL, 0, NULL, ERR_EXISTENCE, ATOM_message_queue, A1);
+    default:
+      return FALSE;
+  }
+}
+
+
+#ifdef O_QUEUE_WAKEUP
+
+		 /*******************************
+		 *     MULTIPLEXED WAITING	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The wakeup of a thread is created  lazily.   We  use an eventfd where
+available and a non-blocking pipe otherwise.   A thread that waits for a
+set of queues (and possibly streams) proceeds as follows:
+
+  1. Add a queue_watch to each queue using watch_message_queue()
+  2. Drain the wakeup using drain_thread_wakeup()
+  3. Scan the queues.  If nothing is found, poll() the wakeup
+  4. Goto 2
+
+As the watchers are added before scanning, a message that is sent after
+the scan always signals the wakeup.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static thread_wakeup *
+get_thread_wakeup(ARG1_LD)
+{ thread_wakeup *w;
+
+  if ( (w=LD->thread.wakeup) )
+    return w;
+
+  if ( !(w = malloc(sizeof(*w))) )
+  { PL_no_memory();
+    return NULL;
+  }
+  w->signalled = FALSE;
+#ifdef HAVE_SYS_EVENTFD_H
+  if ( (w->fd[0] = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC)) < 0 )
+  { free(w);
+    PL_resource_error("file_descriptors");
+    return NULL;
+  }
+  w->fd[1] = w->fd[0];
+#else
+  if ( pipe(w->fd) != 0 )
+  { free(w);
+    PL_resource_error("file_descriptors");
+    return NULL;
+  }
+  { int i;
+
+    for(i=0; i<2; i++)
+    { fcntl(w->fd[i], F_SETFL, fcntl(w->fd[i], F_GETFL)|O_NONBLOCK);
+      fcntl(w->fd[i], F_SETFD, FD_CLOEXEC);
+    }
+  }
+#endif
+
+  return LD->thread.wakeup = w;
+}
+
+
+static void
+free_thread_wakeup(PL_local_data_t *ld)
+{ thread_wakeup *w;
+
+  if ( (w=ld->thread.wakeup) )
+  { ld->thread.wakeup = NULL;
+    close(w->fd[0]);
+    if ( w->fd[1] != w->fd[0] )
+      close(w->fd[1]);
+    free(w);
+  }
+}
+
+
+int
+thread_wakeup_fd(ARG1_LD)
+{ thread_wakeup *w = get_thread_wakeup(PASS_LD1);
+
+  return w ? w->fd[0] : -1;
+}
+
+
+void
+drain_thread_wakeup(ARG1_LD)
+{ thread_wakeup *w;
+
+  if ( (w=LD->thread.wakeup) )
+  { char buf[64];
+
+    w->signalled = FALSE;
+    MEMORY_BARRIER();
+    while( read(w->fd[0], buf, sizeof(buf)) > 0 )
+      ;
+  }
+}
+
+
+/* watch_message_queue() resolves qterm  to  a   queue  and adds w to its
+ * watchers.  As a watcher counts as waiting,  the queue is not discarded
+ * while it is watched.
+ */
+
+int
+watch_message_queue(term_t qterm, queue_watch *w ARG_LD)
+{ message_queue *q;
+
+  if ( !(w->wakeup = get_thread_wakeup(PASS_LD1)) ||
+       !get_message_queue__LD(qterm, &q PASS_LD) )
+    return FALSE;
+
+  w->queue = q;
+  w->seen  = 0;
+  w->prev  = NULL;
+  if ( (w->next = q->watchers) )
+    w->next->prev = w;
+  q->watchers = w;
+  q->waiting++;
+  simpleMutexUnlock(&q->mutex);
+
+  return TRUE;
+}
+
+
+void
+unwatch_message_queue(queue_watch *w)
+{ message_queue *q = w->queue;
+
+  simpleMutexLock(&q->mutex);
+  if ( w->prev )
+    w->prev->next = w->next;
+  else
+    q->watchers = w->next;
+  if ( w->next )
+    w->next->prev = w->prev;
+  q->waiting--;
+  release_message_queue(q);
+}
+
+
+/* message_queue_has_input() is true if the watched queue holds a message
+ * or is destroyed.  In the latter case reading raises an existence error.
+ */
+
+int
+message_queue_has_input(queue_watch *w)
+{ message_queue *q = w->queue;
+  int rc;
+
+  simpleMutexLock(&q->mutex);
+  rc = ( q->size > 0 || q->inbox || q->destroyed );
+  simpleMutexUnlock(&q->mutex);
+
+  return rc;
+}
+
+
+/* wait_thread_wakeup() waits until the wakeup  is signalled or the deadline
+ * expires.  Returns TRUE, MSG_WAIT_TIMEOUT or MSG_WAIT_INTR.
+ */
+
+static int
+wait_thread_wakeup(struct timespec *deadline ARG_LD)
+{ thread_wakeup *w = LD->thread.wakeup;
+  struct pollfd pfd;
+  int to = -1;
+  int rc;
+
+  if ( deadline )
+  { struct timespec now, left;
+    double ms;
+
+    get_current_timespec(&now);
+    timespec_diff(&left, deadline, &now);
+    if ( timespec_sign(&left) <= 0 )
+      return MSG_WAIT_TIMEOUT;
+    ms = (double)left.tv_sec*1000.0 + (double)left.tv_nsec/1000000.0;
+    to = ms < (double)INT_MAX ? (int)ceil(ms) : INT_MAX;
+  }
+
+  pfd.fd     = w->fd[0];
+  pfd.events = POLLIN;
+
+  PL_LOCK(L_ALERT);
+  LD->thread.alert.obj.wakeup = w;
+  LD->thread.alert.type	      = ALERT_WAKEUP_FD;
+  PL_UNLOCK(L_ALERT);
+
+  if ( is_signalled(LD) )
+  { rc = -1;
+  } else
+  { uint64_t t0 = wait_clock();
+
+    rc = poll(&pfd, 1, to);
+    LD->accounting.usage.queue_wait += wait_clock()-t0;
+  }
+
+  PL_LOCK(L_ALERT);
+  LD->thread.alert.type       = 0;
+  LD->thread.alert.obj.wakeup = NULL;
+  PL_UNLOCK(L_ALERT);
+
+  if ( is_signalled(LD) || (rc < 0 && errno == EINTR) )
+    return MSG_WAIT_INTR;
+
+  return TRUE;				/* woken, timeout is checked next */
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_get_message_any(+Queues, -Queue, ?Message, +Options)
+    Wait for a message that unifies with  Message on any of the queues in
+    Queues and unify Queue with the element of  Queues from which it was
+    read.  Queues are scanned in order.   Options are the timeout/1 and
+    deadline/1 options of thread_get_message/3.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define FAST_WATCH 16
+
+static
+PRED_IMPL("thread_get_message_any", 4, thread_get_message_any, 0)
+{ PRED_LD
+  struct timespec deadline;
+  struct timespec *dlop=NULL;
+  queue_watch watch_buf[FAST_WATCH];
+  queue_watch *watches = watch_buf;
+  term_t tail = PL_copy_term_ref(A1);
+  term_t qterms;
+  size_t count, watched = 0;
+  int isvar = PL_is_variable(A3) ? 1 : 0;
+  word key = (isvar ? 0L : getIndexOfTerm(A3));
+  fid_t fid;
+  int rc = FALSE;
+
+  switch ( PL_skip_list(A1, 0, &count) )
+  { case PL_LIST:
+      break;
+    case PL_PARTIAL_LIST:
+      return PL_instantiation_error(A1);
+    default:
+      return PL_type_error("list", A1);
+  }
+  if ( count == 0 )
+    return PL_domain_error("non_empty_list", A1);
+  if ( !process_deadline_options(A4, &deadline, &dlop) )
+    return FALSE;
+
+  if ( count > FAST_WATCH && !(watches = malloc(count*sizeof(*watches))) )
+    return PL_no_memory();
+  if ( !(qterms = PL_new_term_refs((int)count)) )
+    goto out;
+
+  for(; watched < count; watched++)
+  { term_t qt = qterms+watched;
+
+    if ( !PL_get_list(tail, qt, tail) ||
+	 !watch_message_queue(qt, &watches[watched] PASS_LD) )
+      goto out;
+  }
+
+  if ( !(fid = PL_open_foreign_frame()) )
+    goto out;
+  for(;;)
+  { size_t i;
+
+    drain_thread_wakeup(PASS_LD1);
+    for(i=0; i<count; i++)
+    { queue_watch *w = &watches[i];
+      message_queue *q = w->queue;
+
+      simpleMutexLock(&q->mutex);
+      if ( q->destroyed )
+	rc = PL_existence_error("message_queue", qterms+i);
+      else
+	rc = scan_message_queue(q, A3, key, isvar, &w->seen, fid PASS_LD);
+      simpleMutexUnlock(&q->mutex);
+
+      if ( rc != -1 )
+      { PL_close_foreign_frame(fid);
+	if ( rc )
+	  rc = PL_unify(A2, qterms+i);
+	goto out;
+      }
+    }
+
+    switch( wait_thread_wakeup(dlop PASS_LD) )
+    { case MSG_WAIT_TIMEOUT:
+	PL_discard_foreign_frame(fid);
+	rc = FALSE;
+	goto out;
+      case MSG_WAIT_INTR:
+	if ( PL_handle_signals() < 0 )
+	{ PL_close_foreign_frame(fid);
+	  rc = FALSE;
+	  goto out;
+	}
+    }
+  }
+
+out:
+  while( watched > 0 )
+    unwatch_message_queue(&watches[--watched]);
+  if ( watches != watch_buf )
+    free(watches);
+
+  return rc;
+}
+
+#endif /*O_QUEUE_WAKEUP*/
+
+
 static
 PRED_IMPL("thread_peek_message", 2, thread_peek_message_2, 0)
 { PRED_LD
@@ -5706,73 +6877,414 @@ recursiveMutexTryLock(recursiveMutex *m)
 }
 
 
-int
-recursiveMutexUnlock(recursiveMutex *m)
-{ int result = 0;
-  pthread_t self = pthread_self();
+int
+recursiveMutexUnlock(recursiveMutex *m)
+{ int result = 0;
+  pthread_t self = pthread_self();
+
+  if ( pthread_equal(self,m->owner) )
+  { if ( --m->count < 1 )
+    { m->owner = 0;
+      result = pthread_mutex_unlock(&(m->lock));
+    }
+  } else if ( !pthread_equal(m->owner, 0) )
+  { Sdprintf("unlocking unowned mutex %p,not done!!\n", m);
+    Sdprintf("\tlocking thread was %u , unlocking is %u\n",m->owner,self);
+
+    result = -1;
+  }
+
+  return result;
+}
+
+#endif /*RECURSIVE_MUTEXES*/
+
+void
+initSimpleMutex(counting_mutex *m, const char *name)
+{ simpleMutexInit(&m->mutex);
+  m->count = 0;
+  m->lock_count = 0;
+#ifdef O_CONTENTION_STATISTICS
+  m->collisions = 0;
+  memset(&m->waits, 0, sizeof(m->waits));
+#endif
+  m->name = name ? store_string(name) : (char*)NULL;
+  m->prev = NULL;
+
+  PL_LOCK(L_MUTEX);
+  m->next = GD->thread.mutexes;
+  GD->thread.mutexes = m;
+  if ( m->next )
+    m->next->prev = m;
+  PL_UNLOCK(L_MUTEX);
+}
+
+
+counting_mutex *
+allocSimpleMutex(const char *name)
+{ counting_mutex *m = allocHeapOrHalt(sizeof(*m));
+  initSimpleMutex(m, name);
+
+  return m;
+}
+
+
+void
+freeSimpleMutex(counting_mutex *m)
+{ PL_LOCK(L_MUTEX);
+  if ( m->next )
+    m->next->prev = m->prev;
+  if ( m->prev )
+    m->prev->next = m->next;
+  else
+    GD->thread.mutexes = m->next;
+  PL_UNLOCK(L_MUTEX);
+
+  simpleMutexDelete(&m->mutex);
+  remove_string((char *)m->name);
+  freeHeap(m, sizeof(*m));
+}
+
+
+#ifdef O_CONTENTION_STATISTICS
+		 /*******************************
+		 *	  WAIT STATISTICS	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Contended locks of counting mutexes, user  mutexes and stream locks are
+timed.  Uncontended locks only pay for the trylock that was already used
+to count collisions.  record_mutex_wait() adds the wait to a histogram of
+log2(usec) buckets.  If the wait exceeds  the Prolog flag
+mutex_wait_threshold, a sample holding  the   waiting  thread, the C
+caller of the lock and the running predicate  is added to a ring of the
+MUTEX_SAMPLES most recent slow waits.   The  statistics are reported by
+mutex_statistics/1.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define MUTEX_SAMPLES 64		/* Ring of recent slow waits */
+#define MUTEX_SAMPLE_NAME 48		/* Max length of mutex name */
+
+typedef struct mutex_sample
+{ void	       *mutex;			/* Mutex waited for */
+  char		name[MUTEX_SAMPLE_NAME]; /* Its name */
+  int		thread;			/* Waiting thread */
+  uint64_t	wait;			/* Time waited (nsec) */
+  void	       *caller;			/* C function that locked */
+  functor_t	functor;		/* Running predicate */
+  atom_t	module;			/* Module thereof */
+} mutex_sample;
+
+static void
+sample_mutex_wait(void *mutex, const char *name, uint64_t nsec, void *caller)
+{ GET_LD
+  mutex_sample *s;
+
+  simpleMutexLock(&GD->thread.mutex_samples.lock);
+  if ( !GD->thread.mutex_samples.ring &&
+       !(GD->thread.mutex_samples.ring =
+			calloc(MUTEX_SAMPLES, sizeof(mutex_sample))) )
+  { simpleMutexUnlock(&GD->thread.mutex_samples.lock);
+    return;
+  }
+  s = &GD->thread.mutex_samples.ring[GD->thread.mutex_samples.next++ %
+				     MUTEX_SAMPLES];
+  s->mutex = mutex;
+  strncpy(s->name, name ? name : "", sizeof(s->name)-1);
+  s->name[sizeof(s->name)-1] = EOS;
+  s->wait = nsec;
+  s->caller = caller;
+  s->thread = 0;
+  s->functor = 0;
+  s->module = NULL_ATOM;
+  if ( LD && LD->thread.info )
+  { s->thread = LD->thread.info->pl_tid;
+    if ( environment_frame && environment_frame->predicate )
+    { Definition def = environment_frame->predicate;
+
+      s->functor = def->functor->functor;
+      s->module  = def->module->name;
+    }
+  }
+  simpleMutexUnlock(&GD->thread.mutex_samples.lock);
+}
+
+
+void
+record_mutex_wait(mutex_waits *w, void *mutex, const char *name,
+		  uint64_t nsec, void *caller)
+{ GET_LD
+  uint64_t usec = nsec/1000;
+  int b = 0;
+
+  if ( LD )
+    LD->accounting.usage.mutex_wait += nsec;
+
+  while( usec > 1 && b < MUTEX_WAIT_BUCKETS-1 )
+  { usec >>= 1;
+    b++;
+  }
+
+  ATOMIC_ADD(&w->time, nsec);
+  ATOMIC_INC(&w->histogram[b]);
+  if ( nsec > w->max )			/* may lose a race; harmless */
+    w->max = nsec;
+
+  if ( GD->thread.mutex_samples.threshold &&
+       nsec >= GD->thread.mutex_samples.threshold )
+    sample_mutex_wait(mutex, name, nsec, caller);
+}
+
+
+#ifdef __GNUC__
+#define CALLER() __builtin_return_address(0)
+#else
+#define CALLER() NULL
+#endif
+
+void
+countingMutexWait(counting_mutex *cm)
+{ uint64_t t0 = wait_clock();
+
+  simpleMutexLock(&cm->mutex);
+  cm->collisions++;
+  record_mutex_wait(&cm->waits, cm, cm->name,
+		    wait_clock()-t0, CALLER());
+}
+
+
+/* Slock_wait() is called by the stream layer if a stream lock is held
+ * by another thread.  Stream locks are summarised as a single entry.
+ */
+
+void
+Slock_wait(recursiveMutex *m)
+{ uint64_t t0 = wait_clock();
+
+  recursiveMutexLock(m);
+  ATOMIC_INC(&GD->thread.stream_locks.collisions);
+  record_mutex_wait(&GD->thread.stream_locks.waits, &GD->thread.stream_locks,
+		    "<stream>", wait_clock()-t0, CALLER());
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+mutex_statistics(-List)
+    List holds a dict for each mutex that was locked or waited for.  The
+    statistics are copied while holding the locks and converted to terms
+    after releasing them.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct mutex_report
+{ void	       *mutex;			/* Mutex (for matching samples) */
+  char	       *name;			/* Name of internal mutexes */
+  atom_t	id;			/* Id of user mutexes */
+  atom_t	type;			/* internal, user or stream */
+  int64_t	locked;			/* # times locked (-1: unknown) */
+  unsigned int	collisions;		/* # contentions */
+  mutex_waits	waits;			/* Time spent waiting */
+} mutex_report;
+
+static int
+add_mutex_report(tmp_buffer *b, void *mutex, const char *name, atom_t id,
+		 atom_t type, int64_t locked, unsigned int collisions,
+		 mutex_waits *waits)
+{ mutex_report r;
+
+  r.mutex      = mutex;
+  r.name       = (name ? strdup(name) : NULL);
+  r.id	       = id;
+  r.type       = type;
+  r.locked     = locked;
+  r.collisions = collisions;
+  r.waits      = *waits;
+  if ( id )
+    PL_register_atom(id);
+  addBuffer(b, r, mutex_report);
+
+  return TRUE;
+}
+
+
+static int
+unify_mutex_caller(term_t t, void *caller)
+{ GET_LD
+#if defined(HAVE_DLADDR) && defined(HAVE_DLFCN_H)
+  Dl_info info;
+
+  if ( dladdr(caller, &info) && info.dli_sname )
+    return PL_unify_chars(t, PL_ATOM|REP_UTF8, (size_t)-1, info.dli_sname);
+#endif
+
+  return PL_unify_int64(t, (int64_t)(intptr_t)caller);
+}
+
+
+static int
+unify_mutex_sample(term_t t, mutex_sample *s)
+{ GET_LD
+  atom_t keys[4];
+  term_t values = PL_new_term_refs(5);
+  term_t dict = values+4;
+  int n = 0;
+
+  keys[n] = ATOM_thread;
+  if ( !PL_put_integer(values+n++, s->thread) )
+    return FALSE;
+  keys[n] = ATOM_time;
+  if ( !PL_put_float(values+n++, (double)s->wait/1e9) )
+    return FALSE;
+  if ( s->caller )
+  { keys[n] = ATOM_caller;
+    if ( !unify_mutex_caller(values+n++, s->caller) )
+      return FALSE;
+  }
+  if ( s->functor )
+  { keys[n] = ATOM_predicate;
+    if ( !PL_unify_term(values+n++,
+			PL_FUNCTOR, FUNCTOR_colon2,
+			  PL_ATOM, s->module,
+			  PL_FUNCTOR, FUNCTOR_divide2,
+			    PL_ATOM, nameFunctor(s->functor),
+			    PL_INT, (int)arityFunctor(s->functor)) )
+      return FALSE;
+  }
+
+  return ( PL_put_dict(dict, ATOM_wait, n, keys, values) &&
+	   PL_unify(t, dict) );
+}
+
+
+static int
+unify_mutex_report(term_t t, mutex_report *r,
+		   mutex_sample *samples, int nsamples)
+{ GET_LD
+  atom_t keys[8];
+  term_t values = PL_new_term_refs(9);
+  term_t dict = values+8;
+  term_t tail, head;
+  int n = 0, i;
+
+  keys[n] = ATOM_name;
+  if ( r->id )
+    PL_put_atom(values+n++, r->id);
+  else if ( !PL_unify_chars(values+n++, PL_ATOM|REP_UTF8, (size_t)-1,
+			    r->name ? r->name : "") )
+    return FALSE;
+  keys[n] = ATOM_type;
+  PL_put_atom(values+n++, r->type);
+  if ( r->locked >= 0 )
+  { keys[n] = ATOM_locked;
+    if ( !PL_put_int64(values+n++, r->locked) )
+      return FALSE;
+  }
+  keys[n] = ATOM_collisions;
+  if ( !PL_put_int64(values+n++, r->collisions) )
+    return FALSE;
+  keys[n] = ATOM_wait_time;
+  if ( !PL_put_float(values+n++, (double)r->waits.time/1e9) )
+    return FALSE;
+  keys[n] = ATOM_max_wait;
+  if ( !PL_put_float(values+n++, (double)r->waits.max/1e9) )
+    return FALSE;
+
+  keys[n] = ATOM_histogram;
+  tail = PL_copy_term_ref(values+n++);
+  head = PL_new_term_ref();
+  for(i=0; i<MUTEX_WAIT_BUCKETS; i++)
+  { if ( !PL_unify_list(tail, head, tail) ||
+	 !PL_unify_int64(head, r->waits.histogram[i]) )
+      return FALSE;
+  }
+  if ( !PL_unify_nil(tail) )
+    return FALSE;
 
-  if ( pthread_equal(self,m->owner) )
-  { if ( --m->count < 1 )
-    { m->owner = 0;
-      result = pthread_mutex_unlock(&(m->lock));
+  keys[n] = ATOM_slow_waits;
+  tail = PL_copy_term_ref(values+n++);
+  for(i=0; i<nsamples; i++)
+  { if ( samples[i].mutex == r->mutex )
+    { if ( !PL_unify_list(tail, head, tail) ||
+	   !unify_mutex_sample(head, &samples[i]) )
+	return FALSE;
     }
-  } else if ( !pthread_equal(m->owner, 0) )
-  { Sdprintf("unlocking unowned mutex %p,not done!!\n", m);
-    Sdprintf("\tlocking thread was %u , unlocking is %u\n",m->owner,self);
-
-    result = -1;
   }
+  if ( !PL_unify_nil(tail) )
+    return FALSE;
 
-  return result;
+  return ( PL_put_dict(dict, ATOM_mutex, n, keys, values) &&
+	   PL_unify(t, dict) );
 }
 
-#endif /*RECURSIVE_MUTEXES*/
 
-void
-initSimpleMutex(counting_mutex *m, const char *name)
-{ simpleMutexInit(&m->mutex);
-  m->count = 0;
-  m->lock_count = 0;
-#ifdef O_CONTENTION_STATISTICS
-  m->collisions = 0;
-#endif
-  m->name = name ? store_string(name) : (char*)NULL;
-  m->prev = NULL;
+static
+PRED_IMPL("mutex_statistics", 1, mutex_statistics, 0)
+{ PRED_LD
+  tmp_buffer b;
+  counting_mutex *cm;
+  mutex_sample samples[MUTEX_SAMPLES];
+  int nsamples = 0;
+  mutex_report *r, *e;
+  term_t tail = PL_copy_term_ref(A1);
+  term_t head = PL_new_term_ref();
+  int rc = TRUE;
+
+  initBuffer(&b);
 
   PL_LOCK(L_MUTEX);
-  m->next = GD->thread.mutexes;
-  GD->thread.mutexes = m;
-  if ( m->next )
-    m->next->prev = m;
+  for(cm = GD->thread.mutexes; cm; cm = cm->next)
+  { if ( cm->count == 0 )
+      continue;
+    add_mutex_report(&b, cm, cm->name, 0, ATOM_internal,
+		     cm->count, cm->collisions, &cm->waits);
+  }
   PL_UNLOCK(L_MUTEX);
-}
 
+  PL_LOCK(L_UMUTEX);
+  if ( GD->thread.mutexTable )
+  { TableEnum te = newTableEnum(GD->thread.mutexTable);
+    pl_mutex *m;
 
-counting_mutex *
-allocSimpleMutex(const char *name)
-{ counting_mutex *m = allocHeapOrHalt(sizeof(*m));
-  initSimpleMutex(m, name);
+    while( advanceTableEnum(te, NULL, (void**)&m) )
+    { if ( m->locked == 0 )
+	continue;
+      add_mutex_report(&b, m, NULL, m->id, ATOM_user,
+		       m->locked, m->collisions, &m->waits);
+    }
+    freeTableEnum(te);
+  }
+  PL_UNLOCK(L_UMUTEX);
 
-  return m;
-}
+  add_mutex_report(&b, &GD->thread.stream_locks, "<stream>", 0, ATOM_stream,
+		   -1, GD->thread.stream_locks.collisions,
+		   &GD->thread.stream_locks.waits);
 
+  simpleMutexLock(&GD->thread.mutex_samples.lock);
+  if ( GD->thread.mutex_samples.ring )
+  { unsigned int next = GD->thread.mutex_samples.next;
+    unsigned int i = (next > MUTEX_SAMPLES ? next-MUTEX_SAMPLES : 0);
 
-void
-freeSimpleMutex(counting_mutex *m)
-{ PL_LOCK(L_MUTEX);
-  if ( m->next )
-    m->next->prev = m->prev;
-  if ( m->prev )
-    m->prev->next = m->next;
-  else
-    GD->thread.mutexes = m->next;
-  PL_UNLOCK(L_MUTEX);
+    for(; i<next; i++)
+      samples[nsamples++] = GD->thread.mutex_samples.ring[i%MUTEX_SAMPLES];
+  }
+  simpleMutexUnlock(&GD->thread.mutex_samples.lock);
 
-  simpleMutexDelete(&m->mutex);
-  remove_string((char *)m->name);
-  freeHeap(m, sizeof(*m));
+  for(r=baseBuffer(&b, mutex_report), e=topBuffer(&b, mutex_report);
+      r<e; r++)
+  { if ( rc )
+      rc = ( PL_unify_list(tail, head, tail) &&
+	     unify_mutex_report(head, r, samples, nsamples) );
+    if ( r->name )
+      free(r->name);
+    if ( r->id )
+      PL_unregister_atom(r->id);
+  }
+  discardBuffer(&b);
+
+  return rc && PL_unify_nil(tail);
 }
 
+#endif /*O_CONTENTION_STATISTICS*/
+
 
 		 /*******************************
 		 *	FOREIGN INTERFACE	*
@@ -6267,6 +7779,316 @@ PRED_IMPL("thread_statistics", 3, thread_statistics, 0)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+thread_resource_usage(+Thread, -Usage)
+    Usage is a dict with the resources used by Thread (or engine) since it
+    was created or since the last call to thread_resource_usage_reset/1.
+    The counters are only updated by the thread itself.  We read them
+    without synchronization, so the values are not necessarily
+    consistent with each other.  The reset stores the current values as
+    base and thus never writes to the counters of another thread.
+
+    Backtracking does not maintain global_discarded unless accounting
+    is enabled by thread_resource_usage_reset/1 or resource limits,
+    keeping undo cheap for all other threads.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+get_resource_usage(PL_local_data_t *ld, resource_usage *u)
+{ *u = ld->accounting.usage;
+  u->cputime	      = ThreadCPUTime(ld, CPU_USER);
+  u->inferences	      = ld->statistics.inferences;
+  u->global_allocated = ( ld->gc.stats.totals.global_gained +
+			  ld->accounting.global_discarded +
+			  usedStackP(&ld->stacks.global) );
+}
+
+
+/* The counters are read unsynchronized and global_allocated may shrink
+ * (e.g., discarded stack space is only added later), so a value may be
+ * below its base.  Clamp at zero rather than wrapping around.
+ */
+
+static inline uint64_t
+usage_since(uint64_t now, uint64_t base)
+{ return now > base ? now - base : 0;
+}
+
+static void
+get_resource_usage_since_reset(PL_local_data_t *ld, resource_usage *u)
+{ resource_usage *b = &ld->accounting.base;
+
+  get_resource_usage(ld, u);
+  u->cputime	       -= b->cputime;
+  u->inferences	       -= b->inferences;
+  u->global_allocated  = usage_since(u->global_allocated,  b->global_allocated);
+  u->heap_allocated    = usage_since(u->heap_allocated,    b->heap_allocated);
+  u->records	       = usage_since(u->records,	   b->records);
+  u->record_bytes      = usage_since(u->record_bytes,      b->record_bytes);
+  u->messages_sent     = usage_since(u->messages_sent,     b->messages_sent);
+  u->messages_received = usage_since(u->messages_received, b->messages_received);
+  u->queue_wait	       = usage_since(u->queue_wait,	   b->queue_wait);
+  u->mutex_wait	       = usage_since(u->mutex_wait,	   b->mutex_wait);
+  if ( u->cputime < 0.0 )
+    u->cputime = 0.0;
+  if ( u->inferences < 0 )
+    u->inferences = 0;
+}
+
+
+static PL_local_data_t *
+get_accounted_thread(term_t t ARG_LD)
+{ PL_thread_info_t *info;
+  PL_local_data_t *ld;
+
+  if ( !get_thread(t, &info, TRUE) )
+    return NULL;
+  if ( !(ld=info->thread_data) )
+  { PL_error(NULL, 0, NULL, ERR_PERMISSION,
+	     ATOM_statistics, ATOM_thread, t);
+    return NULL;
+  }
+
+  return ld;
+}
+
+
+static
+PRED_IMPL("thread_resource_usage", 2, thread_resource_usage, 0)
+{ PRED_LD
+  PL_local_data_t *ld;
+  resource_usage u;
+  atom_t keys[10];
+  term_t values = PL_new_term_refs(11);
+  term_t dict = values+10;
+
+  PL_LOCK(L_THREAD);
+  if ( !(ld=get_accounted_thread(A1 PASS_LD)) )
+  { PL_UNLOCK(L_THREAD);
+    return FALSE;
+  }
+  get_resource_usage_since_reset(ld, &u);
+  PL_UNLOCK(L_THREAD);
+
+  keys[0] = ATOM_cputime;
+  keys[1] = ATOM_inferences;
+  keys[2] = ATOM_global_allocated;
+  keys[3] = ATOM_heap_allocated;
+  keys[4] = ATOM_records;
+  keys[5] = ATOM_record_bytes;
+  keys[6] = ATOM_messages_sent;
+  keys[7] = ATOM_messages_received;
+  keys[8] = ATOM_queue_wait;
+  keys[9] = ATOM_mutex_wait;
+
+  return ( PL_put_float(values+0, u.cputime) &&
+	   PL_put_int64(values+1, u.inferences) &&
+	   PL_put_uint64(values+2, u.global_allocated) &&
+	   PL_put_uint64(values+3, u.heap_allocated) &&
+	   PL_put_uint64(values+4, u.records) &&
+	   PL_put_uint64(values+5, u.record_bytes) &&
+	   PL_put_uint64(values+6, u.messages_sent) &&
+	   PL_put_uint64(values+7, u.messages_received) &&
+	   PL_put_float(values+8, (double)u.queue_wait/1e9) &&
+	   PL_put_float(values+9, (double)u.mutex_wait/1e9) &&
+	   PL_put_dict(dict, ATOM_resource_usage, 10, keys, values) &&
+	   PL_unify(A2, dict) );
+}
+
+
+static
+PRED_IMPL("thread_resource_usage_reset", 1, thread_resource_usage_reset, 0)
+{ PRED_LD
+  PL_local_data_t *ld;
+
+  PL_LOCK(L_THREAD);
+  if ( !(ld=get_accounted_thread(A1 PASS_LD)) )
+  { PL_UNLOCK(L_THREAD);
+    return FALSE;
+  }
+  get_resource_usage(ld, &ld->accounting.base);
+  ld->accounting.discards = TRUE;
+  PL_UNLOCK(L_THREAD);
+
+  return TRUE;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Resource governor.  A thread or engine  may  have  limits on the heap it
+allocates, its CPU time and its  inferences.  The limits apply to the
+values reported by thread_resource_usage/2 and are set using the options
+max_heap(Bytes), max_cpu(Seconds) and  max_inferences(Count)  of
+thread_create/3 and engine_create/4 or thread_set_resource_limits/2.
+Note that max_heap limits the cumulative amount of memory allocated
+since the thread was created or its usage was reset, not the memory it
+currently holds: we cannot attribute frees to the allocating thread.
+
+If there are limits, ALERT_RESOURCES is set  and  the call port checks
+whether LD->accounting.check_at inferences have been  reached.  If this
+is the only alert, the call port  only   does  this comparison and
+otherwise takes the fast path, so  limits   cost  little.  We then
+call checkResourceLimits(),  which  raises  resource_error(Limit)  if a
+limit is exceeded and schedules the next check.  After raising an error
+we wait RESOURCE_GRACE inferences before checking  again, so recovery
+code gets a chance to run.  Other threads change the limits and send
+SIG_RESOURCES, such that the thread checks at its next safe point.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define RESOURCE_CHECK_INTERVAL 10000
+#define RESOURCE_GRACE		100000
+
+static const opt_spec resource_limit_options[] =
+{ { ATOM_max_heap,	 OPT_SIZE },
+  { ATOM_max_cpu,	 OPT_DOUBLE },
+  { ATOM_max_inferences, OPT_SIZE },
+  { NULL_ATOM,		 0 }
+};
+
+static int
+get_resource_limits(term_t options, atom_t opttype, resource_limits *l)
+{ size_t heap = (size_t)l->heap;
+  size_t inferences = (size_t)l->inferences;
+  double cpu = l->cpu;
+
+  if ( !scan_options(options, 0, opttype, resource_limit_options,
+		     &heap, &cpu, &inferences) )
+    return FALSE;
+  if ( cpu < 0.0 )
+  { GET_LD
+    term_t ex = PL_new_term_ref();
+
+    return ( PL_put_float(ex, cpu) &&
+	     PL_error(NULL, 0, NULL, ERR_DOMAIN,
+		      ATOM_not_less_than_zero, ex) );
+  }
+
+  l->heap       = heap;
+  l->cpu        = cpu;
+  l->inferences = (int64_t)inferences;
+
+  return TRUE;
+}
+
+
+static int
+has_resource_limits(const resource_limits *l)
+{ return l->heap || l->cpu > 0.0 || l->inferences;
+}
+
+
+static void
+set_resource_limits(PL_local_data_t *ld, const resource_limits *l)
+{ ld->accounting.limits = *l;
+  if ( has_resource_limits(l) )
+  { ld->accounting.check_at = ld->statistics.inferences+1;
+    ld->accounting.discards = TRUE;
+  } else
+    ld->accounting.check_at = 0;
+}
+
+
+void
+checkResourceLimits(ARG1_LD)
+{ resource_limits *l = &LD->accounting.limits;
+  resource_usage u;
+  atom_t exceeded = NULL_ATOM;
+  int64_t next;
+
+  if ( !has_resource_limits(l) )
+  { LD->accounting.check_at = 0;
+    updateAlerted(LD);
+    return;
+  }
+  if ( LD->exception.processing ||
+       (environment_frame &&
+	environment_frame->predicate == PROCEDURE_catch3->definition) )
+  { LD->accounting.check_at = LD->statistics.inferences+1;
+    updateAlerted(LD);			/* try again at the next call */
+    return;
+  }
+
+  get_resource_usage_since_reset(LD, &u);
+  if ( l->inferences && u.inferences >= l->inferences )
+    exceeded = ATOM_max_inferences;
+  else if ( l->heap && u.heap_allocated >= l->heap )
+    exceeded = ATOM_max_heap;
+  else if ( l->cpu > 0.0 && u.cputime >= l->cpu )
+    exceeded = ATOM_max_cpu;
+
+  if ( exceeded )
+  { next = LD->statistics.inferences + RESOURCE_GRACE;
+  } else
+  { next = LD->statistics.inferences + RESOURCE_CHECK_INTERVAL;
+    if ( l->inferences )
+    { int64_t at = LD->accounting.base.inferences + l->inferences;
+
+      if ( at < next )
+	next = at;
+    }
+  }
+  LD->accounting.check_at = next;
+  updateAlerted(LD);
+
+  if ( exceeded )
+  { fid_t fid;
+
+    if ( (fid = PL_open_foreign_frame()) )
+    { PL_error(NULL, 0, NULL, ERR_RESOURCE, exceeded);
+      PL_close_foreign_frame(fid);
+    }
+  }
+}
+
+
+void
+resourceLimitsChanged(int sig)
+{ GET_LD
+  (void)sig;
+
+  checkResourceLimits(PASS_LD1);
+}
+
+
+/** thread_set_resource_limits(+Id, +Options)
+ *
+ * Change the resource limits of a thread  or engine.  Limits that are
+ * not in Options are left unchanged.  A limit of 0 removes the limit.
+ */
+
+static
+PRED_IMPL("thread_set_resource_limits", 2, thread_set_resource_limits, 0)
+{ PRED_LD
+  PL_local_data_t *ld;
+  resource_limits l;
+  int rc = TRUE;
+
+  PL_LOCK(L_THREAD);
+  if ( !(ld=get_accounted_thread(A1 PASS_LD)) )
+  { PL_UNLOCK(L_THREAD);
+    return FALSE;
+  }
+  l = ld->accounting.limits;
+  PL_UNLOCK(L_THREAD);
+
+  if ( !get_resource_limits(A2, ATOM_thread_option, &l) )
+    return FALSE;
+
+  PL_LOCK(L_THREAD);
+  if ( (ld=get_accounted_thread(A1 PASS_LD)) )
+  { ld->accounting.limits = l;
+    raiseSignal(ld, SIG_RESOURCES);
+  } else
+    rc = FALSE;
+  PL_UNLOCK(L_THREAD);
+
+  if ( rc && ld == LD )
+    rc = PL_handle_signals() >= 0;
+
+  return rc;
+}
+
+
 #ifdef __WINDOWS__
 
 /* How to make the memory visible?
@@ -6681,6 +8503,7 @@ forThreadLocalDataUnsuspended(void (*func)(PL_local_data_t *, void* ctx),
 	{ simpleMutexLock(&ld->thread.scan_lock);
 	  (*func)(ld, ctx);
 	  simpleMutexUnlock(&ld->thread.scan_lock);
+	  release_ldata(ld);
 	}
       }
     }
@@ -6734,6 +8557,9 @@ markAtomsMessageQueue(message_queue *queue)
   for(msg=queue->head; msg; msg=msg->next)
   { markAtomsRecord(msg->message);
   }
+  for(msg=queue->inbox; msg; msg=msg->next)
+  { markAtomsRecord(msg->message);
+  }
 }
 
 
@@ -6811,6 +8637,63 @@ unregisterLocalDefinition(Definition def, PL_local_data_t *ld)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Slots  in  LD->thread.local_slots  are  allocated    from   a  free  list
+(GD->thread.local_slots.free) that is filled by destroyLocalDefinitions().
+Without it, programs that repeatedly create  and destroy modules holding
+thread-local predicates would make the  slot arrays grow without bounds.
+Each allocation gets a new generation,   which invalidates the entries
+that other threads may still hold for the previous owner of the slot.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct free_local_slot
+{ unsigned int slot;
+  struct free_local_slot *next;
+} free_local_slot;
+
+static void
+alloc_local_slot(LocalDefinitions f)
+{ free_local_slot *fs;
+
+  PL_LOCK(L_THREAD);
+  if ( (fs=GD->thread.local_slots.free) )
+  { GD->thread.local_slots.free = fs->next;
+    f->slot = fs->slot;
+  } else
+  { f->slot = GD->thread.local_slots.count++;
+  }
+  f->generation = ++GD->thread.local_slots.generation;
+  PL_UNLOCK(L_THREAD);
+
+  if ( fs )
+    freeHeap(fs, sizeof(*fs));
+}
+
+
+static void
+release_local_slot(unsigned int slot)
+{ free_local_slot *fs = allocHeapOrHalt(sizeof(*fs));
+
+  fs->slot = slot;
+  PL_LOCK(L_THREAD);
+  fs->next = GD->thread.local_slots.free;
+  GD->thread.local_slots.free = fs;
+  PL_UNLOCK(L_THREAD);
+}
+
+
+static void
+free_local_slots(void)
+{ free_local_slot *fs, *next;
+
+  for(fs=GD->thread.local_slots.free; fs; fs=next)
+  { next = fs->next;
+    freeHeap(fs, sizeof(*fs));
+  }
+  GD->thread.local_slots.free = NULL;
+}
+
+
 LocalDefinitions
 new_ldef_vector(void)
 { LocalDefinitions f = allocHeapOrHalt(sizeof(*f));
@@ -6819,6 +8702,7 @@ new_ldef_vector(void)
   f->blocks[0] = f->preallocated - 1;
   f->blocks[1] = f->preallocated - 1;
   f->blocks[2] = f->preallocated - 1;
+  alloc_local_slot(f);
 
   return f;
 }
@@ -6834,6 +8718,11 @@ thread cleanup will access the destroyed predicate.
 Now, the thread having a localization for  this predicate is most likely
 the calling thread, but in theory other threads can be involved and thus
 we need to scan the entire localization array.
+
+Only the owning thread may  write  its   LD->thread.local_slots,  so  we
+clear the slot for the calling thread only.  The slot is returned to the
+free list.  Stale entries of  other  threads   are  ignored  as  their
+generation does not match the next predicate that uses the slot.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
 void
@@ -6867,6 +8756,8 @@ destroyLocalDefinitions(Definition def)
 			   predicateName(def)));
 
 	  unregisterLocalDefinition(def, ld);
+	  if ( ld == LD && ld->thread.local_slots.size > ldefs->slot )
+	    ld->thread.local_slots.entries[ldefs->slot].definition = NULL;
 	  destroyLocalDefinition(def, tid);
 
 	  if ( LD )
@@ -6875,6 +8766,8 @@ destroyLocalDefinitions(Definition def)
       }
     }
   }
+
+  release_local_slot(ldefs->slot);
 }
 
 
@@ -6937,6 +8830,14 @@ cleanupLocalDefinitions(PL_local_data_t *ld)
     }
     freeHeap(ch, sizeof(*ch));
   }
+  ld->thread.local_definitions = NULL;
+
+  if ( ld->thread.local_slots.entries )
+  { freeHeap(ld->thread.local_slots.entries,
+	     ld->thread.local_slots.size*sizeof(local_slot));
+    ld->thread.local_slots.entries = NULL;
+    ld->thread.local_slots.size = 0;
+  }
 }
 
 
@@ -6949,6 +8850,8 @@ sizeof_local_definitions(PL_local_data_t *ld)
   { Definition def = ch->definition;
     Definition local;
 
+    if ( !def )				/* see unregisterLocalDefinition() */
+      continue;
     assert(true(def, P_THREAD_LOCAL));
     if ( (local = getProcDefinitionForThread(def, ld->thread.info->pl_tid)) )
       size += sizeof_predicate(local);
@@ -7005,6 +8908,20 @@ PRED_IMPL("$thread_local_clause_count", 3, thread_local_clause_count, 0)
 }
 
 
+/** '$thread_local_slots'(-Count) is det.
+
+True when Count is the number  of   slots  allocated  for thread-local
+predicates.  Used for testing that slots are reused.
+*/
+
+static
+PRED_IMPL("$thread_local_slots", 1, thread_local_slots, 0)
+{ PRED_LD
+
+  return PL_unify_integer(A1, GD->thread.local_slots.count);
+}
+
+
 #else /*O_PLMT*/
 
 int
@@ -7251,6 +9168,9 @@ static int
 ldata_in_use(PL_local_data_t *ld)
 { int i;
 
+  if ( GD->thread.ldata_accessing == 0 )
+    return FALSE;
+
   for(i=1; i<=GD->thread.highest_id; i++)
   { PL_thread_info_t *info = GD->thread.threads[i];
     if ( info && info->access.ldata == ld )
@@ -7563,6 +9483,9 @@ BeginPredDefs(thread)
   PRED_DEF("thread_detach",	     1,	thread_detach,	       PL_FA_ISO)
   PRED_DEF("thread_join",	     2,	thread_join,	       0)
   PRED_DEF("thread_statistics",	     3,	thread_statistics,     0)
+  PRED_DEF("thread_resource_usage",  2,	thread_resource_usage, 0)
+  PRED_DEF("thread_resource_usage_reset", 1, thread_resource_usage_reset, 0)
+  PRED_DEF("thread_set_resource_limits", 2, thread_set_resource_limits, 0)
   PRED_DEF("thread_property",	     2,	thread_property,       NDET|PL_FA_ISO)
   PRED_DEF("is_thread",		     1,	is_thread,	       0)
   PRED_DEF("$thread_sigwait",	     1, thread_sigwait,	       0)
@@ -7577,9 +9500,14 @@ BeginPredDefs(thread)
 
   PRED_DEF("thread_send_message",    2,	thread_send_message,   PL_FA_ISO)
   PRED_DEF("thread_send_message",    3,	thread_send_message,   0)
+  PRED_DEF("thread_send_messages",   2,	thread_send_messages,  0)
   PRED_DEF("thread_get_message",     1,	thread_get_message,    PL_FA_ISO)
   PRED_DEF("thread_get_message",     2,	thread_get_message,    PL_FA_ISO)
   PRED_DEF("thread_get_message",     3,	thread_get_message,    PL_FA_ISO)
+  PRED_DEF("thread_get_messages",    3,	thread_get_messages,   0)
+#ifdef O_QUEUE_WAKEUP
+  PRED_DEF("thread_get_message_any", 4,	thread_get_message_any, 0)
+#endif
   PRED_DEF("thread_peek_message",    1,	thread_peek_message_1, PL_FA_ISO)
   PRED_DEF("thread_peek_message",    2,	thread_peek_message_2, PL_FA_ISO)
   PRED_DEF("message_queue_destroy",  1,	message_queue_destroy, PL_FA_ISO)
@@ -7597,8 +9525,12 @@ BeginPredDefs(thread)
   PRED_DEF("is_engine",		     1,	is_engine,	       0)
 
   PRED_DEF("mutex_statistics",	     0,	mutex_statistics,      0)
+#ifdef O_CONTENTION_STATISTICS
+  PRED_DEF("mutex_statistics",	     1,	mutex_statistics,      0)
+#endif
 
   PRED_DEF("$thread_local_clause_count", 3, thread_local_clause_count, 0)
+  PRED_DEF("$thread_local_slots", 1, thread_local_slots, 0)
   PRED_DEF("$gc_wait",               1, gc_wait,               0)
   PRED_DEF("$gc_clear",              1, gc_clear,              0)
   PRED_DEF("$gc_stop",               0, gc_stop,               0)
@@ -95,6 +95,8 @@ typedef struct _PL_thread_info_t
   unsigned	    in_exit_hooks : 1;	/* TRUE: running exit hooks */
   unsigned	    has_tid       : 1;	/* TRUE: tid = valid */
   unsigned	    is_engine	  : 1;	/* TRUE: created as engine */
+  unsigned	    numa_local	  : 1;	/* TRUE: localise memory on start */
+  int		    numa_node;		/* NUMA node to run on (-1: any) */
   thread_status	    status;		/* PL_THREAD_* */
   pthread_t	    tid;		/* Thread identifier */
 #ifdef PID_IDENTIFIES_THREAD
@@ -157,10 +159,17 @@ typedef struct message_queue
 #endif
   struct thread_message   *head;	/* Head of message queue */
   struct thread_message   *tail;	/* Tail of message queue */
+  struct thread_message   *inbox;	/* Lock-free added messages (LIFO) */
+  size_t	       inbox_size;	/* # terms in inbox */
+  int		       senders;		/* # senders not holding mutex */
   uint64_t	       sequence_next;	/* next for sequence id */
   word		       id;		/* Id of the queue */
   size_t	       size;		/* # terms in queue */
   size_t	       max_size;	/* Max # terms in queue */
+  struct queue_watch  *watchers;	/* Threads watching the queue */
+  struct prio_segment *segments;	/* Priority queue: last per priority */
+  size_t	       segment_count;	/* # used segments */
+  size_t	       segment_allocated; /* # allocated segments */
   int		       waiting;		/* # waiting threads */
   int		       waiting_var;	/* # waiting with unbound */
   int		       wait_for_drain;	/* # threads waiting for write */
@@ -168,6 +177,7 @@ typedef struct message_queue
   unsigned	initialized : 1;	/* Queue is initialised */
   unsigned	destroyed : 1;		/* Thread is being destroyed */
   unsigned	type : 2;		/* QTYPE_* */
+  unsigned	priority : 1;		/* Priority queue */
 #ifdef O_ATOMGC
   simpleMutex          gc_mutex;	/* Atom GC scanning sychronization */
 #endif
@@ -178,23 +188,50 @@ typedef struct pl_mutex
   int count;				/* lock count */
   int owner;				/* integer id of owner */
   atom_t id;				/* id of the mutex */
+#ifdef O_CONTENTION_STATISTICS
+  uint64_t locked;			/* # times locked */
+  unsigned int collisions;		/* # contentions */
+  mutex_waits waits;			/* Time spent waiting */
+#endif
   unsigned anonymous    : 1;		/* <mutex>(0x...) */
   unsigned initialized  : 1;		/* Mutex is initialized */
   unsigned destroyed    : 1;		/* Mutex is destroyed */
   unsigned auto_destroy	: 1;		/* asked to destroy */
 } pl_mutex;
 
+#if defined(HAVE_POLL) && !defined(__WINDOWS__)
+#define O_QUEUE_WAKEUP 1
+
+typedef struct thread_wakeup		/* Wakeup for multiplexed waiting */
+{ int		fd[2];			/* eventfd (fd[0]==fd[1]) or pipe */
+  int		signalled;		/* fd holds a wakeup */
+} thread_wakeup;
+
+typedef struct queue_watch		/* Thread watching a message queue */
+{ struct queue_watch *next;		/* Next watcher of the queue */
+  struct queue_watch *prev;		/* Previous watcher of the queue */
+  message_queue	*queue;			/* Queue watched */
+  thread_wakeup *wakeup;		/* Wakeup of the watching thread */
+  uint64_t	seen;			/* Last sequence id examined */
+} queue_watch;
+#endif
+
 #define ALERT_QUEUE_RD	1
 #define ALERT_QUEUE_WR	2
+#define ALERT_WAKEUP_FD	3
 
 typedef struct alert_channel
 { int	type;				/* Type of channel */
   union
   { message_queue *queue;
+#ifdef O_QUEUE_WAKEUP
+    thread_wakeup *wakeup;
+#endif
   } obj;
 } alert_channel;
 
 #define PL_THREAD_MAGIC 0x2737234f
+#define ENGINE_POOL_SIZE 16		/* default for flag engine_pool_size */
 
 extern counting_mutex _PL_mutexes[];	/* Prolog mutexes */
 
@@ -249,9 +286,7 @@ countingMutexLock(counting_mutex *cm)
 {
 #if O_CONTENTION_STATISTICS
   if ( !simpleMutexTryLock(&cm->mutex) )
-  { cm->collisions++;
-    simpleMutexLock(&cm->mutex);
-  }
+    countingMutexWait(cm);
 #else
   simpleMutexLock(&cm->mutex);
 #endif
@@ -260,6 +295,17 @@ countingMutexLock(counting_mutex *cm)
   cm->lock_count++;
 }
 
+static inline int
+countingMutexTryLock(counting_mutex *cm)
+{ if ( simpleMutexTryLock(&cm->mutex) )
+  { cm->count++;
+    cm->lock_count++;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
 static inline void
 countingMutexUnlock(counting_mutex *cm)
 { assert(cm->lock_count > 0);
@@ -450,6 +496,21 @@ COMMON(void)		get_current_timespec(struct timespec *time);
 COMMON(void)	        carry_timespec_nanos(struct timespec *time);
 COMMON(int)		signal_waiting_threads(Module m, thread_wait_channel *wch);
 COMMON(void)		free_wait_area(thread_wait_area *wa);
+COMMON(uint64_t)	wait_clock(void);
+COMMON(void)		checkResourceLimits(ARG1_LD);
+COMMON(void)		resourceLimitsChanged(int sig);
+#ifdef O_CONTENTION_STATISTICS
+COMMON(void)		record_mutex_wait(mutex_waits *w, void *mutex,
+					  const char *name, uint64_t nsec,
+					  void *caller);
+#endif
+#ifdef O_QUEUE_WAKEUP
+COMMON(int)		thread_wakeup_fd(ARG1_LD);
+COMMON(void)		drain_thread_wakeup(ARG1_LD);
+COMMON(int)		watch_message_queue(term_t qterm, queue_watch *w ARG_LD);
+COMMON(void)		unwatch_message_queue(queue_watch *w);
+COMMON(int)		message_queue_has_input(queue_watch *w);
+#endif
 
 
 		 /*******************************
@@ -464,7 +525,7 @@ COMMON(void)	markAtomsMessageQueues(void);
 COMMON(void)	markAtomsThreadMessageQueue(PL_local_data_t *ld);
 
 #define acquire_ldata(info)	acquire_ldata__LD(info PASS_LD)
-#define release_ldata(ld)	(LD->thread.info->access.ldata = NULL)
+#define release_ldata(ld)	release_ldata__LD(PASS_LD1)
 
 		 /*******************************
 		 *     CONDITION VARIABLES	*
@@ -56,7 +56,6 @@ the sequence of another term.
 
 TODO
   - Limit size of the tries
-  - Avoid using a hash-table for small number of branches
   - Thread safe reclaiming
     - Reclaim single-child node after moving to a hash
     - Make pruning the trie thread-safe
@@ -67,6 +66,7 @@ TODO
 #define RESERVED_TRIE_VAL(n) (((word)((uintptr_t)n)<<LMASK_BITS) | \
 			      TAG_VAR|STG_LOCAL)
 #define TRIE_ERROR_VAL       RESERVED_TRIE_VAL(1)
+#define TRIE_KEY_DELETED     RESERVED_TRIE_VAL(2)
 #define TRIE_KEY_POP(n)      RESERVED_TRIE_VAL(10+(n))
 
 #define IS_TRIE_KEY_POP(w)   ((tagex(w) == (TAG_VAR|STG_LOCAL) && \
@@ -169,6 +169,7 @@ static PL_blob_t trie_blob =
 static trie_node       *new_trie_node(trie *trie, word key);
 static void		destroy_node(trie *trie, trie_node *n);
 static void		clear_node(trie *trie, trie_node *n, int dealloc);
+static void		free_replaced_children(trie *trie, trie_replaced *r);
 static inline void	release_value(word value);
 
 
@@ -185,6 +186,42 @@ release_key(word key)
 }
 
 
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Nodes of answer tries are accounted to Module->memory.tables of the
+module of the tabled predicate.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static inline Module
+trie_module(trie *trie)
+{ Definition def = trie->data.predicate;
+
+  return def ? def->module : NULL;
+}
+
+static void *
+alloc_trie_mem(trie *trie, size_t bytes)
+{ void *mem;
+
+  if ( (mem = alloc_from_pool(trie->alloc_pool, bytes)) )
+  { Module m;
+
+    if ( (m=trie_module(trie)) )
+      ATOMIC_ADD(&m->memory.tables, bytes);
+  }
+
+  return mem;
+}
+
+static void
+free_trie_mem(trie *trie, void *mem, size_t bytes)
+{ Module m;
+
+  if ( (m=trie_module(trie)) )
+    ATOMIC_SUB(&m->memory.tables, bytes);
+  free_to_pool(trie->alloc_pool, mem, bytes);
+}
+
+
 trie *
 trie_create(alloc_pool *pool)
 { trie *trie;
@@ -237,6 +274,8 @@ trie_empty(trie *trie)
   { indirect_table *it = trie->indirects;
 
     clear_node(trie, &trie->root, FALSE);	/* TBD: verify not accessed */
+    free_replaced_children(trie, trie->replaced);
+    trie->replaced = NULL;
     if ( it && COMPARE_AND_SWAP_PTR(&trie->indirects, it, NULL) )
       destroy_indirect_table(it);
     trie->node_count = 1;
@@ -252,6 +291,176 @@ trie_clean(trie *trie)
 }
 
 
+		 /*******************************
+		 *	   ARRAY CHILDREN	*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Nodes with a few children use a TN_ARRAY  node rather than a hash table.
+This is a small array of key/child  pairs that is filled from the start.
+Adding a child claims the first free slot  by setting its key using CAS,
+after which the child is  filled  in.  A   reader  that  finds  the key
+without a child waits for the child.   Deleted children leave their slot
+with the key TRIE_KEY_DELETED.   A  full   array  is  replaced  by  a
+larger array or, if it holds more than TRIE_ARRAY_MAX children, a hash
+table.  See grow_children().
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#define TRIE_ARRAY_MIN	 4		/* Initial size of a TN_ARRAY node */
+#define TRIE_ARRAY_MAX	16		/* Use TN_HASHED beyond this */
+
+#define sizeof_children_array(n) \
+	(offsetof(trie_children_array, slots) + (n)*sizeof(trie_children_slot))
+
+static trie_children_array *
+new_children_array(trie *trie, unsigned size)
+{ trie_children_array *a;
+
+  if ( (a=alloc_trie_mem(trie, sizeof_children_array(size))) )
+  { memset(a, 0, sizeof_children_array(size));
+    a->type = TN_ARRAY;
+    a->size = size;
+  }
+
+  return a;
+}
+
+static trie_node *
+wait_slot_child(trie_children_slot *s)
+{ trie_node *child;
+
+  while( !(child=s->child) )
+  {
+#ifdef O_PLMT
+#ifdef __WINDOWS__
+    Sleep(0);
+#else
+    sched_yield();
+#endif
+#endif
+  }
+  MEMORY_ACQUIRE();
+
+  return child;
+}
+
+static trie_node *
+array_child(const trie_children_array *a, word key)
+{ unsigned i;
+
+  for(i=0; i<a->size; i++)
+  { word k = a->slots[i].key;
+
+    if ( k == key )
+    { trie_node *child = a->slots[i].child;	/* NULL: being added */
+
+      MEMORY_ACQUIRE();
+      return child;
+    }
+    if ( !k )
+      break;
+  }
+
+  return NULL;
+}
+
+/* Enumerate the children of an array node, starting at *index */
+
+static trie_node *
+next_array_child(const trie_children_array *a, unsigned *index, word *key)
+{ unsigned i;
+
+  for(i=*index; i<a->size; i++)
+  { word k = a->slots[i].key;
+    trie_node *child;
+
+    if ( !k )
+      break;
+    if ( k != TRIE_KEY_DELETED && (child=a->slots[i].child) )
+    { MEMORY_ACQUIRE();
+      *index = i+1;
+      if ( key )
+	*key = k;
+      return child;
+    }
+  }
+
+  *index = i;
+  return NULL;
+}
+
+static int
+array_is_empty(const trie_children_array *a)
+{ unsigned i;
+
+  for(i=0; i<a->size && a->slots[i].key; i++)
+  { if ( a->slots[i].key != TRIE_KEY_DELETED )
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+delete_array_child(trie_children_array *a, const trie_node *child)
+{ unsigned i;
+
+  for(i=0; i<a->size && a->slots[i].key; i++)
+  { if ( a->slots[i].child == child &&
+	 a->slots[i].key != TRIE_KEY_DELETED )
+    { a->slots[i].key = TRIE_KEY_DELETED;
+      return;
+    }
+  }
+}
+
+/* Size and release of children nodes replaced by insert_child()
+ */
+
+static size_t
+sizeof_children_node(const try_children_any *any)
+{ switch( any->type )
+  { case TN_KEY:
+      return sizeof(trie_children_key);
+    case TN_ARRAY:
+      return sizeof_children_array(((const trie_children_array*)any)->size);
+    default:
+      assert(0);
+      return 0;
+  }
+}
+
+
+static void
+free_children_node(trie *trie, try_children_any *any)
+{ free_trie_mem(trie, any, sizeof_children_node(any));
+}
+
+
+static size_t
+sizeof_replaced_children(const trie *trie)
+{ size_t bytes = 0;
+  const trie_replaced *r;
+
+  for(r=trie->replaced; r; r=r->next)
+    bytes += sizeof(*r) + sizeof_children_node(r->children);
+
+  return bytes;
+}
+
+
+static void
+free_replaced_children(trie *trie, trie_replaced *r)
+{ while( r )
+  { trie_replaced *next = r->next;
+
+    free_children_node(trie, r->children);
+    freeHeap(r, sizeof(*r));
+    r = next;
+  }
+}
+
+
 static trie_node *
 get_child(trie_node *n, word key ARG_LD)
 { trie_children children = n->children;
@@ -262,6 +471,8 @@ get_child(trie_node *n, word key ARG_LD)
 	if ( children.key->key == key )
 	  return children.key->child;
         return NULL;
+      case TN_ARRAY:
+	return array_child(children.array, key);
       case TN_HASHED:
 	return lookupHTable(children.hash->table, (void*)key);
       default:
@@ -281,6 +492,8 @@ is_leaf_trie_node(trie_node *n)
   { switch( children.any->type )
     { case TN_KEY:
 	return FALSE;
+      case TN_ARRAY:
+	return array_is_empty(children.array);
       case TN_HASHED:
 	return children.hash->table->size == 0;
       default:
@@ -296,7 +509,7 @@ static trie_node *
 new_trie_node(trie *trie, word key)
 { trie_node *n;
 
-  if ( (n = alloc_from_pool(trie->alloc_pool, sizeof(*n))) )
+  if ( (n = alloc_trie_mem(trie, sizeof(*n))) )
   { ATOMIC_INC(&trie->node_count);
     memset(n, 0, sizeof(*n));
     acquire_key(key);
@@ -323,7 +536,7 @@ next:
 
   if ( dealloc )
   { ATOMIC_DEC(&trie->node_count);
-    free_to_pool(trie->alloc_pool, n, sizeof(trie_node));
+    free_trie_mem(trie, n, sizeof(trie_node));
   } else
   { n->children.any = NULL;
     clear(n, TN_PRIMARY|TN_SECONDARY);
@@ -333,19 +546,26 @@ next:
   { switch( children.any->type )
     { case TN_KEY:
       { n = children.key->child;
-	free_to_pool(trie->alloc_pool, children.key, sizeof(*children.key));
+	free_trie_mem(trie, children.key, sizeof(*children.key));
 	dealloc = TRUE;
 	goto next;
       }
+      case TN_ARRAY:
+      { trie_children_array *a = children.array;
+	unsigned i = 0;
+	trie_node *child;
+
+	while( (child=next_array_child(a, &i, NULL)) )
+	  clear_node(trie, child, TRUE);
+	free_trie_mem(trie, a, sizeof_children_array(a->size));
+	break;
+      }
       case TN_HASHED:
       { Table table = children.hash->table;
 	TableEnum e = newTableEnum(table);
 	void *k, *v;
-	trie_children_key *os;
 
-	if ( (os=children.hash->old_single) )	/* see insert_child() (*) note */
-	  free_to_pool(trie->alloc_pool, os, sizeof(*os));
-	free_to_pool(trie->alloc_pool, children.hash, sizeof(*children.hash));
+	free_trie_mem(trie, children.hash, sizeof(*children.hash));
 
 	while(advanceTableEnum(e, &k, &v))
 	{ clear_node(trie, v, TRUE);
@@ -383,12 +603,18 @@ prune_node(trie *trie, trie_node *n)
 
     p = n->parent;
     children = p->children;
+    if ( !trie )
+      trie = get_trie_from_node(n);
 
     if ( children.any )
     { switch( children.any->type )
       { case TN_KEY:
 	  if ( COMPARE_AND_SWAP_PTR(&p->children.any, children.any, NULL) )
-	    PL_free(children.any);
+	    free_trie_mem(trie, children.any, sizeof(*children.key));
+	  break;
+	case TN_ARRAY:
+	  delete_array_child(children.array, n);
+	  empty = array_is_empty(children.array);
 	  break;
 	case TN_HASHED:
 	  deleteHTable(children.hash->table, (void*)n->key);
@@ -397,8 +623,6 @@ prune_node(trie *trie, trie_node *n)
       }
     }
 
-    if ( !trie )
-      trie = get_trie_from_node(n);
     destroy_node(trie, n);
   }
 }
@@ -409,7 +633,9 @@ prune_node(trie *trie, trie_node *n)
 */
 
 typedef struct prune_state
-{ TableEnum  e;
+{ TableEnum  e;				/* Enumerating a TN_HASHED node */
+  trie_children_array *array;		/* Enumerating a TN_ARRAY node */
+  unsigned   index;			/* Next slot in array */
   trie_node *n;
 } prune_state;
 
@@ -434,6 +660,23 @@ prune_trie(trie *trie, trie_node *root,
 	{ n = children.key->child;
 	  continue;
 	}
+	case TN_ARRAY:
+	{ unsigned i = 0;
+	  trie_node *child;
+
+	  if ( (child=next_array_child(children.array, &i, NULL)) )
+	  { if ( !pushSegStack(&stack, ps, prune_state) )
+	      outOfCore();
+	    ps.e     = NULL;
+	    ps.array = children.array;
+	    ps.index = i;
+	    ps.n     = n;
+
+	    n = child;
+	    continue;
+	  }
+	  break;
+	}
 	case TN_HASHED:
 	{ Table table = children.hash->table;
 	  TableEnum e = newTableEnum(table);
@@ -442,8 +685,9 @@ prune_trie(trie *trie, trie_node *root,
 	  if ( advanceTableEnum(e, &k, &v) )
 	  { if ( !pushSegStack(&stack, ps, prune_state) )
 	      outOfCore();
-	    ps.e = e;
-	    ps.n = n;
+	    ps.e     = e;
+	    ps.array = NULL;
+	    ps.n     = n;
 
 	    n = v;
 	    continue;
@@ -470,7 +714,11 @@ prune_trie(trie *trie, trie_node *root,
       { switch( children.any->type )
 	{ case TN_KEY:
 	    if ( COMPARE_AND_SWAP_PTR(&p->children.any, children.any, NULL) )
-	      PL_free(children.any);
+	      free_trie_mem(trie, children.any, sizeof(*children.key));
+	    break;
+	  case TN_ARRAY:
+	    delete_array_child(children.array, n);
+	    choice = TRUE;
 	    break;
 	  case TN_HASHED:
 	    deleteHTable(children.hash->table, (void*)n->key);
@@ -500,6 +748,20 @@ prune_trie(trie *trie, trie_node *root,
 	  goto prune;
 	goto next_choice;
       }
+    } else if ( ps.array )
+    { trie_children_array *a = ps.array;
+      trie_node *child;
+
+      if ( (child=next_array_child(a, &ps.index, NULL)) )
+      { n = child;
+	continue;
+      } else
+      { n = ps.n;
+	popSegStack(&stack, &ps, prune_state);
+	if ( array_is_empty(a) )
+	  goto prune;
+	goto next_choice;
+      }
     } else
     { break;
     }
@@ -529,60 +791,171 @@ update_var_mask(trie_children_hashed *hnode, word key)
 
 
 /* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-(*) The single node may be  in  use   with  another  thread. We have two
-options:
-
-  - Use one of the LD _active_ pointers to acquire/release access to the
-    trie nodes and use safe delayed release.
-  - Add the ond _single_ node to the new hash node and delete it along
-    with the hash node when we clean the table.  We have opted for this
-    option as it is simple and the single key is neglectable in size
-    compared to the hash table anyway.
+The replaced single or array node may  still be in use by another thread.
+All code that walks the  trie  holds   a  reference  on  it  (see
+acquire_trie()). After installing the new node  using CAS, no thread can
+find the old node unless it  acquired  the   trie  before.  So, if our
+reference is the only one  we  can  free   the  old  node  as  well as
+replaced nodes that are waiting on  trie->replaced. Otherwise the node is
+added to trie->replaced. Note that we must detach trie->replaced before
+checking the reference count: nodes added  after   the  check may still be
+in use by threads that entered the trie after it.
 - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
+static void
+release_children(trie *trie, try_children_any *any)
+{ trie_replaced *r, *list, *last;
+
+  do
+  { list = trie->replaced;
+  } while( list && !COMPARE_AND_SWAP_PTR(&trie->replaced, list, NULL) );
+
+  if ( trie->references == 1 )
+  { free_children_node(trie, any);
+    free_replaced_children(trie, list);
+    return;
+  }
+
+  r = allocHeapOrHalt(sizeof(*r));
+  r->children = any;
+  r->next = list;
+  for(last=r; last->next; last=last->next)
+    ;
+  do
+  { last->next = trie->replaced;
+  } while( !COMPARE_AND_SWAP_PTR(&trie->replaced, last->next, r) );
+}
+
+
+/* Replace the full array `a` of `n` by a larger array or a hash table.
+ * Returns FALSE on a resource error.  If another thread replaced `a`
+ * first we simply return TRUE and the caller retries.
+ */
+
+static int
+grow_children(trie *trie, trie_node *n, trie_children_array *a)
+{ unsigned i, live = 0;
+  trie_children new;
+
+  for(i=0; i<a->size; i++)		/* all slots are claimed */
+  { if ( a->slots[i].key != TRIE_KEY_DELETED )
+    { wait_slot_child(&a->slots[i]);
+      live++;
+    }
+  }
+
+  if ( live < TRIE_ARRAY_MAX )
+  { unsigned size = live < TRIE_ARRAY_MIN ? TRIE_ARRAY_MIN : TRIE_ARRAY_MAX;
+    unsigned j = 0;
+
+    if ( !(new.array=new_children_array(trie, size)) )
+      return FALSE;
+    for(i=0; i<a->size; i++)
+    { if ( a->slots[i].key != TRIE_KEY_DELETED )
+	new.array->slots[j++] = a->slots[i];
+    }
+
+    if ( COMPARE_AND_SWAP_PTR(&n->children.array, a, new.array) )
+    { release_children(trie, (try_children_any*)a);
+      return TRUE;
+    }
+    free_trie_mem(trie, new.array, sizeof_children_array(size));
+  } else
+  { if ( !(new.hash=alloc_trie_mem(trie, sizeof(*new.hash))) )
+      return FALSE;
+    new.hash->type     = TN_HASHED;
+    new.hash->table    = newHTable(4);
+    new.hash->var_mask = 0;
+    for(i=0; i<a->size; i++)
+    { word k = a->slots[i].key;
+
+      if ( k != TRIE_KEY_DELETED )
+      { addHTable(new.hash->table, (void*)k, a->slots[i].child);
+	update_var_mask(new.hash, k);
+      }
+    }
+
+    if ( COMPARE_AND_SWAP_PTR(&n->children.array, a, new.array) )
+    { release_children(trie, (try_children_any*)a);
+      return TRUE;
+    }
+    destroyHTable(new.hash->table);
+    free_trie_mem(trie, new.hash, sizeof(*new.hash));
+  }
+
+  return TRUE;
+}
+
+
 static trie_node *
 insert_child(trie *trie, trie_node *n, word key ARG_LD)
-{ for(;;)
+{ trie_node *new = NULL;
+
+  for(;;)
   { trie_children children = n->children;
-    trie_node *new = new_trie_node(trie, key);
 
-    if ( !new )
+    if ( children.any && children.any->type == TN_KEY &&
+	 children.key->key == key )
+    { if ( new )				/* lost the race */
+	destroy_node(trie, new);
+      return children.key->child;
+    }
+
+    if ( !new && !(new = new_trie_node(trie, key)) )
       return NULL;			/* resource error */
 
     if ( children.any )
     { switch( children.any->type )
       { case TN_KEY:
-	{ if ( children.key->key == key )
-	  { return children.key->child;
-	  } else
-	  { trie_children_hashed *hnode;
+	{ trie_children_array *anode;
+
+	  if ( !(anode=new_children_array(trie, TRIE_ARRAY_MIN)) )
+	  { destroy_node(trie, new);
+	    return NULL;
+	  }
 
-	    if ( !(hnode=alloc_from_pool(trie->alloc_pool, sizeof(*hnode))) )
+	  anode->slots[0].key   = children.key->key;
+	  anode->slots[0].child = children.key->child;
+	  anode->slots[1].key   = key;
+	  anode->slots[1].child = new;
+	  new->parent = n;
+
+	  if ( COMPARE_AND_SWAP_PTR(&n->children.array, children.array, anode) )
+	  { release_children(trie, children.any);
+	    return new;
+	  }
+					/* retry, reusing `new` */
+	  free_trie_mem(trie, anode, sizeof_children_array(TRIE_ARRAY_MIN));
+	  continue;
+	}
+	case TN_ARRAY:
+	{ trie_children_array *a = children.array;
+	  unsigned i;
+
+	  for(i=0; i<a->size; i++)
+	  { trie_children_slot *slot = &a->slots[i];
+	    word k = slot->key;
+
+	    if ( !k )
+	    { new->parent = n;
+	      if ( COMPARE_AND_SWAP_WORD(&slot->key, 0, key) )
+	      { MEMORY_RELEASE();
+		slot->child = new;
+		return new;
+	      }
+	      k = slot->key;
+	    }
+	    if ( k == key )
 	    { destroy_node(trie, new);
-	      return NULL;
+	      return wait_slot_child(slot);
 	    }
+	  }
 
-	    hnode->type     = TN_HASHED;
-	    hnode->table    = newHTable(4);
-	    hnode->var_mask = 0;
-	    addHTable(hnode->table, (void*)children.key->key,
-				    children.key->child);
-	    addHTable(hnode->table, (void*)key, (void*)new);
-	    update_var_mask(hnode, children.key->key);
-	    update_var_mask(hnode, new->key);
-	    new->parent = n;
-
-	    if ( COMPARE_AND_SWAP_PTR(&n->children.hash, children.hash, hnode) )
-	    { hnode->old_single = children.key;			/* See (*) */
-	      return new;
-	    } else
-	    { hnode->old_single = NULL;
-	      destroy_node(trie, new);
-	      destroyHTable(hnode->table);
-	      free_to_pool(trie->alloc_pool, hnode, sizeof(*hnode));
-	      continue;
-	    }
+	  if ( !grow_children(trie, n, a) )
+	  { destroy_node(trie, new);
+	    return NULL;
 	  }
+	  continue;
 	}
 	case TN_HASHED:
 	{ trie_node *old = addHTable(children.hash->table,
@@ -602,7 +975,7 @@ insert_child(trie *trie, trie_node *n, word key ARG_LD)
     } else
     { trie_children_key *child;
 
-      if ( !(child=alloc_from_pool(trie->alloc_pool, sizeof(*child))) )
+      if ( !(child=alloc_trie_mem(trie, sizeof(*child))) )
       { destroy_node(trie, new);
 	return NULL;
       }
@@ -615,8 +988,7 @@ insert_child(trie *trie, trie_node *n, word key ARG_LD)
       { child->child->parent = n;
 	return child->child;
       }
-      destroy_node(trie, new);
-      free_to_pool(trie->alloc_pool, child, sizeof(*child));
+      free_trie_mem(trie, child, sizeof(*child));
     }
   }
 }
@@ -700,6 +1072,7 @@ trie_lookup_abstract(trie *trie, trie_node *node, trie_node **nodep,
   size_t aleft = (size_t)-1;
 
   TRIE_STAT_INC(trie, lookups);
+  acquire_trie(trie);
   if ( !node )
     node = &trie->root;
   if ( abstract )
@@ -807,6 +1180,205 @@ trie_lookup_abstract(trie *trie, trie_node *node, trie_node **nodep,
     else
       rc = FALSE;
   }
+  release_trie(trie);
+
+  return rc;
+}
+
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Find the values of all keys in `trie` that  subsume `k`, i.e., keys `K`
+for which there is a substitution `S` such that `KS == k`. This is used
+for call subsumptive tabling.
+
+The trie is traversed depth-first,  walking  `k`   in  the  same  prefix
+order as trie_lookup_abstract(). At each  node   we  first try the child
+with the same key as the subterm of `k`.   Next we try variable keys. If
+this is the first occurrence of the   variable  in the key we "bind" the
+variable to the subterm and skip the   subterm. Otherwise the subterm of
+`k` must be == to the subterm the  variable   is  bound to. Variables in
+`k` can only be matched by variable keys.
+
+Skipping a compound subterm changes the   pop  keys that follow. We thus
+first flatten `k` into an array of  subterms, recording the depth of the
+subterm and the index of the subterm that  follows it. The pop key after
+a subterm is the difference in depth with  the next subterm. As an exact
+key is tried before a variable key the most specific generalizations are
+found first.
+
+Returns FALSE if `k` is cyclic or contains attributed variables.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+typedef struct sub_item
+{ Word		term;			/* Dereferenced subterm */
+  word		key;			/* Its trie key or 0 */
+  size_t	end;			/* Index of next subterm */
+  size_t	depth;			/* Compound nesting */
+  int		compound;		/* Subterm is compound */
+} sub_item;
+
+typedef struct sub_frame
+{ Word		args;			/* Next argument */
+  size_t	left;			/* # arguments left */
+  size_t	item;			/* Item of the compound */
+} sub_frame;
+
+typedef struct sub_choice
+{ trie_node    *node;			/* Node to match item against */
+  size_t	item;			/* Item to match */
+  size_t	nvars;			/* # variables bound */
+  size_t	alt;			/* 0: exact key, else variable key */
+} sub_choice;
+
+static int
+flatten_subsumed(trie *trie, Word k, TmpBuffer items ARG_LD)
+{ tmp_buffer stack;
+  Word p = k;
+  int rc = TRUE;
+
+  if ( !is_acyclic(k PASS_LD) )
+    return FALSE;
+
+  initBuffer(&stack);
+  for(;;)
+  { sub_item it;
+    size_t me = entriesBuffer(items, sub_item);
+    word w;
+
+    deRef(p);
+    w = *p;
+    it.term     = p;
+    it.end      = me+1;
+    it.depth    = entriesBuffer(&stack, sub_frame);
+    it.compound = FALSE;
+
+    if ( isTerm(w) )
+    { Functor f = valueTerm(w);
+      size_t arity = arityFunctor(f->definition);
+
+      it.key = f->definition;
+      if ( arity > 0 )
+      { sub_frame fr = { .args = f->arguments, .left = arity, .item = me };
+
+	it.compound = TRUE;
+	addBuffer(&stack, fr, sub_frame);
+      }
+    } else if ( isAttVar(w) )
+    { rc = FALSE;
+      break;
+    } else if ( isVar(w) )
+    { it.key = 0;
+    } else if ( isIndirect(w) )
+    { it.key = trie_intern_indirect(trie, w, FALSE PASS_LD);
+    } else
+    { it.key = w;
+    }
+    addBuffer(items, it, sub_item);
+
+    for(;;)
+    { sub_frame *fr;
+
+      if ( isEmptyBuffer(&stack) )
+	goto out;
+      fr = topBuffer(&stack, sub_frame)-1;
+      if ( fr->left > 0 )
+      { p = fr->args++;
+	fr->left--;
+	break;
+      }
+      baseBuffer(items, sub_item)[fr->item].end =
+	entriesBuffer(items, sub_item);
+      (void)popBuffer(&stack, sub_frame);
+    }
+  }
+
+out:
+  discardBuffer(&stack);
+
+  return rc;
+}
+
+
+static int
+trie_lookup_subsuming(trie *trie, Word k, TmpBuffer values ARG_LD)
+{ tmp_buffer ib, cb;
+  size_t *bindings = NULL;
+  int rc;
+
+  initBuffer(&ib);
+  initBuffer(&cb);
+  acquire_trie(trie);
+
+  if ( (rc=flatten_subsumed(trie, k, &ib PASS_LD)) )
+  { sub_item *items = baseBuffer(&ib, sub_item);
+    size_t nitems = entriesBuffer(&ib, sub_item);
+    sub_choice start = { .node = &trie->root };
+
+    bindings = malloc(nitems*sizeof(*bindings));
+    if ( !bindings )
+    { rc = PL_no_memory();
+      goto out;
+    }
+    addBuffer(&cb, start, sub_choice);
+
+    while ( !isEmptyBuffer(&cb) )
+    { sub_choice c = popBuffer(&cb, sub_choice);
+      sub_item *item = &items[c.item];
+      trie_node *child = NULL;
+      size_t next = item->end;
+      size_t nvars = c.nvars;
+
+      for( ; !child && c.alt <= c.nvars+1; c.alt++ )
+      { if ( c.alt == 0 )
+	{ if ( item->key && (child=get_child(c.node, item->key PASS_LD)) &&
+	       item->compound )
+	    next = c.item+1;
+	} else
+	{ word vk = (((word)c.alt)<<LMASK_BITS)|TAG_VAR;
+
+	  next = item->end;
+	  if ( (child=get_child(c.node, vk PASS_LD)) )
+	  { if ( c.alt <= c.nvars )
+	    { if ( compareStandard(items[bindings[c.alt-1]].term, item->term,
+				   TRUE PASS_LD) != CMP_EQUAL )
+		child = NULL;
+	    } else
+	    { bindings[c.nvars] = c.item;
+	      nvars = c.nvars+1;
+	    }
+	  }
+	}
+      }
+      if ( !child )
+	continue;
+      if ( c.alt <= c.nvars+1 )
+	addBuffer(&cb, c, sub_choice);
+
+      if ( next == nitems )
+      { if ( child->value )
+	  addBuffer(values, child->value, word);
+      } else
+      { if ( next == item->end )
+	{ size_t pops = item->depth - items[next].depth;
+
+	  if ( pops > 0 &&
+	       !(child=get_child(child, TRIE_KEY_POP(pops) PASS_LD)) )
+	    continue;
+	}
+
+	{ sub_choice nc = { .node = child, .item = next, .nvars = nvars };
+	  addBuffer(&cb, nc, sub_choice);
+	}
+      }
+    }
+  }
+
+out:
+  release_trie(trie);
+  if ( bindings )
+    free(bindings);
+  discardBuffer(&cb);
+  discardBuffer(&ib);
 
   return rc;
 }
@@ -960,6 +1532,16 @@ next:
       { n = children.key->child;
 	goto next;
       }
+      case TN_ARRAY:
+      { unsigned i = 0;
+	trie_node *child;
+
+	while( (child=next_array_child(children.array, &i, NULL)) )
+	{ if ( (rc=map_trie_node(child, map, ctx)) != NULL )
+	    return rc;
+	}
+	break;
+      }
       case TN_HASHED:
       { Table table = children.hash->table;
 	TableEnum e = newTableEnum(table);
@@ -1005,8 +1587,12 @@ stat_node(trie_node *n, void *ctx)
     { case TN_KEY:
 	stats->bytes += sizeof(*children.key);
         break;
+      case TN_ARRAY:
+	stats->bytes += sizeof_children_array(children.array->size);
+	break;
       case TN_HASHED:
 	stats->bytes += sizeofTable(children.hash->table);
+	stats->bytes += sizeof(*children.hash);
 	stats->hashes++;
 	break;
       default:
@@ -1027,6 +1613,7 @@ stat_trie(trie *t, trie_stats *stats)
 
   acquire_trie(t);
   map_trie_node(&t->root, stat_node, stats);
+  stats->bytes += sizeof_replaced_children(t);
   release_trie(t);
 }
 
@@ -1252,33 +1839,53 @@ put_trie_value(term_t t, trie_node *node ARG_LD)
 }
 
 
-int
-set_trie_value_word(trie *trie, trie_node *node, word val)
-{ if ( node->value )
-  { if ( !equal_value(node->value, val) )
-    { word old = node->value;
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+claim_trie_value() associates `val` with `node`. The value is installed
+using compare-and-swap such that if multiple threads concurrently insert
+the same key into a shared trie exactly one of them adds it.  Returns
+TRUE if the value was set or changed, FALSE if the node already has an
+equal value and -1 if the node has a different value and `update` is
+FALSE.  Unless TRUE is returned, the caller remains responsible for
+`val`.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
 
-      acquire_key(val);
-      node->value = val;
-      set(node, TN_PRIMARY);
-      release_value(old);
-      trie_discard_clause(trie);
+static int
+claim_trie_value(trie *trie, trie_node *node, word val, int update)
+{ acquire_key(val);
 
+  for(;;)
+  { word old = node->value;
+
+    if ( old )
+    { if ( equal_value(old, val) )
+      { release_key(val);
+	return FALSE;
+      }
+      if ( !update )
+      { release_key(val);
+	return -1;
+      }
+      if ( COMPARE_AND_SWAP_WORD(&node->value, old, val) )
+      { ATOMIC_OR(&node->flags, TN_PRIMARY);
+	release_value(old);
+	trie_discard_clause(trie);
+	return TRUE;
+      }
+    } else if ( COMPARE_AND_SWAP_WORD(&node->value, 0, val) )
+    { ATOMIC_OR(&node->flags, TN_PRIMARY);
+      ATOMIC_INC(&trie->value_count);
+      trie_discard_clause(trie);
       return TRUE;
-    } else
-    { return FALSE;
     }
-  } else
-  { acquire_key(val);
-    node->value = val;
-    set(node, TN_PRIMARY);
-    ATOMIC_INC(&trie->value_count);
-    trie_discard_clause(trie);
-
-    return TRUE;
   }
 }
 
+
+int
+set_trie_value_word(trie *trie, trie_node *node, word val)
+{ return claim_trie_value(trie, node, val, TRUE) == TRUE;
+}
+
 int
 set_trie_value(trie *trie, trie_node *node, term_t value ARG_LD)
 { word val = intern_value(value PASS_LD);
@@ -1366,37 +1973,15 @@ trie_insert(term_t Trie, term_t Key, term_t Value, trie_node **nodep,
       if ( nodep )
 	*nodep = node;
 
-      if ( node->value )
-      { if ( update )
-	{ if ( !equal_value(node->value, val) )
-	  { word old = node->value;
-
-	    acquire_key(val);
-	    node->value = val;
-	    set(node, TN_PRIMARY);
-	    release_value(old);
-	    trie_discard_clause(trie);
-	  } else if ( isRecord(val) )
-	  { PL_erase((record_t)val);
-	  }
-
-	  return TRUE;
-	} else
-	{ if ( !equal_value(node->value, val) )
-	    PL_permission_error("modify", "trie_key", Key);
-	  if ( isRecord(val) )
-	    PL_erase((record_t)val);
+      if ( (rc=claim_trie_value(trie, node, val, update)) == TRUE )
+	return TRUE;
 
-	  return FALSE;
-	}
-      }
-      acquire_key(val);
-      node->value = val;
-      set(node, TN_PRIMARY);
-      ATOMIC_INC(&trie->value_count);
-      trie_discard_clause(trie);
+      if ( isRecord(val) )
+	PL_erase((record_t)val);
+      if ( rc < 0 )
+	return PL_permission_error("modify", "trie_key", Key);
 
-      return TRUE;
+      return update;			/* already there */
     }
 
     return trie_error(rc, Key);
@@ -1547,6 +2132,45 @@ PRED_IMPL("trie_lookup", 3, trie_lookup, 0)
 }
 
 
+/**
+ * '$trie_generalizations'(+Trie, +Term, -Values) is det.
+ *
+ * Values is a list of the values of all keys in Trie that subsume Term.
+ * More specific keys appear before more general ones.
+ */
+
+static
+PRED_IMPL("$trie_generalizations", 3, trie_generalizations, 0)
+{ PRED_LD
+  trie *trie;
+
+  if ( get_trie(A1, &trie) )
+  { tmp_buffer values;
+    int rc;
+
+    initBuffer(&values);
+    if ( (rc=trie_lookup_subsuming(trie, valTermRef(A2), &values PASS_LD)) )
+    { term_t tail = PL_copy_term_ref(A3);
+      term_t head = PL_new_term_ref();
+      word *vp = baseBuffer(&values, word);
+      word *ep = topBuffer(&values, word);
+
+      for(; rc && vp < ep; vp++)
+	rc = ( PL_unify_list(tail, head, tail) &&
+	       unify_value(head, *vp PASS_LD) );
+      rc = rc && PL_unify_nil(tail);
+    } else if ( !PL_exception(0) )
+    { rc = PL_unify_nil(A3);
+    }
+    discardBuffer(&values);
+
+    return rc;
+  }
+
+  return FALSE;
+}
+
+
 /**
  * trie_term(+Handle, -Term) is det.
  *
@@ -1802,6 +2426,8 @@ unify_key(ukey_state *state, word key ARG_LD)
 
 typedef struct trie_choice
 { TableEnum  table_enum;
+  trie_children_array *array;
+  unsigned   array_index;
   Table      table;
   unsigned   var_mask;
   unsigned   var_index;
@@ -1972,6 +2598,7 @@ add_choice(trie_gen_state *state, descent_state *dstate, trie_node *node ARG_LD)
 	  ch->key        = key;
 	  ch->child      = children.key->child;
 	  ch->table_enum = NULL;
+	  ch->array      = NULL;
 	  ch->table      = NULL;
 
 	  if ( IS_TRIE_KEY_POP(children.key->key) && dstate->compound )
@@ -1999,6 +2626,7 @@ add_choice(trie_gen_state *state, descent_state *dstate, trie_node *node ARG_LD)
 	      ch->key        = k;
 	      ch->child	     = child;
 	      ch->table_enum = NULL;
+	      ch->array      = NULL;
 	      ch->table      = NULL;
 
 	      return ch;
@@ -2012,6 +2640,7 @@ add_choice(trie_gen_state *state, descent_state *dstate, trie_node *node ARG_LD)
 
 	    ch = allocFromBuffer(&state->choicepoints, sizeof(*ch));
 	    ch->table_enum = NULL;
+	    ch->array      = NULL;
 	    ch->table      = children.hash->table;
 	    ch->var_mask   = children.hash->var_mask;
 	    ch->var_index  = 1;
@@ -2029,12 +2658,56 @@ add_choice(trie_gen_state *state, descent_state *dstate, trie_node *node ARG_LD)
 	dstate->prune = FALSE;
 	ch = allocFromBuffer(&state->choicepoints, sizeof(*ch));
 	ch->table = NULL;
+	ch->array = NULL;
 	ch->table_enum = newTableEnum(children.hash->table);
 	advanceTableEnum(ch->table_enum, &tk, &tv);
 	ch->key   = (word)tk;
 	ch->child = (trie_node*)tv;
 	break;
       }
+      case TN_ARRAY:
+      { trie_children_array *a = children.array;
+
+	if ( has_key )
+	{ unsigned i;
+	  int vars = FALSE;
+
+	  for(i=0; i<a->size && a->slots[i].key; i++)
+	  { if ( tagex(a->slots[i].key) == TAG_VAR )
+	    { vars = TRUE;
+	      break;
+	    }
+	  }
+
+	  if ( !vars )
+	  { trie_node *child;
+
+	    if ( (child = array_child(a, k)) )
+	    { ch = allocFromBuffer(&state->choicepoints, sizeof(*ch));
+	      ch->key        = k;
+	      ch->child	     = child;
+	      ch->table_enum = NULL;
+	      ch->array      = NULL;
+	      ch->table      = NULL;
+
+	      return ch;
+	    } else
+	      return NULL;
+	  }
+	}
+					/* enumerate the array */
+	dstate->prune = FALSE;
+	ch = allocFromBuffer(&state->choicepoints, sizeof(*ch));
+	ch->table_enum  = NULL;
+	ch->table       = NULL;
+	ch->array       = a;
+	ch->array_index = 0;
+	if ( !advance_node(ch PASS_LD) )
+	{ state->choicepoints.top = (char*)ch;
+	  return NULL;
+	}
+	break;
+      }
       default:
 	assert(0);
         return NULL;
@@ -2071,6 +2744,9 @@ advance_node(trie_choice *ch ARG_LD)
 
       return TRUE;
     }
+  } else if ( ch->array )
+  { return (ch->child=next_array_child(ch->array, &ch->array_index,
+				       &ch->key)) != NULL;
   } else if ( ch->table )
   { if ( ch->novar )
     { if ( (ch->child=lookupHTable(ch->table, (void*)ch->novar)) )
@@ -2345,21 +3021,31 @@ static
 PRED_IMPL("$trie_property", 2, trie_property, 0)
 { PRED_LD
   trie *trie;
-
+  static atom_t ATOM_completion_time = 0;
+  static atom_t ATOM_scc_size = 0;
 #ifdef O_TRIE_STATS
   static atom_t ATOM_lookup_count = 0;
   static atom_t ATOM_gen_call_count = 0;
   static atom_t ATOM_invalidated = 0;
   static atom_t ATOM_reevaluated = 0;
+  static atom_t ATOM_call_count = 0;
+  static atom_t ATOM_reuse_count = 0;
 
   if ( !ATOM_lookup_count )
   { ATOM_lookup_count   = PL_new_atom("lookup_count");
     ATOM_gen_call_count = PL_new_atom("gen_call_count");
     ATOM_invalidated    = PL_new_atom("invalidated");
     ATOM_reevaluated    = PL_new_atom("reevaluated");
+    ATOM_call_count     = PL_new_atom("call_count");
+    ATOM_reuse_count    = PL_new_atom("reuse_count");
   }
 #endif
 
+  if ( !ATOM_scc_size )
+  { ATOM_completion_time = PL_new_atom("completion_time");
+    ATOM_scc_size        = PL_new_atom("scc_size");
+  }
+
   if ( get_trie(A1, &trie) )
   { atom_t name; size_t arity;
     idg_node *idg;
@@ -2399,11 +3085,21 @@ PRED_IMPL("$trie_property", 2, trie_property, 0)
       { trie_stats stats;
 	stat_trie(trie, &stats);
 	return PL_unify_int64(arg, stats.hashes);
+      } else if ( name == ATOM_scc_size && trie->data.scc_size &&
+		  true(trie, TRIE_COMPLETE) )
+      { return PL_unify_int64(arg, trie->data.scc_size);
+      } else if ( name == ATOM_completion_time && trie->data.scc_size &&
+		  true(trie, TRIE_COMPLETE) )
+      { return PL_unify_float(arg, trie->data.cost);
 #ifdef O_TRIE_STATS
       } else if ( name == ATOM_lookup_count )
       { return PL_unify_int64(arg, trie->stats.lookups);
       } else if ( name == ATOM_gen_call_count)
       { return PL_unify_int64(arg, trie->stats.gen_call);
+      } else if ( name == ATOM_call_count )
+      { return PL_unify_int64(arg, trie->stats.calls);
+      } else if ( name == ATOM_reuse_count )
+      { return PL_unify_int64(arg, trie->stats.reused);
 #ifdef O_PLMT
       } else if ( name == ATOM_wait )
       { return PL_unify_int64(arg, trie->stats.wait);
@@ -2842,6 +3538,27 @@ children:
 	n = children.key->child;
 	goto next;
       }
+      case TN_ARRAY:
+      { trie_children_array *a = children.array;
+	unsigned i = 0;
+	trie_node *child;
+
+	if ( !(n=next_array_child(a, &i, NULL)) )
+	  return TRUE;				/* empty path */
+
+	for(;;)
+	{ if ( !(child=next_array_child(a, &i, NULL)) )
+	  { state->try = FALSE;
+	    goto next;
+	  }
+	  state->try = TRUE;
+
+	  if ( (rc=compile_trie_node(n, state PASS_LD)) != TRUE )
+	    return rc;
+	  fixup_else(state);
+	  n = child;
+	}
+      }
       case TN_HASHED:
       { Table table = children.hash->table;
 	TableEnum e = newTableEnum(table);
@@ -2916,7 +3633,7 @@ create_trie_clause(Definition def, Clause *cp, trie_compile_state *state)
   //size_t clsize    = size + SIZEOF_CREF_CLAUSE;
   Clause cl;
 
-  cl = PL_malloc_atomic(size);
+  cl = allocClause(size);
   memset(cl, 0, sizeof(*cl));
   cl->predicate = def;
   cl->code_size = code_size;
@@ -2947,11 +3664,14 @@ retry:
     { trie_compile_state state;
       Clause cl;
       ClauseRef cref;
+      int rc;
 
       init_trie_compile_state(&state, trie);
       add_vmi(&state, def->functor->arity == 2 ? T_TRIE_GEN2 : T_TRIE_GEN3);
-      if ( compile_trie_node(&trie->root, &state PASS_LD) &&
-	   create_trie_clause(def, &cl, &state) )
+      acquire_trie(trie);
+      rc = compile_trie_node(&trie->root, &state PASS_LD);
+      release_trie(trie);
+      if ( rc && create_trie_clause(def, &cl, &state) )
       { cref = assertDefinition(def, cl, CL_END PASS_LD);
 	if ( cref )
 	{ dbref = lookup_clref(cref->value.clause);
@@ -3024,6 +3744,7 @@ BeginPredDefs(trie)
 
   PRED_DEF("trie_update",	    3, trie_update,	     0)
   PRED_DEF("trie_lookup",	    3, trie_lookup,	     0)
+  PRED_DEF("$trie_generalizations", 3, trie_generalizations, 0)
   PRED_DEF("trie_delete",	    3, trie_delete,	     0)
   PRED_DEF("trie_term",		    2, trie_term,	     0)
   PRED_DEF("trie_gen",		    3, trie_gen,	     NDET)
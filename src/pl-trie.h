@@ -46,6 +46,7 @@
 
 typedef enum
 { TN_KEY,				/* Single key */
+  TN_ARRAY,				/* Small array of keys */
   TN_HASHED				/* Hashed */
 } tn_node_type;
 
@@ -59,19 +60,35 @@ typedef struct trie_children_key
   struct trie_node *child;
 } trie_children_key;
 
+typedef struct trie_children_slot
+{ word key;				/* 0: free, else claimed */
+  struct trie_node *child;		/* NULL while being filled */
+} trie_children_slot;
+
+typedef struct trie_children_array
+{ tn_node_type	type;			/* TN_ARRAY */
+  unsigned	size;			/* Allocated slots */
+  trie_children_slot slots[];		/* Append-only key/child pairs */
+} trie_children_array;
+
 typedef struct trie_children_hashed
 { tn_node_type	type;			/* TN_HASHED */
   Table		table;			/* Key --> child map */
   unsigned	var_mask;		/* Variables in this place */
-  trie_children_key *old_single;	/* Old single node */
 } trie_children_hashed;
 
 typedef union trie_children
 { try_children_any     *any;
   trie_children_key    *key;
+  trie_children_array  *array;
   trie_children_hashed *hash;
 } trie_children;
 
+typedef struct trie_replaced
+{ struct trie_replaced *next;		/* Next in chain */
+  try_children_any     *children;	/* Replaced children node */
+} trie_replaced;
+
 
 #define TN_PRIMARY			0x0001	/* Primary value node */
 #define TN_SECONDARY			0x0002	/* Secondary value node */
@@ -117,11 +134,14 @@ typedef struct trie
   indirect_table       *indirects;	/* indirect values */
   void		      (*release_node)(struct trie *, trie_node *);
   alloc_pool	       *alloc_pool;	/* Node allocation pool */
+  trie_replaced	       *replaced;	/* Children nodes waiting to be freed */
   atom_t		clause;		/* Compiled representation */
 #ifdef O_TRIE_STATS
   struct
   { uint64_t		lookups;	/* trie_lookup */
     uint64_t		gen_call;	/* trie_gen calls */
+    uint64_t		calls;		/* tabled calls using this table */
+    uint64_t		reused;		/* calls finding it complete */
 #ifdef O_PLMT
     unsigned int	deadlock;	/* times involved in a deadlock */
     unsigned int	wait;		/* times waited for */
@@ -133,6 +153,10 @@ typedef struct trie
     trie_node	    *variant;		/* node in variant trie */
     struct idg_node *IDG;		/* Node in the IDG graph */
     Definition	     predicate;		/* Associated predicate */
+    uint64_t	     accessed;		/* Access stamp (table eviction) */
+    double	     cost;		/* Wall time to complete */
+    unsigned int     scc_size;		/* # tables in SCC at completion */
+    struct tbl_component *component;	/* SCC of worklist (offer_help_job()) */
   } data;
 } trie;
 
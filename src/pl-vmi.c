@@ -1790,7 +1790,9 @@ retry_continue:
 }
 #endif
 
-  if ( unlikely(LD->alerted) )
+  if ( unlikely(LD->alerted) &&		/* resource limits: see pl-thread.c */
+       ( LD->alerted != ALERT_RESOURCES ||
+	 LD->statistics.inferences >= LD->accounting.check_at ) )
   {					/* play safe */
     lTop = (LocalFrame) argFrameP(FR, DEF->functor->arity);
     PC = DEF->codes;
@@ -1853,6 +1855,17 @@ retry_continue:
 	THROW_EXCEPTION;
     }
 #endif
+#ifdef O_PLMT
+    if ( (LD->alerted & ALERT_RESOURCES) &&
+	 LD->statistics.inferences >= LD->accounting.check_at )
+    { lTop = (LocalFrame) argFrameP(FR, DEF->functor->arity);
+      SAVE_REGISTERS(qid);
+      checkResourceLimits(PASS_LD1);
+      LOAD_REGISTERS(qid);
+      if ( exception_term )
+	THROW_EXCEPTION;
+    }
+#endif
 
 #if O_DEBUGGER
     if ( debugstatus.debugging )
@@ -280,6 +280,7 @@ updateAlerted(PL_local_data_t *ld)
   if ( ld->_debugstatus.debugging )		mask |= ALERT_DEBUG;
 #endif
   if ( ld->fli.string_buffers.top )		mask |= ALERT_BUFFER;
+  if ( ld->accounting.check_at )		mask |= ALERT_RESOURCES;
 
   ld->alerted = mask;
 
@@ -1395,9 +1396,13 @@ __do_undo(mark *m ARG_LD)
   if ( LD->frozen_bar > m->globaltop )
   { DEBUG(CHK_SECURE, assert(gTop >= LD->frozen_bar));
     reclaim_attvars(LD->frozen_bar PASS_LD);
+    if ( unlikely(LD->accounting.discards) )
+      LD->accounting.global_discarded += (char*)gTop - (char*)LD->frozen_bar;
     gTop = LD->frozen_bar;
   } else
   { reclaim_attvars(m->globaltop PASS_LD);
+    if ( unlikely(LD->accounting.discards) )
+      LD->accounting.global_discarded += (char*)gTop - (char*)m->globaltop;
     gTop = m->globaltop;
   }
 }
@@ -1423,6 +1428,47 @@ do_undo(mark *m)
 */
 
 #ifdef O_PLMT
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+Each thread-local predicate  gets  a  slot   number  when  it  is  made
+thread-local. The localised definitions of a  thread are cached in the
+array LD->thread.local_slots, indexed by this  slot, such that finding
+the definition is a single array access. The array is only accessed by
+its owner. The `blocks` array of   the  predicate remains the reference
+for accessing the definitions of other threads.
+
+Slots of destroyed predicates are  reused   (see  new_ldef_vector()). As
+other threads may still have an  entry   for  the old predicate, entries
+are only valid if their generation matches that of the predicate.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+static void
+cacheLocalDefinition(LocalDefinitions v, Definition local ARG_LD)
+{ unsigned int slot = v->slot;
+  local_slot *e;
+
+  if ( slot >= LD->thread.local_slots.size )
+  { unsigned int size = LD->thread.local_slots.size;
+    unsigned int newsize = size ? size : 16;
+    local_slot *new;
+
+    while( newsize <= slot )
+      newsize *= 2;
+    new = allocHeapOrHalt(newsize*sizeof(local_slot));
+    memset(new, 0, newsize*sizeof(local_slot));
+    if ( size )
+    { memcpy(new, LD->thread.local_slots.entries, size*sizeof(local_slot));
+      freeHeap(LD->thread.local_slots.entries, size*sizeof(local_slot));
+    }
+    LD->thread.local_slots.entries = new;
+    LD->thread.local_slots.size = newsize;
+  }
+
+  e = &LD->thread.local_slots.entries[slot];
+  e->definition = local;
+  e->generation = v->generation;
+}
+
+
 static Definition
 localDefinition(Definition def ARG_LD)
 { unsigned int tid = LD->thread.info->pl_tid;
@@ -1443,6 +1489,7 @@ localDefinition(Definition def ARG_LD)
 
   if ( !v->blocks[idx][tid] )
     v->blocks[idx][tid] = localiseDefinition(def);
+  cacheLocalDefinition(v, v->blocks[idx][tid] PASS_LD);
 
   return v->blocks[idx][tid];
 }
@@ -1464,7 +1511,17 @@ getProcDefinition__LD(Definition def ARG_LD)
 {
 #ifdef O_PLMT
   if ( true(def, P_THREAD_LOCAL) )
-  { MEMORY_ACQUIRE();
+  { LocalDefinitions v;
+
+    MEMORY_ACQUIRE();
+    v = def->impl.local.local;
+    if ( v->slot < LD->thread.local_slots.size )
+    { local_slot *e = &LD->thread.local_slots.entries[v->slot];
+
+      if ( e->definition && e->generation == v->generation )
+	return e->definition;
+    }
+
     return localDefinition(def PASS_LD);
   }
 #endif
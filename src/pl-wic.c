@@ -1597,8 +1597,8 @@ loadPredicate(wic_state *state, int skip ARG_LD)
 	  Clause bcl    = baseBuffer(&buf, struct clause);
 
 	  bcl->code_size = ncodes;
-	  clause = (Clause)PL_malloc_atomic(csize);
-	  memcpy(clause, bcl, csize);
+	  clause = allocClause(sizeofClause(ncodes));
+	  memcpy(clause, bcl, sizeofClause(ncodes));
 
 	  if ( has_dicts )
 	  { if ( !resortDictsInClause(clause) )
@@ -0,0 +1,690 @@
+/*  Part of SWI-Prolog
+
+    Author:        agent
+    E-mail:        agent@local
+    WWW:           http://www.swi-prolog.org
+    Copyright (c)  2026, agent
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    1. Redistributions of source code must retain the above copyright
+       notice, this list of conditions and the following disclaimer.
+
+    2. Redistributions in binary form must reproduce the above copyright
+       notice, this list of conditions and the following disclaimer in
+       the documentation and/or other materials provided with the
+       distribution.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pl-incl.h"
+#include "pl-thread.h"
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#undef LD
+#define LD LOCAL_LD
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+This module implements the task administration   of  the process-wide
+work pool used by concurrent_maplist/2..4, concurrent_forall/2,3 and the
+green threads of spawn/2 from library(thread).   The worker threads are
+ordinary Prolog threads that are created   by library(thread) and that
+register themselves here.
+
+Tasks are recorded terms that belong to  a   batch.  A batch is the set
+of tasks submitted by a single  call   and  allows for discarding the
+remaining tasks if one of them fails.  Each   worker owns a deque.  A
+worker pushes tasks it submits itself (nested  calls) to the bottom of
+its deque and takes them  from  there   (LIFO).  Tasks  submitted by
+threads that are not a worker are added to a shared injection queue. An
+idle worker first looks at its own deque,  then at the injection queue
+and finally steals the oldest task from  the   deque  of another worker
+(FIFO).  The deques are protected by a mutex each.  This is simple and
+fast enough as tasks are Prolog goals that are copied from a record.
+
+pool.pending counts the queued tasks.  It  is incremented with pool.mutex
+held, so a worker that finds it zero  while holding pool.mutex may safely
+wait on pool.cond.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#ifdef O_PLMT
+
+#define WP_MAX_WORKERS 1024
+
+typedef struct wp_task
+{ record_t	goal;			/* The task term */
+  int64_t	batch;			/* Batch it belongs to */
+} wp_task;
+
+typedef struct wp_deque
+{ simpleMutex	mutex;			/* Protects the deque */
+  wp_task      *tasks;			/* Ring buffer */
+  size_t	allocated;		/* Allocated size of tasks */
+  size_t	head;			/* Index of the oldest task */
+  size_t	count;			/* # tasks in the deque */
+} wp_deque;
+
+typedef struct wp_worker
+{ int		thread_id;		/* Prolog thread id (0: free) */
+  wp_deque	deque;			/* Own tasks */
+} wp_worker;
+
+static struct
+{ int		initialized;		/* Mutexes are initialized */
+  simpleMutex	mutex;			/* Protects waiting and slots */
+#ifdef __WINDOWS__
+  CONDITION_VARIABLE cond;		/* Signal idle workers */
+#else
+  pthread_cond_t cond;
+#endif
+  int		slots;			/* High water of worker[] */
+  int		active;			/* # registered workers */
+  int		idle;			/* # workers waiting */
+  int64_t	pending;		/* # queued tasks */
+  int64_t	batch;			/* Last allocated batch id */
+  uint64_t	steals;			/* # tasks taken from other workers */
+  wp_deque	inject;			/* Tasks from non-workers */
+  wp_worker    *worker[WP_MAX_WORKERS];
+} pool;
+
+
+static void
+init_deque(wp_deque *dq)
+{ memset(dq, 0, sizeof(*dq));
+  simpleMutexInit(&dq->mutex);
+}
+
+
+static void
+init_work_pool(void)
+{ if ( !pool.initialized )
+  { PL_LOCK(L_THREAD);
+    if ( !pool.initialized )
+    { simpleMutexInit(&pool.mutex);
+      cv_init(&pool.cond, NULL);
+      init_deque(&pool.inject);
+      pool.initialized = TRUE;
+    }
+    PL_UNLOCK(L_THREAD);
+  }
+}
+
+
+		 /*******************************
+		 *	      DEQUES		*
+		 *******************************/
+
+#define DQ_AT(dq, i) (&(dq)->tasks[((dq)->head+(i))%(dq)->allocated])
+
+/* push_tasks() adds n tasks to the bottom of the deque */
+
+static int
+push_tasks(wp_deque *dq, const wp_task *tasks, size_t n)
+{ size_t i;
+
+  simpleMutexLock(&dq->mutex);
+  if ( dq->count+n > dq->allocated )
+  { size_t newsize = dq->allocated ? dq->allocated*2 : 64;
+    wp_task *new;
+
+    while( newsize < dq->count+n )
+      newsize *= 2;
+    if ( !(new = malloc(newsize*sizeof(*new))) )
+    { simpleMutexUnlock(&dq->mutex);
+      return FALSE;
+    }
+    for(i=0; i<dq->count; i++)
+      new[i] = *DQ_AT(dq, i);
+    free(dq->tasks);
+    dq->tasks     = new;
+    dq->allocated = newsize;
+    dq->head      = 0;
+  }
+  for(i=0; i<n; i++)
+    *DQ_AT(dq, dq->count+i) = tasks[i];
+  dq->count += n;
+  simpleMutexUnlock(&dq->mutex);
+
+  return TRUE;
+}
+
+
+/* take_task() takes the newest task from the bottom if `bottom` is TRUE
+ * and the oldest from the top otherwise.  If batch is not 0, only a task
+ * of this batch is taken.
+ */
+
+static int
+take_task(wp_deque *dq, int bottom, int64_t batch, wp_task *task)
+{ int rc = FALSE;
+
+  if ( dq->count == 0 )			/* unlocked peek */
+    return FALSE;
+
+  simpleMutexLock(&dq->mutex);
+  if ( dq->count > 0 )
+  { wp_task *t = DQ_AT(dq, bottom ? dq->count-1 : 0);
+
+    if ( !batch || t->batch == batch )
+    { *task = *t;
+      dq->count--;
+      if ( !bottom )
+	dq->head = (dq->head+1)%dq->allocated;
+      rc = TRUE;
+    }
+  }
+  simpleMutexUnlock(&dq->mutex);
+
+  if ( rc )
+    ATOMIC_DEC(&pool.pending);
+
+  return rc;
+}
+
+
+/* discard_batch() removes all tasks of batch from the deque and returns
+ * the number of removed tasks.
+ */
+
+static size_t
+discard_batch(wp_deque *dq, int64_t batch)
+{ size_t i, kept = 0, removed;
+
+  simpleMutexLock(&dq->mutex);
+  for(i=0; i<dq->count; i++)
+  { wp_task *t = DQ_AT(dq, i);
+
+    if ( t->batch == batch )
+      PL_erase(t->goal);
+    else
+      *DQ_AT(dq, kept++) = *t;
+  }
+  removed = dq->count - kept;
+  dq->count = kept;
+  simpleMutexUnlock(&dq->mutex);
+
+  if ( removed )
+    ATOMIC_SUB(&pool.pending, removed);
+
+  return removed;
+}
+
+
+		 /*******************************
+		 *	      WORKERS		*
+		 *******************************/
+
+static wp_worker *
+current_worker(void)
+{ int self = PL_thread_self();
+  int i;
+
+  for(i=0; i<pool.slots; i++)
+  { wp_worker *w = pool.worker[i];
+
+    if ( w && w->thread_id == self )
+      return w;
+  }
+
+  return NULL;
+}
+
+
+static int
+find_task(int self, wp_task *task)
+{ wp_worker *me = pool.worker[self];
+  int i, n = pool.slots;
+
+  if ( take_task(&me->deque, TRUE, 0, task) ||
+       take_task(&pool.inject, FALSE, 0, task) )
+    return TRUE;
+
+  for(i=1; i<n; i++)			/* steal */
+  { wp_worker *victim = pool.worker[(self+i)%n];
+
+    if ( victim != me &&
+	 take_task(&victim->deque, FALSE, 0, task) )
+    { ATOMIC_INC(&pool.steals);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+static int
+unify_task(term_t t, wp_task *task)
+{ GET_LD
+  term_t tmp = PL_new_term_ref();
+  int rc = PL_recorded(task->goal, tmp);
+
+  PL_erase(task->goal);
+
+  return rc && PL_unify(t, tmp);
+}
+
+
+/** '$wpool_worker'(-Index) is det.
+ *
+ * Register the calling thread as a worker of the pool.
+ */
+
+static
+PRED_IMPL("$wpool_worker", 1, wpool_worker, 0)
+{ PRED_LD
+  int self = PL_thread_self();
+  wp_worker *w = NULL;
+  int i;
+
+  init_work_pool();
+  simpleMutexLock(&pool.mutex);
+  for(i=0; i<pool.slots; i++)
+  { if ( pool.worker[i]->thread_id == 0 )
+    { w = pool.worker[i];
+      break;
+    }
+  }
+  if ( !w && pool.slots < WP_MAX_WORKERS &&
+       (w = malloc(sizeof(*w))) )
+  { init_deque(&w->deque);
+    i = pool.slots;
+    pool.worker[i] = w;
+    MEMORY_BARRIER();
+    pool.slots++;
+  }
+  if ( w )
+  { w->thread_id = self;
+    pool.active++;
+  }
+  simpleMutexUnlock(&pool.mutex);
+
+  if ( !w )
+    return PL_resource_error("work_pool_workers");
+
+  return PL_unify_integer(A1, i);
+}
+
+
+/** '$wpool_retire'(+Index) is det.
+ *
+ * Unregister a worker.  Tasks left in its deque are moved to the
+ * injection queue.
+ */
+
+static
+PRED_IMPL("$wpool_retire", 1, wpool_retire, 0)
+{ int i;
+  wp_worker *w;
+  wp_task task;
+
+  if ( !PL_get_integer_ex(A1, &i) )
+    return FALSE;
+  if ( i < 0 || i >= pool.slots ||
+       (w=pool.worker[i])->thread_id != PL_thread_self() )
+    return PL_domain_error("work_pool_worker", A1);
+
+  simpleMutexLock(&pool.mutex);
+  w->thread_id = 0;
+  pool.active--;
+  simpleMutexUnlock(&pool.mutex);
+
+  while( take_task(&w->deque, FALSE, 0, &task) )
+  { if ( !push_tasks(&pool.inject, &task, 1) )
+    { PL_erase(task.goal);
+      continue;
+    }
+    simpleMutexLock(&pool.mutex);
+    ATOMIC_INC(&pool.pending);
+    cv_signal(&pool.cond);
+    simpleMutexUnlock(&pool.mutex);
+  }
+
+  return TRUE;
+}
+
+
+/** '$wpool_size'(-Active) is det.
+ */
+
+static
+PRED_IMPL("$wpool_size", 1, wpool_size, 0)
+{ PRED_LD
+
+  return PL_unify_integer(A1, pool.active);
+}
+
+
+/** '$wpool_batch'(-Batch) is det.
+ *
+ * Allocate a new batch identifier.
+ */
+
+static
+PRED_IMPL("$wpool_batch", 1, wpool_batch, 0)
+{ PRED_LD
+
+  return PL_unify_int64(A1, ATOMIC_INC(&pool.batch));
+}
+
+
+static int
+submit_tasks(term_t Batch, term_t Tasks, int inject ARG_LD)
+{ int64_t batch;
+  term_t tail = PL_copy_term_ref(Tasks);
+  term_t head = PL_new_term_ref();
+  tmp_buffer buf;
+  wp_worker *me;
+  size_t n;
+  int rc = TRUE;
+
+  if ( !PL_get_int64_ex(Batch, &batch) )
+    return FALSE;
+
+  initBuffer(&buf);
+  while( PL_get_list_ex(tail, head, tail) )
+  { wp_task task;
+
+    task.batch = batch;
+    if ( !(task.goal = PL_record(head)) )
+    { rc = PL_no_memory();
+      break;
+    }
+    addBuffer(&buf, task, wp_task);
+  }
+  rc = rc && PL_get_nil_ex(tail);
+  n = entriesBuffer(&buf, wp_task);
+
+  if ( rc && n > 0 )
+  { init_work_pool();
+    me = inject ? NULL : current_worker();
+    if ( !push_tasks(me ? &me->deque : &pool.inject,
+		     baseBuffer(&buf, wp_task), n) )
+    { rc = PL_no_memory();
+    } else
+    { simpleMutexLock(&pool.mutex);
+      ATOMIC_ADD(&pool.pending, n);
+      if ( pool.idle > 0 )
+      { if ( n > 1 )
+	  cv_broadcast(&pool.cond);
+	else
+	  cv_signal(&pool.cond);
+      }
+      simpleMutexUnlock(&pool.mutex);
+    }
+  }
+
+  if ( !rc )
+  { size_t i;
+
+    for(i=0; i<n; i++)
+      PL_erase(baseBuffer(&buf, wp_task)[i].goal);
+  }
+  discardBuffer(&buf);
+
+  return rc;
+}
+
+
+/** '$wpool_submit'(+Batch, +Tasks:list) is det.
+ *
+ * Queue all Tasks as part of Batch.  If the caller is a worker the
+ * tasks are added to its own deque, otherwise to the injection queue.
+ */
+
+static
+PRED_IMPL("$wpool_submit", 2, wpool_submit, 0)
+{ PRED_LD
+
+  return submit_tasks(A1, A2, FALSE PASS_LD);
+}
+
+
+/** '$wpool_inject'(+Batch, +Tasks:list) is det.
+ *
+ * As '$wpool_submit'/2, but always add the tasks to the injection
+ * queue.  Used for tasks that must be run in FIFO order, such as
+ * green threads that are rescheduled.
+ */
+
+static
+PRED_IMPL("$wpool_inject", 2, wpool_inject, 0)
+{ PRED_LD
+
+  return submit_tasks(A1, A2, TRUE PASS_LD);
+}
+
+
+/** '$wpool_next'(+Index, -Task) is det.
+ *
+ * Get the next task for a worker, waiting if there is no work.
+ */
+
+static
+PRED_IMPL("$wpool_next", 2, wpool_next, 0)
+{ int i;
+  wp_worker *me;
+  wp_task task;
+
+  if ( !PL_get_integer_ex(A1, &i) )
+    return FALSE;
+  if ( i < 0 || i >= pool.slots ||
+       (me=pool.worker[i])->thread_id != PL_thread_self() )
+    return PL_domain_error("work_pool_worker", A1);
+
+  for(;;)
+  { if ( find_task(i, &task) )
+      return unify_task(A2, &task);
+
+    simpleMutexLock(&pool.mutex);
+    if ( pool.pending <= 0 )
+    { int rc;
+
+      pool.idle++;
+      rc = cv_timedwait(NULL, &pool.cond, &pool.mutex, NULL, NULL);
+      pool.idle--;
+      simpleMutexUnlock(&pool.mutex);
+
+      if ( rc == CV_INTR && PL_handle_signals() < 0 )
+	return FALSE;
+    } else
+    { simpleMutexUnlock(&pool.mutex);
+    }
+  }
+}
+
+
+/** '$wpool_pop'(+Batch, -Task) is semidet.
+ *
+ * If the caller is a worker and the newest task in its deque belongs
+ * to Batch, remove this task and unify it with Task.  Used by a worker
+ * to run its own tasks while waiting for a nested batch.
+ */
+
+static
+PRED_IMPL("$wpool_pop", 2, wpool_pop, 0)
+{ int64_t batch;
+  wp_worker *me;
+  wp_task task;
+
+  if ( !PL_get_int64_ex(A1, &batch) )
+    return FALSE;
+
+  if ( pool.initialized &&
+       (me=current_worker()) &&
+       take_task(&me->deque, TRUE, batch, &task) )
+    return unify_task(A2, &task);
+
+  return FALSE;
+}
+
+
+/** '$wpool_cancel'(+Batch) is det.
+ *
+ * Discard all queued tasks of Batch.
+ */
+
+static
+PRED_IMPL("$wpool_cancel", 1, wpool_cancel, 0)
+{ int64_t batch;
+  int i;
+
+  if ( !PL_get_int64_ex(A1, &batch) )
+    return FALSE;
+
+  if ( pool.initialized )
+  { discard_batch(&pool.inject, batch);
+    for(i=0; i<pool.slots; i++)
+      discard_batch(&pool.worker[i]->deque, batch);
+  }
+
+  return TRUE;
+}
+
+
+/** '$wpool_statistics'(-Workers, -Pending, -Steals) is det.
+ */
+
+static
+PRED_IMPL("$wpool_statistics", 3, wpool_statistics, 0)
+{ PRED_LD
+
+  return ( PL_unify_integer(A1, pool.active) &&
+	   PL_unify_int64(A2, pool.pending > 0 ? pool.pending : 0) &&
+	   PL_unify_int64(A3, pool.steals) );
+}
+
+
+
+		 /*******************************
+		 *	  GREEN THREADS		*
+		 *******************************/
+
+/* - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+The green thread scheduler of library(thread) uses a poller thread that
+waits for input on the streams of  suspended green threads using
+wait_for_input/3.  The poller must  be  woken  if  a new green thread
+starts waiting.  For this we  provide  a  pipe  whose  read end is
+included in the file descriptors the poller waits for.
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(HAVE_UNISTD_H) && defined(F_SETFL) && defined(O_NONBLOCK)
+#define O_GREEN_WAKEUP 1
+static int wakeup_fd[2] = {-1, -1};
+#endif
+
+/** '$green_wakeup_fd'(-FD) is semidet.
+ *
+ * FD is the read end of the wakeup pipe.  Fails if not supported.
+ */
+
+static
+PRED_IMPL("$green_wakeup_fd", 1, green_wakeup_fd, 0)
+{
+#ifdef O_GREEN_WAKEUP
+  PRED_LD
+
+  if ( wakeup_fd[0] < 0 )
+  { int fd[2];
+
+    PL_LOCK(L_THREAD);
+    if ( wakeup_fd[0] < 0 && pipe(fd) == 0 )
+    { fcntl(fd[0], F_SETFL, O_NONBLOCK);
+      fcntl(fd[1], F_SETFL, O_NONBLOCK);
+      wakeup_fd[1] = fd[1];
+      wakeup_fd[0] = fd[0];
+    }
+    PL_UNLOCK(L_THREAD);
+  }
+
+  if ( wakeup_fd[0] >= 0 )
+    return PL_unify_integer(A1, wakeup_fd[0]);
+#endif
+
+  return FALSE;
+}
+
+
+/** '$green_wakeup' is det.
+ *
+ * Wake the poller.  Writing  fails  silently  if  the  pipe  is full,
+ * which implies the poller is woken anyway.
+ */
+
+static
+PRED_IMPL("$green_wakeup", 0, green_wakeup, 0)
+{
+#ifdef O_GREEN_WAKEUP
+  if ( wakeup_fd[1] >= 0 )
+  { char c = 0;
+    ssize_t rc = write(wakeup_fd[1], &c, 1);
+    (void)rc;
+  }
+#endif
+
+  return TRUE;
+}
+
+
+/** '$green_drain' is det.
+ *
+ * Remove all pending wakeups from the pipe.
+ */
+
+static
+PRED_IMPL("$green_drain", 0, green_drain, 0)
+{
+#ifdef O_GREEN_WAKEUP
+  if ( wakeup_fd[0] >= 0 )
+  { char buf[64];
+
+    while( read(wakeup_fd[0], buf, sizeof(buf)) > 0 )
+      ;
+  }
+#endif
+
+  return TRUE;
+}
+
+#endif /*O_PLMT*/
+
+
+		 /*******************************
+		 *      PUBLISH PREDICATES	*
+		 *******************************/
+
+BeginPredDefs(workpool)
+#ifdef O_PLMT
+  PRED_DEF("$wpool_worker",	1, wpool_worker,     0)
+  PRED_DEF("$wpool_retire",	1, wpool_retire,     0)
+  PRED_DEF("$wpool_size",	1, wpool_size,	     0)
+  PRED_DEF("$wpool_batch",	1, wpool_batch,	     0)
+  PRED_DEF("$wpool_submit",	2, wpool_submit,     0)
+  PRED_DEF("$wpool_inject",	2, wpool_inject,     0)
+  PRED_DEF("$wpool_next",	2, wpool_next,	     0)
+  PRED_DEF("$wpool_pop",	2, wpool_pop,	     0)
+  PRED_DEF("$wpool_cancel",	1, wpool_cancel,     0)
+  PRED_DEF("$wpool_statistics", 3, wpool_statistics, 0)
+  PRED_DEF("$green_wakeup_fd",	1, green_wakeup_fd,  0)
+  PRED_DEF("$green_wakeup",	0, green_wakeup,     0)
+  PRED_DEF("$green_drain",	0, green_drain,	     0)
+#endif
+EndPredDefs
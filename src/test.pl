@@ -1458,6 +1458,74 @@ record(erase-2) :-
 	erase(Ref),
 	findall(X, a(X), Xs),
 	Xs = [].
+record(space-1) :-
+	message_queue_create(Q),
+	statistics(record_space, R0),
+	statistics(message_space, M0),
+	statistics(slab_space, Slab0),
+	forall(between(1, 20000, X), thread_send_message(Q, f(X))),
+	statistics(record_space, R1),
+	statistics(message_space, M1),
+	statistics(slab_space, Slab1),
+	R1 > R0, M1 > M0,
+	(   Slab1 == 0			% no slab allocator in this build
+	->  true
+	;   Slab1 > Slab0
+	),
+	thread_get_messages(Q, L1, []),
+	length(L1, 20000),
+	statistics(record_space, R0),
+	statistics(message_space, M0),
+	forall(between(1, 20000, X), thread_send_message(Q, f(X))),
+	thread_get_messages(Q, L2, []),
+	length(L2, 20000),
+	message_queue_destroy(Q),
+	statistics(slab_space, Slab1).	% freed objects are reused
+record(module_memory-1) :-
+	M = test_module_memory,
+	assertz(M:mm(0)),
+	module_property(M, clause_size(S0)),
+	forall(between(1, 100, X), assertz(M:mm(X))),
+	module_property(M, clause_size(S1)),
+	S1 > S0,
+	retractall(M:mm(_)),
+	module_property(M, clause_size(0)).
+record(module_memory-2) :-
+	M = test_module_memory,
+	forall(between(1, 100, X), assertz(M:mi(X, X))),
+	forall(between(1, 100, X), M:mi(_, X)),
+	module_property(M, index_size(I)),
+	I > 0,
+	abolish(M:mi/2),
+	module_property(M, index_size(0)).
+record(module_memory-3) :-
+	M = test_module_memory_copy,
+	forall(between(1, 10, X), assertz(M:mc(X))),
+	copy_predicate_clauses(M:mc(_), M:mc2(_)),
+	module_property(M, clause_size(S0)),
+	retractall(M:mc(_)),
+	module_property(M, clause_size(S1)),
+	S1 > 0, S1 < S0,
+	retractall(M:mc2(_)),
+	module_property(M, clause_size(0)).
+record(module_memory-4) :-
+	tmp_file(qlf_memory, Base),
+	file_name_extension(Base, pl, Src),
+	file_name_extension(Base, qlf, Qlf),
+	setup_call_cleanup(
+	    open(Src, write, Out),
+	    format(Out, ':- module(test_qlf_memory, []).~n\
+			 :- dynamic d/1.~n\
+			 d(1).~nd(2).~nd(3).~n', []),
+	    close(Out)),
+	qcompile(Src),
+	load_files(Qlf, [silent(true)]),
+	delete_file(Src),
+	delete_file(Qlf),
+	module_property(test_qlf_memory, clause_size(S)),
+	S > 0,
+	retractall(test_qlf_memory:d(_)),
+	module_property(test_qlf_memory, clause_size(0)).
 
 
 		 /*******************************
@@ -2542,6 +2610,23 @@ at_exit_work :-
 th_do_something :-
 	forall(between(1, 5, X),
 	       assert(th_data(X))).
+th_green_pong :-
+	green_get_message(ping(From, N)),
+	green_send(From, pong(N)),
+	th_green_pong.
+
+th_sum_squares(L, _, Sum) :-
+	concurrent_maplist([X,Y]>>(Y is X*X), L, Squares),
+	sum_list(Squares, Sum).
+
+th_get_batches(_, 0, []) :- !.
+th_get_batches(Q, N, L) :-
+	thread_get_messages(Q, L0, []),
+	length(L0, N0),
+	N1 is N - N0,
+	append(L0, L1, L),
+	th_get_batches(Q, N1, L1).
+
 th_check_done :-
 	findall(X, retract(th_data(X)), [1,2,3,4,5]).
 
@@ -2578,6 +2663,312 @@ thread(status-1) :-
 thread(create_error-1) :-
 	catch(thread_create(true, _, [local(a)]), E, true),
 	E = error(type_error(integer, a), _).
+thread(hugepages-1) :-
+	thread_self(Me),
+	thread_create(( current_prolog_flag(stack_hugepages, HP),
+			numlist(1, 1000000, L),
+			sum_list(L, Sum),
+			thread_send_message(Me, hugepages(HP, Sum))
+		      ), Id, [stack_hugepages(explicit)]),
+	thread_get_message(hugepages(HP, Sum)),
+	thread_join(Id, true),
+	HP == explicit,
+	Sum =:= 500000500000.
+thread(hugepages-2) :-
+	current_prolog_flag(stack_hugepages, Old),
+	set_prolog_flag(stack_hugepages, true),
+	current_prolog_flag(stack_hugepages, New),
+	numlist(1, 100000, L),
+	length(L, Len),
+	set_prolog_flag(stack_hugepages, Old),
+	New == transparent,
+	Len == 100000.
+thread(hugepages-3) :-
+	catch(thread_create(true, _, [stack_hugepages(always)]), E, true),
+	E = error(domain_error(stack_hugepages, always), _).
+thread(hugepages-4) :-
+	(   thp_supported
+	->  hugepage_stacks(true, ["hg"], N0, N),
+	    N > N0
+	;   true			% no transparent huge pages
+	).
+thread(hugepages-5) :-			% falls back to transparent pages
+	(   thp_supported
+	->  hugepage_stacks(explicit, ["ht","hg"], N0, N),
+	    N > N0
+	;   true
+	).
+thread(inbox-1) :-
+	thread_self(Me),
+	numlist(1, 4, Ps),
+	maplist([P,Id]>>thread_create(forall(between(1, 1000, I),
+					     thread_send_message(Me, q(P,I))),
+				      Id),
+		Ps, Ids),
+	forall(between(1, 1000, I),
+	       forall(member(P, Ps), thread_get_message(q(P,I)))),
+	maplist(thread_join, Ids),
+	\+ thread_peek_message(q(_,_)).
+thread(batch-1) :-
+	message_queue_create(Q),
+	thread_send_messages(Q, [a,b,c,d,e]),
+	thread_get_messages(Q, L1, [max(2)]),
+	thread_get_messages(Q, L2, []),
+	\+ thread_get_messages(Q, _, [timeout(0)]),
+	message_queue_destroy(Q),
+	L1 == [a,b], L2 == [c,d,e].
+thread(batch-2) :-
+	message_queue_create(Q, [max_size(2)]),
+	thread_create(thread_send_messages(Q, [1,2,3,4,5]), Id),
+	th_get_batches(Q, 5, L),
+	thread_join(Id, true),
+	message_queue_destroy(Q),
+	L == [1,2,3,4,5].
+thread(match-1) :-
+	message_queue_create(Q),
+	forall(member(M, [r(1,[a]), r(2,"s"), r(3,f(_)), r(2,1.5), r(2,f(x))]),
+	       thread_send_message(Q, M)),
+	thread_get_message(Q, r(2,f(X))),
+	thread_get_message(Q, r(_,f(Y))),
+	thread_get_message(Q, r(2,F)),
+	message_queue_destroy(Q),
+	X == x, var(Y), F == "s".
+thread(priority-1) :-
+	message_queue_create(Q, [priority(true)]),
+	message_queue_property(Q, priority(true)),
+	forall(member(M-P, [a-0, b-5, c-(-1), d-5, e-0, f(1)-3, f(2)-0]),
+	       thread_send_message(Q, M, [priority(P)])),
+	thread_get_message(Q, f(X)),
+	thread_get_message(Q, f(Y)),
+	findall(M, (between(1, 5, _), thread_get_message(Q, M)), L),
+	message_queue_destroy(Q),
+	X == 1, Y == 2, L == [b,d,a,e,c].
+thread(any-1) :-
+	(   current_prolog_flag(windows, true)
+	->  true
+	;   message_queue_create(Q1),
+	    message_queue_create(Q2),
+	    \+ thread_get_message_any([Q1,Q2], _, _, [timeout(0)]),
+	    wait_for_input([message_queue(Q1)], [], 0),
+	    thread_create(( thread_send_message(Q1, skip),
+			    thread_send_message(Q2, m(1))
+			  ), Id),
+	    thread_get_message_any([Q1,Q2], Q, m(X), []),
+	    thread_join(Id, true),
+	    wait_for_input([message_queue(Q2), message_queue(Q1)], Ready, 0),
+	    thread_get_message_any([Q2,Q1], Q3, M, [timeout(1)]),
+	    message_queue_destroy(Q1),
+	    message_queue_destroy(Q2),
+	    Q == Q2, X == 1, Ready == [message_queue(Q1)], Q3 == Q1, M == skip
+	).
+thread(pool-1) :-
+	current_prolog_flag(cpu_count, Cores),
+	setup_call_cleanup(
+	    set_prolog_flag(cpu_count, 4),
+	    ( numlist(1, 50, L),
+	      concurrent_maplist(th_sum_squares(L), L, Sums),
+	      \+ concurrent_maplist([X]>>(X < 40), L),
+	      catch(concurrent_forall(member(X, L),
+					     (X == 25 -> throw(th_stop) ; true)),
+		    E, true)
+	    ),
+	    set_prolog_flag(cpu_count, Cores)),
+	maplist(==(42925), Sums),
+	E == th_stop.
+thread(pool-2) :-
+	current_prolog_flag(cpu_count, Cores),
+	Hook = (message_hook(abnormal_thread_completion(G, _), _, _) :-
+		    strip_module(G, _, pool_worker)),
+	setup_call_cleanup(
+	    ( set_prolog_flag(cpu_count, 2),
+	      asserta(user:Hook, Ref)
+	    ),
+	    ( numlist(1, 50, L),
+	      \+ concurrent_maplist([X]>>( X == 25
+					  -> thread_self(Me),
+					     thread_signal(Me, abort)
+					  ;  true
+					  ), L),
+	      concurrent_maplist([X,Y]>>(Y is X*X), L, Squares)
+	    ),
+	    ( set_prolog_flag(cpu_count, Cores),
+	      erase(Ref)
+	    )),
+	sum_list(Squares, 42925).
+thread(green-1) :-
+	green_self(Me),
+	spawn(th_green_pong, Pong),
+	forall(between(1, 3, I),
+	       ( green_send(Pong, ping(Me, I)),
+		 thread_get_message(pong(I)) )),
+	numlist(1, 200, L),
+	maplist([I,Id]>>spawn(( green_get_message(go(X)),
+				green_yield,
+				green_sleep(0.001),
+				Y is X*I,
+				green_send(Me, done(I,Y))
+			      ), Id, [detached(false)]),
+		L, Ids),
+	maplist([Id]>>green_send(Id, go(2)), Ids),
+	forall(member(I, L),
+	       ( thread_get_message(done(I,Y)),
+		 Y =:= 2*I )),
+	maplist([Id]>>green_join(Id, true), Ids),
+	spawn(fail, F, [detached(false)]),
+	green_join(F, FS),
+	spawn(throw(th_stop), E, [detached(false)]),
+	spawn(( green_join(E, ES),
+		ES == exception(th_stop)
+	      ), J, [detached(false)]),
+	green_join(J, JS),
+	FS == false, JS == true.
+thread(engine_pool-1) :-
+	current_prolog_flag(engine_pool_size, Size),
+	setup_call_cleanup(
+	    set_prolog_flag(engine_pool_size, 2),
+	    ( statistics(engines_reused, R0),
+	      forall(between(1, 10, I),
+		     ( engine_create(X, ( set_prolog_flag(occurs_check, true),
+					  numlist(1, I, X) ), E),
+		       engine_next(E, L),
+		       engine_destroy(E),
+		       numlist(1, I, L) )),
+	      engine_create(Len-F, ( numlist(1, 100000, L2),
+				     length(L2, Len),
+				     current_prolog_flag(occurs_check, F)
+				   ), E2),
+	      engine_next(E2, Answer),
+	      engine_destroy(E2),
+	      statistics(engines_reused, R1)
+	    ),
+	    set_prolog_flag(engine_pool_size, Size)),
+	Answer == 100000-false,
+	R1 > R0,
+	catch(set_prolog_flag(engine_pool_size, -1), Ex, true),
+	Ex = error(domain_error(engine_pool_size, -1), _),
+	current_prolog_flag(engine_pool_size, Size).
+thread(match-2) :-
+	message_queue_create(Q),
+	Big is 1<<40,
+	Big1 is Big+1,
+	forall(member(M, [v(1.5,a), v(-0.0,b), v(0.0,c), v("ab",d), v("abc",e),
+			  v(Big1,f), v(Big,g)]),
+	       thread_send_message(Q, M)),
+	thread_get_message(Q, v(0.0,C)),
+	thread_get_message(Q, v("abc",E)),
+	thread_get_message(Q, v(Big,G)),
+	\+ thread_peek_message(Q, v(2.5,_)),
+	\+ thread_peek_message(Q, v("a",_)),
+	thread_get_messages(Q, Rest, [timeout(0)]),
+	message_queue_destroy(Q),
+	C-E-G == c-e-g,
+	Rest == [v(1.5,a), v(-0.0,b), v("ab",d), v(Big1,f)].
+thread(numa-1) :-
+	thread_create(numlist(1, 100000, _), Id, [numa_node(0)]),
+	thread_join(Id, true).
+thread(numa-2) :-
+	catch(thread_create(true, Id, [numa_node(100000)]), E, true),
+	(   var(E)			% option not supported
+	->  thread_join(Id, true)
+	;   E = error(existence_error(numa_node, 100000), _)
+	).
+thread(numa-3) :-
+	thread_self(Me),
+	catch(thread_create(( thread_self(Self),
+			      thread_affinity(Self, CPUs, CPUs),
+			      thread_send_message(Me, cpus(CPUs))
+			    ), Id, [numa_node(0), affinity([0])]),
+	      E, true),
+	(   var(E)
+	->  thread_join(Id, true),
+	    thread_get_message(cpus(CPUs)),
+	    CPUs == [0]
+	;   true			% option not supported
+	).
+thread(resource_usage-1) :-
+	thread_self(Me),
+	thread_create(( forall(between(1, 10, I),
+			       thread_send_message(Me, msg(I))),
+			thread_get_message(done)
+		      ), Id, []),
+	forall(between(1, 10, I), thread_get_message(msg(I))),
+	thread_resource_usage(Id, U1),
+	get_dict(messages_sent, U1, 10),
+	get_dict(records, U1, Records),
+	Records >= 10,
+	get_dict(global_allocated, U1, Global),
+	Global > 0,
+	thread_resource_usage_reset(Id),
+	thread_resource_usage(Id, U2),
+	get_dict(messages_sent, U2, 0),
+	thread_send_message(Id, done),
+	thread_join(Id, true).
+thread(resource_usage-2) :-
+	thread_self(Me),
+	thread_resource_usage_reset(Me),
+	thread_resource_usage(Me, U0),
+	forall(between(1, 1000, _), numlist(1, 100, _)),
+	thread_resource_usage(Me, U1),
+	get_dict(global_allocated, U0, G0),
+	get_dict(global_allocated, U1, G1),
+	G1-G0 > 1000*100*2*4.		% discarded by backtracking
+thread(governor-1) :-
+	thread_create(gov_loop(0), Id, [max_inferences(100000)]),
+	thread_join(Id, exception(error(resource_error(max_inferences), _))).
+thread(governor-2) :-
+	thread_self(Me),
+	thread_create((thread_send_message(Me, running), gov_loop(0)),
+		      Id, []),
+	thread_get_message(running),
+	thread_set_resource_limits(Id, [max_inferences(1)]),
+	thread_join(Id, exception(error(resource_error(max_inferences), _))).
+
+gov_loop(N) :-
+	N1 is N+1,
+	gov_loop(N1).
+
+%	hugepage_stacks(+How, +Flags, -Before, -After)
+%
+%	Count the memory mappings with  one   of  the  VmFlags Flags in
+%	/proc/self/smaps before and while running   a thread that grows
+%	its stacks using stack_hugepages(How).
+
+hugepage_stacks(How, Flags, N0, N) :-
+	smaps_flag_count(Flags, N0),
+	thread_self(Me),
+	thread_create(( numlist(1, 1000000, L),
+			smaps_flag_count(Flags, N1),
+			thread_send_message(Me, smaps(N1)),
+			length(L, _)
+		      ), Id, [stack_hugepages(How)]),
+	thread_get_message(smaps(N)),
+	thread_join(Id, true).
+
+thp_supported :-
+	access_file('/proc/self/smaps', read),
+	catch(read_file_to_string('/sys/kernel/mm/transparent_hugepage/enabled',
+				  String, []),
+	      _, fail),
+	\+ sub_string(String, _, _, _, "[never]").
+
+smaps_flag_count(Flags, Count) :-
+	setup_call_cleanup(
+	    open('/proc/self/smaps', read, In),
+	    smaps_flag_count(In, Flags, 0, Count),
+	    close(In)).
+
+smaps_flag_count(In, Flags, C0, C) :-
+	read_line_to_string(In, Line),
+	(   Line == end_of_file
+	->  C = C0
+	;   (   split_string(Line, " ", " ", ["VmFlags:"|VmFlags]),
+		member(Flag, Flags),
+		memberchk(Flag, VmFlags)
+	    ->  C1 is C0+1
+	    ;   C1 = C0
+	    ),
+	    smaps_flag_count(In, Flags, C1, C)
+	).
 
 
 		 /*******************************
@@ -2609,6 +3000,34 @@ mutex(destroy-1) :-
 	gensym(mutex, Mutex),
 	mutex_create(Mutex),
 	mutex_destroy(Mutex).
+mutex(statistics-1) :-
+	(   current_predicate(system:mutex_statistics/1)
+	->  gensym(mutex, Mutex),
+	    mutex_create(Mutex),
+	    thread_self(Main),
+	    thread_create(( mutex_lock(Mutex),
+			    thread_send_message(Main, locked),
+			    sleep(0.05),
+			    mutex_unlock(Mutex)),
+			  Id, []),
+	    thread_get_message(locked),
+	    mutex_lock(Mutex),
+	    mutex_unlock(Mutex),
+	    thread_join(Id, true),
+	    mutex_statistics(Stats),
+	    member(S, Stats),
+	    get_dict(name, S, Mutex),
+	    !,
+	    get_dict(type, S, user),
+	    get_dict(collisions, S, C),
+	    get_dict(wait_time, S, W),
+	    get_dict(histogram, S, H),
+	    C >= 1,
+	    W > 0,
+	    sum_list(H, C),
+	    mutex_destroy(Mutex)
+	;   true
+	).
 
 
 		 /*******************************